@@ -13,8 +13,16 @@ Acknowledgements : Ansi escape code reference: https://gist.github.com/fnky/4587
 #include <stdlib.h>
 #include <conio.h>
 #include <string.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <math.h>
 #include <time.h>
+#include <winsock2.h> // before windows.h, link with -lws2_32
+#include <ws2tcpip.h>
 #include <windows.h>
+#ifdef __SSE2__
+#include <emmintrin.h> // SSE2 is part of every x86-64 CPU, the NNUE loops fall back to plain C without it
+#endif
 
 #define MAX_MOVES 200
 #define MAX_MENU_SELECTION 4
@@ -25,11 +33,152 @@ Acknowledgements : Ansi escape code reference: https://gist.github.com/fnky/4587
 #define MAX_CARDS 16
 #define MAX_CARD_PER_GAME 5
 #define BOARD_MAX_LENGTH 50
-#define TEXT_FILE_ROWS 6
-#define VISUAL_CARD_CENTER 2
-#define ROWS 5
-#define COLS 5
-#define NUM_OF_STUD 5
+
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 5 // compile with -DBOARD_SIZE=7 for the 7x7 variant
+#endif
+
+#define TEXT_FILE_ROWS (BOARD_SIZE + 1) // color line followed by a BOARD_SIZE x BOARD_SIZE pattern
+#define VISUAL_CARD_CENTER (BOARD_SIZE / 2)
+#define ROWS BOARD_SIZE
+#define COLS BOARD_SIZE
+#define NUM_OF_STUD BOARD_SIZE
+#define NUM_SQUARES (ROWS * COLS)
+
+// One bit per square (row * COLS + col), so the 5x5 game stays on 32-bit masks
+#if NUM_SQUARES <= 32
+typedef unsigned int boardMask;
+#define LOWEST_SQUARE(m) __builtin_ctz(m)
+#define COUNT_SQUARES(m) __builtin_popcount(m)
+#elif NUM_SQUARES <= 64
+typedef unsigned long long boardMask;
+#define LOWEST_SQUARE(m) __builtin_ctzll(m)
+#define COUNT_SQUARES(m) __builtin_popcountll(m)
+#else
+#error "BOARD_SIZE must fit a 64-bit board mask"
+#endif
+
+#define SQUARE_BIT(sq) ((boardMask) 1 << (sq))
+#define SQUARE_OF(row, col) ((row) * COLS + (col))
+#define MIRROR_SQUARE(sq) ((sq) - (sq) % COLS + COLS - 1 - (sq) % COLS)
+#define ATTACKED_BY(state, side) ((state)->attacks[side][0] | (state)->attacks[side][1])
+
+// A move packs the card id with its from/to squares; from == to marks a pass (card swap only)
+typedef unsigned short coreMove;
+#define MAKE_MOVE(card, from, to) ((coreMove) (((card) << 12) | ((from) << 6) | (to)))
+#define MOVE_CARD(m) ((m) >> 12)
+#define MOVE_FROM(m) (((m) >> 6) & 63)
+#define MOVE_TO(m) ((m) & 63)
+#define MOVE_IS_PASS(m) (MOVE_FROM(m) == MOVE_TO(m))
+#define MAX_CORE_MOVES (MAX_CARDS_PER_PLAYER * NUM_OF_STUD * NUM_SQUARES)
+
+#define WIN_SCORE 30000
+#define MAX_SEARCH_DEPTH 64
+#define DEADLINE_CHECK_MASK 255         // the search reads the clock every 256 nodes, under 0.1 ms at full speed
+#define DEFAULT_ANALYSIS_DEPTH 8
+#define ANALYSIS_TT_BITS 20
+#define MAX_MULTIPV 8                   // most lines a multi-PV search reports
+#define MAX_PV_LEN 12                   // moves kept per principal variation
+#define COACH_LINES 4                   // lines in the in-game analysis panel, one row is left for its title
+#define COACH_TIME_MS 500
+#define COACH_TT_BITS 18
+#define MAX_PANEL_TEXT 72               // one panel row: a line number, score and variation
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+#define TT_PACK(move, score, depth, flag) ((unsigned long long) (move) | \
+                                           (unsigned long long) (unsigned short) (score) << 16 | \
+                                           (unsigned long long) (unsigned char) (depth) << 32 | \
+                                           (unsigned long long) (flag) << 40)
+#define TT_MOVE(data) ((coreMove) ((data) & 0xFFFF))
+#define TT_SCORE(data) ((short) ((data) >> 16 & 0xFFFF))
+#define TT_DEPTH(data) ((signed char) ((data) >> 32 & 0xFF))
+#define TT_FLAG(data) ((int) ((data) >> 40 & 0xFF))
+#define TT_FILE_MAGIC "ONITT01"
+#define TT_FILE_VERSION 1
+#define MAX_POSITION_LEN 200
+#define MAX_RESULT_LEN 1024             // room for the position, -multipv moves and statistics
+#define MAX_THREADS 64
+#define HISTORY_RING 1024               // positions remembered per game, power of two
+#define HISTORY_SLOTS (2 * HISTORY_RING) // exact occurrence counts by hash, at most half full, power of two
+#define DEFAULT_REPETITIONS 3
+#define PN_INFINITY 0x7FFFFFFFu
+#define DEFAULT_SOLVE_NODES (1 << 21)
+#define PUZZLE_PLIES 5
+#define MAX_PUZZLE_PLIES 9
+#define PUZZLE_TT_BITS 16
+#define PUZZLE_RANDOM_MOVE 8            // one simulated move in this many is random
+#define MAX_CARD_SETS 4368              // C(MAX_CARDS, MAX_CARD_PER_GAME)
+#define DEAL_ARRANGEMENTS 30            // 5 choices of neutral card times 6 ways to split the other four
+#define SURVEY_DEPTH 6
+#define SURVEY_TT_BITS 18
+#define SURVEY_PROGRESS 1000
+#define MAX_RECORD_TEXT (200 + 7 * MAX_NAME_LEN + MAX_MOVES * (MAX_NAME_LEN + 20))
+#define NET_UNIT_GAMES 32               // self-play games per work unit
+#define NET_UNIT_LINES 64               // positions per analysis work unit
+#define MAX_WORKER_LINKS 60             // stays under the default FD_SETSIZE of 64
+#define NET_BUFFER 4096
+#define NET_CONNECT_TRIES 30
+#define UNIT_PENDING 0
+#define UNIT_ASSIGNED 1
+#define UNIT_DONE 2
+#define DEFAULT_TRACE_DEPTH 2
+#define SELFPLAY_DEPTH 4
+#define SELFPLAY_RANDOM_PLIES 4
+#define DB_MAGIC "ONIDB01"
+#define DB_VERSION 2                    // 2 added the player names
+#define DB_BLOCK_GAMES 4096
+#define DB_NAME_SLOTS (4 * DB_BLOCK_GAMES) // hash slots of a block's name table, power of two
+#define CONVERT_CHUNK (1 << 20)         // bytes of game text a worker parses at a time
+#define EVAL_FILE "eval.cfg"
+#define EVAL_MATERIAL 0                 // evaluation features, see evalFeatures
+#define EVAL_MASTER_SAFETY 1
+#define EVAL_TEMPLE 2
+#define EVAL_MOBILITY 3
+#define EVAL_NEUTRAL 4
+#define EVAL_FEATURES 5
+#define NNUE_FILE "nnue.bin"            // optional network, the weighted features are used without it
+#define NNUE_MAGIC "ONINN01"
+#define NNUE_VERSION 1
+#define NNUE_HIDDEN 32                  // accumulator values per perspective, a multiple of 8
+#define NNUE_CLIP 127                   // clipped ReLU ceiling applied to the accumulator
+#define NNUE_PIECE_FEATURES (4 * NUM_SQUARES) // own or opposing student or sensei on each square
+#define NNUE_INPUTS (NNUE_PIECE_FEATURES + 3 * MAX_CARDS) // then each card in own hand, opposing hand or neutral
+#define NNUE_MAX_CHANGES 8              // most features one move switches on or off for a perspective
+#define SAMPLE_MAGIC "ONISMP1"
+#define SAMPLE_VERSION 1
+#define TUNE_CHUNK 65536                // samples per work item of a tuning pass
+#define TUNE_EPOCHS 200
+#define TUNE_RATE 1.0
+#define TUNE_REPORT 20                  // epochs between loss reports
+#define TUNE_K_MIN 0.1                  // range of the logistic scale fit
+#define TUNE_K_MAX 4.0
+#define TUNE_K_STEPS 16
+#define INDEX_MAGIC "ONIIDX1"
+#define INDEX_VERSION 1
+#define INDEX_WRITE_BUFFER 4096
+#define INDEX_LIST_LIMIT 20
+#define SPECTATE_MAGIC "ONISPEC"
+#define SPECTATE_VERSION 1
+#define SPECTATE_SLOTS 1024             // power of two, room for several whole games
+#define SPECTATE_POLL_MS 50
+#define SPECTATE_START 0
+#define SPECTATE_MOVE 1
+#define SPECTATE_UNDO 2
+#define SPECTATE_RESULT 3
+#define SIM_BATCH 1024                  // games the batched simulator steps at once
+#define MAX_CARD_SHIFTS (BOARD_SIZE * BOARD_SIZE - 1) // distances of a card pattern, all but its center
+#define RATING_START 1500.0
+#define RATING_K 24.0                   // most rating points one game can move
+#define RATING_LEADERS 10               // ratings shown in the Hall of Fame
+#define RATING_PARALLEL (2 * RATING_CHUNK) // rating periods or histories with fewer games are rated on one thread
+#define RATING_SLOPE (2.302585092994046 / 400.0) // ln 10 / 400, how fast expectedScore changes per point
+#define RATING_CHUNK 4096               // games a worker takes at a time within a period
+#define RATING_LINE 96                  // bytes per Ratings.txt record, newline included
+#define RATING_SLOTS 64                 // fewest record slots of Ratings.txt, power of two
+#define CLOCK_MOVES_TO_GO 20            // moves the engine spreads its remaining time over
+#define CLOCK_RESERVE_MS 50             // kept back from every engine move for the work around the search
+#define CLOCK_TENTHS_BELOW 20           // seconds left under which a clock shows tenths
 
 
 #define KEY_UP 72
@@ -38,6 +187,11 @@ Acknowledgements : Ansi escape code reference: https://gist.github.com/fnky/4587
 #define KEY_RIGHT 77
 #define KEY_ENTER 13
 
+#define TURN_PLAYED 0
+#define TURN_UNDO 1
+#define TURN_REDO 2
+#define TURN_FLAGGED 3                  // set by playGame when the mover's clock ran out during the turn
+
 typedef char str30[31];
 typedef char str100[100];
 typedef char oniBrd[ROWS][COLS][BOARD_MAX_LENGTH];   
@@ -105,1430 +259,11089 @@ struct MoveTag
 
 typedef struct MoveTag MoveRecord;
 
-/*
-Resets the board to empty state
+struct rngTag
+{
+    unsigned long long s[4]; // xoshiro256** state, never all zero once seeded
+};
 
-Precondition:
-    - Board array must be properly allocated
-    - ROWS and COLS must match board dimensions
+typedef struct rngTag rngState;
 
-@param board The game board to reset
-@return Returns no data type (void)
-*/
-void resetBoard(oniBrd board) 
+struct cardInfoTag
 {
-    int i, j;
-    
-    for (i = 0; i < ROWS; i++) 
-    {
-        for (j = 0; j < COLS; j++) 
-        {
-            strcpy(board[i][j], "| _ |");
-        }
-    }
-}
-
-/*
-Records a move into the replay system
+    str30 name;
+    int color;                          // side that starts when this is the neutral card (0 BLUE, 1 RED)
+    int mirror;                         // id of the card with the left-right mirrored pattern, -1 if none
+    str30 pattern[TEXT_FILE_ROWS];      // text file contents padded to BOARD_SIZE
+    boardMask moves[2][NUM_SQUARES];    // destinations per side and origin square
+};
 
-Precondition:
-    - replayMoves array must have space for MAX_MOVES
-    - moveCount must point to valid integer < MAX_MOVES
-    - cardUsed must be null-terminated string < MAX_NAME_LEN
+typedef struct cardInfoTag cardInfo;
 
-@param replayMoves Array to store moves
-@param moveCount Pointer to current move count
-@param player Player number (1 or 2)
-@param from Starting position
-@param to Destination position
-@param cardUsed Name of card used for move
-@return Returns no data type (void)
-*/
-void recordMove(MoveRecord* replayMoves, int* moveCount, int player,
-                Position from, Position to, char* cardUsed) 
+struct gameStateTag
 {
-    if (*moveCount < MAX_MOVES) 
-    {
-        replayMoves[*moveCount].player = player;
-        replayMoves[*moveCount].from = from;
-        replayMoves[*moveCount].to = to;
+    boardMask pieces[2];                // every piece of a side, side 0 is Player 1 (BLUE)
+    int master[2];                      // square of each sensei, -1 once captured
+    int hand[2][MAX_CARDS_PER_PLAYER];  // card ids in the same slot order as playercard
+    int neutral;                        // card id waiting between the players
+    int side;                           // side to move, same convention as playerTurn
+    int round;                          // round counter of playGame
+    boardMask attacks[2][MAX_CARDS_PER_PLAYER]; // squares each held card reaches from the side's pieces
+};
 
-        strcpy(replayMoves[*moveCount].cardName, cardUsed);
-        (*moveCount)++;
-    }
-}
+typedef struct gameStateTag gameState;
 
-/*
-Applies a single move to the board during replay
+struct zobristTag
+{
+    unsigned long long piece[2][2][NUM_SQUARES]; // side, student/sensei, square
+    unsigned long long card[MAX_CARDS][3];       // held by side 0, side 1, or neutral
+    unsigned long long sideToMove;
+};
 
-Precondition:
-    - Board must be properly initialized
-    - move.from and move.to must be valid positions
-    - BOARD_MAX_LENGTH must be sufficient for piece strings
+typedef struct zobristTag zobristKeys;
 
-@param board The game board to modify
-@param move The move record to apply
-@return Returns no data type (void)
-*/
-void applyMove(oniBrd board, MoveRecord move) 
+struct undoRecordTag
 {
-    char piece[BOARD_MAX_LENGTH];
-    
-    strcpy(piece, board[move.from.y][move.from.x]);
-    strcpy(board[move.to.y][move.to.x], piece);
-    strcpy(board[move.from.y][move.from.x], "| _ |");
-}
+    coreMove move;
+    unsigned char slot;                 // hand slot the card was played from
+    unsigned char captured;             // 0 nothing, 1 a student, 2 the sensei
+    unsigned long long hash;            // position hash before the move
+    unsigned long long mirrorHash;      // mirror hash before the move
+    boardMask attacks[2][MAX_CARDS_PER_PLAYER]; // attack maps before the move
+};
 
-/*
-Displays the current board state during replay
+typedef struct undoRecordTag undoRecord;
 
-Precondition:
-    - Board must be properly initialized
+struct ttEntryTag
+{
+    unsigned long long check;           // key XOR data, so a torn or half-written entry never matches
+    unsigned long long data;            // move, score, depth and TT_EXACT/TT_LOWER/TT_UPPER flag, see TT_PACK
+};
 
-@param board The game board to display
-@return Returns no data type (void)
-*/
-void displayReplayBoard(oniBrd board)
+typedef struct ttEntryTag ttEntry;
+
+struct ttFileHeaderTag
 {
-    int i, j;
+    char magic[8];                      // TT_FILE_MAGIC
+    unsigned int version;               // TT_FILE_VERSION, bumped whenever keys or entries change meaning
+    unsigned int ttBits;                // log2 of the number of entries that follow the header
+    unsigned long long cardPrint;       // cardTablePrint of the cards the keys were made with
+    unsigned long long checksum;        // FNV-1a of the fields above
+    char reserved[32];                  // pads the header to 64 bytes so the entries stay aligned
+};
 
-    system("CLS");
-    printf("\n\t\t\t\t\t\t" "\x1b[36m" " O N I T A M A   R E P L A Y " "\x1b[0m" "\n\n");
+typedef struct ttFileHeaderTag ttFileHeader;
 
-    printf("\t\t\t\t ");
-    for (i = 0; i < COLS; i++)
-    {
-        printf("+-------");
-    }
-    printf("+\n");
+struct historyCountTag
+{
+    unsigned long long hash;
+    int count;                          // occurrences of hash in the ring, 0 for an empty slot
+};
 
-    for (i = 0; i < ROWS; i++)
-    {
-        printf("\t\t\t\t ");
-        for (j = 0; j < COLS; j++)
-        {
-            printf("| %s ", board[i][j]);
-        }
-        printf("|\n\t\t\t\t ");
+typedef struct historyCountTag historyCount;
 
-        for (j = 0; j < COLS; j++)
-        {
-            printf("+-------");
-        }
-        printf("+\n");
-    }
-    printf("\n");
-}
-/*
-Plays back all recorded moves in sequence to recreate the game
+struct hashHistoryTag
+{
+    unsigned long long ring[HISTORY_RING]; // hashes of the positions played, oldest overwritten first
+    historyCount counts[HISTORY_SLOTS]; // open addressing with linear probing from the low hash bits
+    int count;                          // positions pushed so far
+    int filled;                         // how many of the latest pushes are still in the ring
+};
 
-Precondition:
-    - replayMoves must contain moveCount valid moves
-    - moveCount must be <= MAX_MOVES
-    - Board display functions must be initialized
+typedef struct hashHistoryTag hashHistory;
 
-@param replayMoves Array containing all recorded moves
-@param moveCount Number of moves in replayMoves array
-@return Returns no data type (void)
-*/
-void replayMovesSequence(MoveRecord* replayMoves, int moveCount)
+struct drawRuleTag
 {
-    oniBrd board;
-    int i;
+    int repetitions;                    // a position seen this many times draws the game, 0 to disable
+    int maxPlies;                       // plies after which the game is adjudicated a draw, at most MAX_MOVES
+};
 
-    resetBoard(board);
-    // Set up initial board state
-    // Player 2 (RED) pieces at top
-    strcpy(board[0][0], "\x1b[31m" "| s |" "\x1b[0m");
-    strcpy(board[0][1], "\x1b[31m" "| s |" "\x1b[0m");
-    strcpy(board[0][2], "\x1b[31m" "| M |" "\x1b[0m");
-    strcpy(board[0][3], "\x1b[31m" "| s |" "\x1b[0m");
-    strcpy(board[0][4], "\x1b[31m" "| s |" "\x1b[0m");
-
-    // Player 1 (BLUE) pieces at bottom
-    strcpy(board[4][0], "\x1b[34m" "| s |" "\x1b[0m");
-    strcpy(board[4][1], "\x1b[34m" "| s |" "\x1b[0m");
-    strcpy(board[4][2], "\x1b[34m" "| M |" "\x1b[0m");
-    strcpy(board[4][3], "\x1b[34m" "| s |" "\x1b[0m");
-    strcpy(board[4][4], "\x1b[34m" "| s |" "\x1b[0m");
-
-    displayReplayBoard(board);
-    printf("Press any key to start replay...");
-    getch();
+typedef struct drawRuleTag drawRule;
 
-    for (i = 0; i < moveCount; i++)
-    {
-        displayReplayBoard(board);
-        printf("Move %d/%d: Player %d used %s\n", i + 1, moveCount,
-               replayMoves[i].player, replayMoves[i].cardName);
-        printf("From: (%d, %d) To: (%d, %d)\n",
-               replayMoves[i].from.x, replayMoves[i].from.y,
-               replayMoves[i].to.x, replayMoves[i].to.y);
+struct gameClockTag
+{
+    int enabled;                        // 0 for an untimed game
+    long long remaining[2];             // microseconds left per side, not counting the running move
+    long long increment;                // microseconds added after each move played in time
+    int running;                        // side whose clock runs, -1 when both are stopped
+    unsigned long long started;         // microTime() when the running clock was started
+};
 
-        applyMove(board, replayMoves[i]);
-        Sleep(1000);
-    }
-    displayReplayBoard(board);
-}
-/*
-Reads HallOfFame data from file and store into str100 storeHoF[]
+typedef struct gameClockTag gameClock;
 
-Precondition:
-    - HallOfFame.txt must exist
-    - storeHoF array must be allocated
+struct searchStatsTag
+{
+    unsigned long long ttProbes;
+    unsigned long long ttHits;          // probes that found the position
+    unsigned long long ttCutoffs;       // hits whose bound ended the node without a search
+    unsigned long long cutoffs;         // nodes that failed high
+    unsigned long long firstCutoffs;    // of those, the ones cut by the first move tried
+    unsigned long long iterNodes[MAX_SEARCH_DEPTH + 1]; // nodes of each iteration
+    unsigned long long iterMicros[MAX_SEARCH_DEPTH + 1]; // time of each iteration
+    unsigned long long micros;          // time of the whole search
+};
 
-@param storeHoF Array to store HallOfFame entries
-@return Returns no data type (void)
-*/
-void readHoF(str100 storeHoF[])
+typedef struct searchStatsTag searchStats;
+
+struct searchTraceTag
 {
-    FILE *fp = fopen("HallOfFame.txt", "r");
-    int i;
+    FILE *fp;
+    int chrome;                         // 1 for Chrome trace events, 0 for a nested JSON tree
+    int maxPly;                         // nodes deeper than this are left out
+    int level;                          // nodes currently open
+    int first[MAX_SEARCH_DEPTH + 2];    // nothing written yet at this level, for the commas
+    unsigned long long nodes[MAX_SEARCH_DEPTH + 2]; // node counter when each open node began
+    unsigned long long start;           // microTime() at the start of the trace
+};
 
-    if (fp != NULL) // file must Exist
-    {
-        for(i=0; i < MAX_LEAD_LINES; i++)
-            fscanf(fp, "%s", storeHoF[i]); 
+typedef struct searchTraceTag searchTrace;
 
-        fclose(fp);
-    }
-}
+struct evalWeightsTag
+{
+    int weight[EVAL_FEATURES];          // per feature, indexed by EVAL_MATERIAL ...
+};
 
-/*
-Creates and returns a Position structure with specified coordinates
+typedef struct evalWeightsTag evalWeights;
 
-Precondition:
-    - x and y must be valid board coordinates (0 <= x < COLS, 0 <= y < ROWS)
+struct nnueHeaderTag
+{
+    char magic[8];                      // NNUE_MAGIC
+    unsigned int version;
+    unsigned int inputs;                // NNUE_INPUTS of the board size the network was trained for
+    unsigned int hidden;                // NNUE_HIDDEN
+    int divisor;                        // output sum per unit of score
+    int outputBias;
+};                                      // followed by short featureBias[hidden], short featureWeights[inputs][hidden]
+                                        // and signed char outputWeights[2 * hidden], all little-endian
+
+typedef struct nnueHeaderTag nnueHeader;
+
+struct nnueNetTag
+{
+    int loaded;                         // 0 when there is no network, evaluateState is used instead
+    int divisor;
+    int outputBias;
+    short featureBias[NNUE_HIDDEN];
+    short featureWeights[NNUE_INPUTS][NNUE_HIDDEN]; // what each input feature adds to the accumulator
+    short outputWeights[2 * NNUE_HIDDEN]; // side to move's half first, widened from the file's int8
+};
 
-@param x The column coordinate (0-based)
-@param y The row coordinate (0-based)
-@return Returns a Position struct with the specified coordinates
-*/
-Position makePosition(int x, int y) 
+typedef struct nnueNetTag nnueNet;
+
+struct nnueAccumulatorTag
 {
-    Position p;
-    
-    p.x = x;
-    p.y = y;
+    short values[2][NNUE_HIDDEN];       // first layer sums seen from side 0 and from side 1
+};
 
-    return p;
-}
+typedef struct nnueAccumulatorTag nnueAccumulator;
 
-/*
-Reads move cards file and store data into str30 moveDeck[]
+struct searchTag
+{
+    cardInfo *cards;
+    zobristKeys *keys;
+    ttEntry *table;
+    unsigned long long ttMask;
+    HANDLE ttFile;                      // file the table is mapped from, NULL for a table in memory
+    HANDLE ttMapping;
+    ttFileHeader *ttView;
+    unsigned long long nodes;
+    unsigned long long deadline;        // performance counter value to stop at, see counterDeadline
+    int stopped;
+    hashHistory history;                // positions played before the root, then the current search path
+    searchStats stats;                  // counters of the last searchPosition
+    searchTrace *trace;                 // NULL unless the tree is being traced
+    evalWeights weights;                // evaluation weights, read from EVAL_FILE
+    nnueNet net;                        // network read from NNUE_FILE, used instead of weights when loaded
+    nnueAccumulator accumulators[MAX_SEARCH_DEPTH + 2]; // of the position at each ply of the search path
+};
 
-Precondition:
-    - movecards.txt must exist and be properly formatted
-    - moveDeck array must be allocated
-    - cardCount pointer must be valid
+typedef struct searchTag searchContext;
 
-@param moveDeck Array to store loaded card names
-@param cardCount Pointer to store number of cards loaded
-@return Returns no data type (void)
-*/
-int readMoveCards(str30 moveDeck[], int *cardCount) 
+struct searchResultTag
 {
-    int i;
-    FILE *fp;
-    int status = 0;
-    
-    fp = fopen("movecards.txt", "r");
+    coreMove best;
+    int score;
+    int depth;                          // deepest completed iteration
+    unsigned long long nodes;
+};
 
-    if (fp != NULL) 
-    {
-        if(fscanf(fp, "%d", cardCount)==1)
-        {
-            status = 1;
-            for (i = 0; i < *cardCount; i++) 
-            {
-                fscanf(fp, "%s", moveDeck[i]);
-            }
-        }
-    
-    fclose(fp);
-    }
-    else
-        printf("Error: Cannot open file %s\n", "movecards.txt");
-    
-    return status;
-}
+typedef struct searchResultTag searchResult;
 
-/*
-Shuffles all the cards before the Game starts and before the player draws
+struct pvLineTag
+{
+    int score;                          // from the side to move's point of view
+    int length;                         // moves in the variation, at least the root move
+    coreMove moves[MAX_PV_LEN];
+};
 
-Precondition: moveDeck must be initialized with cardCount valid strings, 
-              and cardCount must be a positive integer less than or equal 
-              to the size of moveDeck. int cardCount is > 0
+typedef struct pvLineTag pvLine;
 
-@param moveDeck: 1D array of strings that stores the name of the cards, Its needed in the function because the
-       functions purpose is to shuffle all the cards before the player draws
+struct analysisPanelTag
+{
+    int lineCount;                      // rows in use, 0 leaves the panel out
+    char text[ROWS][MAX_PANEL_TEXT];
+};
 
-@param cardCount: the number of cards in moveDeck that should be shuffled 
-@return Returns no data type (void)
-*/
-void shuffleCards(str30 moveDeck[], int cardCount) 
+typedef struct analysisPanelTag analysisPanel;
+
+struct pnNodeTag
 {
-    int i, j, k;
-    str30 temp;
+    gameState state;
+    unsigned long long hash;
+    unsigned int proof;                 // leaves the attacker still has to win, 0 once proven
+    unsigned int disproof;              // leaves the defender still has to hold, 0 once disproven
+    int parent;                         // pool index, -1 for the root
+    int child;                          // first child, -1 while unexpanded; only the winning line survives a proof
+    int sibling;                        // next child of the parent, or next free node in the pool
+    int distance;                       // plies to the win along the kept line once proven
+    coreMove move;                      // move that led here from the parent
+};
 
-    for(i = 0; i < cardCount; i++) // Loops n of cardCount times
-    {
-        j = rand() % cardCount; // Two variables that generates two random numbers
-        k = rand() % cardCount;
+typedef struct pnNodeTag pnNode;
 
-        strcpy(temp, moveDeck[k]);
-        strcpy(moveDeck[k], moveDeck[j]);
-        strcpy(moveDeck[j], temp);
-    }
-} 
+struct pnSolverTag
+{
+    pnNode *nodes;                      // fixed pool, the tree never grows past capacity
+    int capacity;
+    int freeList;
+    int used;
+    int peak;
+    int root;
+    int attacker;                       // side trying to force the win
+    int stopped;                        // set when the pool or the time limit runs out
+    unsigned long long expansions;
+    unsigned long long deadline;        // performance counter value to stop at, see counterDeadline
+    cardInfo *cards;
+    zobristKeys *keys;
+};
 
-/*
-Distributes the first 5 index of moveDeck cards to players and sets up the initial game cards
+typedef struct pnSolverTag pnSolver;
 
-Precondition: 
-    - moveDeck must contain at least 5 initialized card strings
-    - p1 and p2 must be valid player pointers with properly allocated card arrays
-    - crdsIG must be a valid dataCrdsIG pointer
-    - moveDeck must have been previously shuffled
+struct puzzleJobTag
+{
+    cardInfo *cards;
+    int cardCount;
+    zobristKeys *keys;
+    FILE *out;
+    int target;                         // puzzles to find
+    int plies;                          // length of the forced win, odd
+    unsigned long long baseSeed;        // game g is simulated from baseSeed + g
+    LONG maxGames;                      // 0 for no limit
+    volatile LONG nextGame;
+    volatile LONG found;
+    volatile LONG candidates;           // positions that passed the cheap screen
+    volatile LONG64 positions;          // positions screened
+    unsigned long long *seen;           // canonical keys of accepted puzzles, open addressing
+    unsigned long long seenMask;
+    CRITICAL_SECTION lock;              // guards seen, out and stdout
+};
 
-@param str30 moveDeck[] Array containing the shuffled deck of cards to distribute
-@param *p1 Pointer to player 1's data structure to receive their cards
-@param *p2 Pointer to player 2's data structure to receive their cards
-@param *crdsIG Pointer to game card data structure for initial setup
-@return Returns no data type (void)
-*/
-void assignMoveCards(str30 moveDeck[], player *p1, player *p2, dataCrdsIG *crdsIG) 
+typedef struct puzzleJobTag puzzleJob;
+
+struct surveyQueueTag
 {
-    int i, j;
-    char filename[MAX_FILENAME_LEN];
-    FILE *fp;
+    int begin;                          // next pending slot the owner takes
+    int end;                            // one past the last slot, thieves take the upper half
+    CRITICAL_SECTION lock;
+};
 
-    // Assigns the first 4 cards to player 1 and 2 and the fifth card in the index of movedeck to the rightcard or middle card
-    strcpy(p1->card.playercard[0], moveDeck[0]);
-    strcpy(p1->card.playercard[1], moveDeck[1]);
+typedef struct surveyQueueTag surveyQueue;
 
-    strcpy(p2->card.playercard[0], moveDeck[2]);
-    strcpy(p2->card.playercard[1], moveDeck[3]);
+struct surveyJobTag
+{
+    cardInfo *cards;
+    zobristKeys *keys;
+    int (*sets)[MAX_CARD_PER_GAME];     // every five-card set, ascending card ids
+    int dealCount;                      // sets times DEAL_ARRANGEMENTS
+    int *pending;                       // deals missing from the checkpoint
+    int *scores;                        // per deal, from Player 1's point of view
+    int depth;
+    int workers;
+    int completed;                      // deals in the checkpoint, guarded by lock
+    volatile LONG nextWorker;
+    surveyQueue queues[MAX_THREADS];
+    FILE *checkpoint;
+    CRITICAL_SECTION lock;              // guards checkpoint, scores and completed
+};
 
-    strcpy(crdsIG->lCardName, "None"); // Initializes the left card
-    strcpy(crdsIG->rCardName, moveDeck[4]);
+typedef struct surveyJobTag surveyJob;
 
-    // loops through the max cards a player can hold in this instance for player 1
-    for (i = 0; i < MAX_CARDS_PER_PLAYER; i++)
-    {
-        strcpy(filename, p1->card.playercard[i]); // assigns the name of the move card to a variable filename
-        strcat(filename, ".txt"); 
-        fp = fopen(filename, "r");
-        
-        if (fp != NULL) 
-        {
-            for (j = 0; j < TEXT_FILE_ROWS; j++) // loops 6 times since the txt file is 6X5 row 1 being the color of the card
-                fscanf(fp, "%s", p1->card.visualCard[i][j]);
+struct workUnitTag
+{
+    int first;                          // first game number or input line of the unit
+    int count;
+    int state;                          // UNIT_PENDING, UNIT_ASSIGNED or UNIT_DONE
+    char *output;                       // results once done, released after writing
+};
 
-            fclose(fp); 
-        }
-        else
-        {
-            printf("Error: Cannot open file %s\n", filename);
-            Sleep(1000);
-        }
-    }
+typedef struct workUnitTag workUnit;
 
-    // loops through the max cards a player can hold in this instance for player 2
-    for (i = 0; i < MAX_CARDS_PER_PLAYER; i++)
-    {
-        strcpy(filename, p2->card.playercard[i]); // assigns the name of the move card to a variable filename
-        strcat(filename, ".txt"); 
-        fp = fopen(filename, "r");
+struct workerLinkTag
+{
+    SOCKET sock;                        // INVALID_SOCKET for a free slot
+    int unit;                           // unit being worked on, -1 when idle
+    unsigned long long assignedAt;      // GetTickCount64() when the unit was sent
+    char *received;                     // results of the current unit so far
+    size_t length;
+    size_t capacity;
+};
 
-        if (fp != NULL) 
-        {
-            for (j = 0; j < TEXT_FILE_ROWS; j++) // loops 6 times since the txt file is 6X5 row 1 being the color of the card
-                fscanf(fp, "%s", p2->card.visualCard[i][j]);
+typedef struct workerLinkTag workerLink;
 
-            fclose(fp);
-        }
-        else
-        {
-            printf("Error: Cannot open file %s\n", filename);
-            Sleep(1000); 
-        }
-    }
+struct coordinatorTag
+{
+    int analyze;                        // 1 for analysis units, 0 for self-play units
+    char (*lines)[MAX_POSITION_LEN];    // analysis input
+    workUnit *units;
+    int unitCount;
+    int doneCount;
+    int nextWrite;                      // results are written in unit order
+    unsigned long long baseSeed;        // game g is played from baseSeed + g
+    int depth;
+    int timeMs;
+    unsigned long long timeoutMs;       // a unit held longer is reissued, 0 for no limit
+    drawRule rule;
+    workerLink links[MAX_WORKER_LINKS];
+    FILE *out;
+};
 
-    // assigns the name of the move card to a variable filename for this instance the middle card or rightcard
-    strcpy(filename, crdsIG->rCardName); // assigns the name of the move card to a variable filename
-    strcat(filename, ".txt"); 
-    fp = fopen(filename, "r");
-    
-    if (fp != NULL) 
-    {
-        for (i = 0; i < TEXT_FILE_ROWS; i++) // loops 6 times since the txt file is 6X5 row 1 being the color of the card
-            fscanf(fp, "%s", crdsIG->rCardDisp[i]); 
+typedef struct coordinatorTag coordinator;
 
-        fclose(fp);
-    }   
-    else
-    {
-        printf("Error: Cannot open file %s\n", filename);
-        Sleep(1000); 
-    }
+struct netReaderTag
+{
+    SOCKET sock;
+    char buffer[NET_BUFFER];
+    int start;                          // first unread byte
+    int end;                            // one past the last received byte
+};
 
-    for(i=0;i<TEXT_FILE_ROWS;i++) // initializes the left card for displaying otherwise it would display null chars
-        strcpy(crdsIG->lCardDisp[i], ".....");
-}
+typedef struct netReaderTag netReader;
 
-/*
-Checks the win condition by verifying if either player's Sensei piece has reached
-the opponent's temple or if a Sensei has been captured
+struct spectateEventTag
+{
+    volatile LONG64 sequence;           // event number + 1 once the slot is complete, 0 while it is written
+    int kind;                           // SPECTATE_START, SPECTATE_MOVE, SPECTATE_UNDO or SPECTATE_RESULT
+    int winner;                         // SPECTATE_RESULT: 1 or 2, 0 for a draw
+    MoveRecord move;                    // SPECTATE_MOVE
+    str30 deal[MAX_CARD_PER_GAME];      // SPECTATE_START: P1, P1, P2, P2, neutral
+    str30 names[2];                     // SPECTATE_START
+};
 
-Precondition: 
-    - Board must be properly initialized with valid positions
-    - Player structures must contain valid Sensei piece identifiers
-    - ROWS and COLS must match board dimensions
+typedef struct spectateEventTag spectateEvent;
 
-@param board The game board array to check for win conditions
-@param *p1 Pointer to player 1's data structure
-@param *p2 Pointer to player 2's data structure
-@return Returns 1 if player 1 wins, 2 if player 2 wins, 0 if no winner yet
-*/
-int checkWinCondition(oniBrd board, player *p1, player *p2) 
+struct spectateRingTag
 {
-    int i, j;
-    int result = 0;
-    int p1SenseiFound = 0;
-    int p2SenseiFound = 0;
-    
-    //checks if the player 1 sensei is on the temples arch, vice versa
-    if (strcmp(board[0][COLS/2], p1->pPiece.sensei) == 0) 
-        result = 1;
+    char magic[8];                      // SPECTATE_MAGIC
+    int version;
+    volatile LONG closed;               // the broadcasting process has exited
+    volatile LONG64 head;               // events published so far, event n lives in slot n % SPECTATE_SLOTS
+    spectateEvent events[SPECTATE_SLOTS];
+};
 
-    else if (strcmp(board[ROWS-1][COLS/2], p2->pPiece.sensei) == 0) 
-        result = 2;
-    
-    //loops through the whole board to check if a sensei exists
-    if (result == 0) 
-    {
-        for (i = 0; i < ROWS; i++) 
-        {
-            for (j = 0; j < COLS; j++) 
-            {
-                if (strcmp(board[i][j], p1->pPiece.sensei) == 0) 
-                    p1SenseiFound = 1;
-        
-                if (strcmp(board[i][j], p2->pPiece.sensei) == 0) 
-                    p2SenseiFound = 1;
-            }
-        }
-        
-        //if the p1 sensei is not found in any of the board and is still 0 means player 2 won, 
-        // otherwise if p2 sensei is not found p1 won, otherwise result is 0 and the game will continue
-        if (!p1SenseiFound) 
-            result = 2;
+typedef struct spectateRingTag spectateRing;
 
-        else if (!p2SenseiFound) 
-            result = 1;
-    }
-    return result;
-}
+struct terminalTag
+{
+    FILE *script;                       // recorded keystrokes, NULL to read the keyboard
+    int pending;                        // second code of a scripted arrow key, 0 if none
+    int headless;                       // no screen clears or pauses, output goes to the sink
+    unsigned long long lastKey;         // microTime() when the previous key was handed out, 0 before the first
+    unsigned long long *latencies;      // microseconds from each key to the next read, NULL when not measuring
+    int latencyCount;
+    int latencyCapacity;
+    spectateRing *broadcast;            // shared ring the games are published to, NULL if not broadcasting
+    HANDLE broadcastMapping;
+    int showThreats;                    // mark the pieces the opposing cards attack, toggled with T
+};
+
+typedef struct terminalTag terminal;
+
+struct analysisJobTag
+{
+    char (*lines)[MAX_POSITION_LEN];
+    char (*results)[MAX_RESULT_LEN];
+    volatile LONG *done;                // set under lock once results[i] is written
+    int count;
+    volatile LONG next;                 // next line to hand out
+    int depth;
+    int timeMs;
+    int stats;                          // append search statistics to every result
+    int multiPV;                        // best moves reported per position, 1 for the plain result
+    const char *ttFile;                 // transposition table file shared by the workers, NULL for none
+    int ttBits;
+    cardInfo *cards;
+    int cardCount;
+    zobristKeys *keys;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE finished;
+};
+
+typedef struct analysisJobTag analysisJob;
+
+struct gameRecordTag
+{
+    unsigned long long seed;
+    int deal[MAX_CARD_PER_GAME];        // card ids: P1, P1, P2, P2, neutral
+    str30 names[2];
+    int winner;                         // 1 or 2, 0 when the game was cut off
+    int length;
+    coreMove moves[MAX_MOVES];
+};
+
+typedef struct gameRecordTag gameRecord;
+
+struct dbHeaderTag
+{
+    char magic[8];                      // DB_MAGIC
+    unsigned int version;
+    unsigned int boardSize;
+    unsigned int cardCount;
+    unsigned int blockCount;
+    unsigned long long gameCount;
+    unsigned long long directoryOffset; // file offset of blockCount dbBlock entries
+    char cardNames[MAX_CARDS][MAX_NAME_LEN + 1];
+};
+
+typedef struct dbHeaderTag dbHeader;
+
+struct dbBlockTag
+{
+    unsigned int gameCount;
+    unsigned int moveBytes;
+    unsigned long long firstGame;       // game id of the block's first game
+    unsigned long long seedOffset;      // u64 per game
+    unsigned long long dealOffset;      // MAX_CARD_PER_GAME u8 columns, one per deal slot
+    unsigned long long firstOffset;     // u8 side that moved first
+    unsigned long long winnerOffset;    // u8 winner (0 none, 1, 2)
+    unsigned long long lengthOffset;    // u16 plies
+    unsigned long long moveIndexOffset; // u32 per game + 1, start of each game in the move column
+    unsigned long long movesOffset;     // u8 per ply: index of the move in generateMoves order
+    unsigned long long namesOffset;     // two u16 columns, player 1's then player 2's entry in the name table
+    unsigned long long nameTableOffset; // nameCount distinct names of MAX_NAME_LEN + 1 bytes
+    unsigned int nameCount;
+    unsigned int spare;                 // keeps the directory entries 8-byte aligned
+};
+
+typedef struct dbBlockTag dbBlock;
+
+struct gameDbTag
+{
+    HANDLE file;
+    HANDLE mapping;
+    const unsigned char *base;
+    const dbHeader *header;
+    const dbBlock *blocks;
+    int cardMap[MAX_CARDS];             // database card id to card table id
+};
+
+typedef struct gameDbTag gameDb;
+
+struct dbQueryJobTag
+{
+    gameDb *db;
+    volatile LONG nextBlock;
+    volatile LONG nextThread;           // hands each worker its slot in the totals below
+    int neutralCard;                    // database card id to filter on, -1 for every game
+    unsigned long long games[MAX_THREADS];
+    unsigned long long firstWins[MAX_THREADS];
+    unsigned long long (*setLength)[2]; // per thread: 1 << MAX_CARDS sets of {plies, games}
+};
+
+typedef struct dbQueryJobTag dbQueryJob;
+
+struct dbWriterTag
+{
+    FILE *fp;
+    unsigned long long offset;          // bytes written so far
+    dbHeader header;
+    dbBlock *blocks;
+    int blockCapacity;
+    int count;                          // games in the block being filled
+    unsigned long long seed[DB_BLOCK_GAMES];
+    unsigned char deal[MAX_CARD_PER_GAME][DB_BLOCK_GAMES];
+    unsigned char first[DB_BLOCK_GAMES];
+    unsigned char winner[DB_BLOCK_GAMES];
+    unsigned short length[DB_BLOCK_GAMES];
+    unsigned int moveIndex[DB_BLOCK_GAMES + 1];
+    unsigned char moves[DB_BLOCK_GAMES * MAX_MOVES];
+    unsigned short names[2][DB_BLOCK_GAMES];
+    str30 nameTable[2 * DB_BLOCK_GAMES]; // the block's distinct names
+    int nameCount;
+    unsigned short nameSlots[DB_NAME_SLOTS]; // name table index + 1 by name hash, 0 for an empty slot
+};
+
+typedef struct dbWriterTag dbWriter;
+
+struct convertSlotTag
+{
+    LONG item;                          // work item whose result the slot holds, -1 while it has none
+    gameRecord *games;                  // import: the chunk's legal games in file order
+    unsigned char (*ordinals)[MAX_MOVES]; // import: each game's moves as generateMoves indexes
+    int count;
+    int capacity;
+    char *text;                         // export: the block's games in the GameLog.txt format
+    unsigned long long length;
+    unsigned long long textCapacity;
+    unsigned long long skipped;         // malformed games and games with an illegal move
+};
+
+typedef struct convertSlotTag convertSlot;
+
+struct convertJobTag
+{
+    cardInfo *cards;
+    int cardCount;
+    const char *text;                   // import: the mapped input file
+    unsigned long long *bounds;         // import: chunk k runs from text + bounds[k] to text + bounds[k + 1]
+    const gameDb *db;                   // export: the mapped database, one work item per block
+    int itemCount;
+    volatile LONG nextItem;
+    LONG written;                       // items the writer has taken, guarded by lock
+    int slotCount;                      // work items in flight at most, item k uses slots[k % slotCount]
+    convertSlot *slots;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE changed;         // a slot was filled or emptied
+};
+
+typedef struct convertJobTag convertJob;
+
+struct indexHeaderTag
+{
+    char magic[8];                      // INDEX_MAGIC
+    unsigned int version;
+    unsigned int boardSize;
+    unsigned long long entryCount;
+    unsigned long long gameCount;       // games of the database the index was built from
+};
+
+typedef struct indexHeaderTag indexHeader;
+
+struct indexEntryTag
+{
+    unsigned long long hash;            // hashState of the position, entries are sorted by it
+    unsigned int game;                  // game id in the database
+    unsigned short ply;                 // plies played before the position was reached
+    unsigned char winner;               // how that game ended, so queries need not open the database
+    unsigned char spare;
+};
+
+typedef struct indexEntryTag indexEntry;
+
+struct indexBuildJobTag
+{
+    gameDb *db;
+    cardInfo *cards;
+    zobristKeys *keys;
+    volatile LONG nextBlock;
+    volatile LONG nextThread;
+    indexEntry *runs[MAX_THREADS];      // each worker's entries, sorted by the worker
+    unsigned long long runLength[MAX_THREADS];
+};
+
+typedef struct indexBuildJobTag indexBuildJob;
+
+struct sampleHeaderTag
+{
+    char magic[8];                      // SAMPLE_MAGIC
+    unsigned int version;
+    unsigned int featureCount;          // EVAL_FEATURES of the program that wrote the file
+    unsigned long long sampleCount;
+};
+
+typedef struct sampleHeaderTag sampleHeader;
+
+struct evalSampleTag
+{
+    short feature[EVAL_FEATURES];       // evalFeatures of the position
+    unsigned char result;               // for the side to move: 0 lost, 1 undecided, 2 won
+    unsigned char spare;
+};
+
+typedef struct evalSampleTag evalSample;
+
+struct tuneExtractJobTag
+{
+    gameDb *db;
+    cardInfo *cards;
+    volatile LONG nextBlock;
+    volatile LONG nextThread;
+    evalSample *runs[MAX_THREADS];      // each worker's samples
+    unsigned long long runLength[MAX_THREADS];
+};
+
+typedef struct tuneExtractJobTag tuneExtractJob;
+
+struct tuneJobTag
+{
+    const evalSample *samples;          // the mapped sample file
+    unsigned long long count;
+    double weight[EVAL_FEATURES];       // weights of the current pass
+    double scale;                       // K ln(10) / 400, the slope of the logistic
+    volatile LONG nextChunk;            // next TUNE_CHUNK samples to hand out
+    volatile LONG nextThread;
+    double loss[MAX_THREADS];           // per worker: squared error ...
+    double gradient[MAX_THREADS][EVAL_FEATURES]; // ... and its gradient
+};
+
+typedef struct tuneJobTag tuneJob;
+
+struct moveShiftsTag
+{
+    // MAX_CARD_SHIFTS entries per card and side at (card * 2 + side) * MAX_CARD_SHIFTS,
+    // unused entries have no origins
+    boardMask origins[MAX_CARDS * 2 * MAX_CARD_SHIFTS]; // squares that move by the distance
+    int distance[MAX_CARDS * 2 * MAX_CARD_SHIFTS];      // destination minus origin square
+    int left[MAX_CARDS * 2 * MAX_CARD_SHIFTS];          // the distance as two shifts, one of them 0
+    int right[MAX_CARDS * 2 * MAX_CARD_SHIFTS];
+    int count;                                          // most entries used by any card
+};
+
+typedef struct moveShiftsTag moveShifts;
+
+struct gameBatchTag
+{
+    // one column per field, one entry per game; the side to move is always in the own columns
+    boardMask own[SIM_BATCH];
+    boardMask other[SIM_BATCH];
+    int ownMaster[SIM_BATCH];           // square of each sensei, -1 once captured
+    int otherMaster[SIM_BATCH];
+    int ownHand[MAX_CARDS_PER_PLAYER][SIM_BATCH];
+    int otherHand[MAX_CARDS_PER_PLAYER][SIM_BATCH];
+    int neutral[SIM_BATCH];
+    int side[SIM_BATCH];                // side to move, 0 is Player 1
+    int plies[SIM_BATCH];
+    int winner[SIM_BATCH];              // 1 or 2 once the game is won
+    unsigned int random[SIM_BATCH];     // xorshift32 state of each game
+    int game[SIM_BATCH];                // game playing in the lane, -1 for an idle lane
+    unsigned long long hash[SIM_BATCH]; // hashState value of each position
+    int reversible[SIM_BATCH];          // positions in the lane's history row
+    unsigned long long seen[SIM_BATCH]; // bit hash >> 58 of every position in the row, the row is scanned on a hit
+    int repeated[SIM_BATCH];            // 1 once the position has come up repetitions times
+    unsigned long long history[SIM_BATCH][MAX_MOVES]; // per game, the positions since the last capture
+    int repetitions;                    // from the draw rule, 0 when repetitions are not adjudicated
+    zobristKeys keys;
+    moveShifts shifts;
+};
+
+typedef struct gameBatchTag gameBatch;
+
+struct ratingEntryTag
+{
+    char name[MAX_NAME_LEN];
+    double rating;
+    int games;
+    int wins;
+    int draws;
+    int losses;
+};
+
+typedef struct ratingEntryTag ratingEntry;
+
+struct ratingTableTag
+{
+    ratingEntry *entries;
+    int count;
+    int capacity;
+    int *slots;                         // open-addressed name index into entries, -1 when empty
+    unsigned int slotMask;              // slot count - 1, kept at least twice capacity
+};
+
+typedef struct ratingTableTag ratingTable;
+
+struct ratingGameTag
+{
+    int players[2];                     // entries of Player 1 and Player 2
+    int score;                          // Player 1's result in half points: 2 win, 1 draw, 0 loss
+};
+
+typedef struct ratingGameTag ratingGame;
+
+struct ratingLineTag
+{
+    char *names[2];                     // cut out of the results text in place
+    int score;
+};
+
+typedef struct ratingLineTag ratingLine;
+
+struct ratingJobTag
+{
+    char *text;                         // the whole results file, terminated
+    long bounds[MAX_THREADS + 1];       // byte range each worker parses, cut at line ends
+    ratingLine *lines[MAX_THREADS];     // each worker's parsed lines, in file order
+    int lineCount[MAX_THREADS];
+    int badLines[MAX_THREADS];
+    volatile LONG nextThread;
+    ratingTable *table;
+    const ratingGame *games;
+    int first;                          // first game of the period being rated
+    int count;                          // games in the period
+    volatile LONG nextChunk;
+    double *delta;                      // per worker, every player's score minus expected score this period
+    double *information;                // per worker, every player's sum of E * (1 - E) this period
+    int *order;                         // game indexes grouped by component of players, in file order within one
+    int *componentStart;                // componentCount + 1 offsets into order
+    int componentCount;
+    volatile LONG nextComponent;
+};
+
+typedef struct ratingJobTag ratingJob;
 
 /*
-Checks if a character is alphabetic
+Reads the high resolution clock
 
-Precondition: 
-    - Input must be a single character
+Precondition:
+    - none
 
-@param name The character to check
-@return Returns 1 if character is alphabetic, 0 otherwise
+@return Returns microseconds since an arbitrary starting point
 */
-int isAlpha (char name)
+unsigned long long microTime(void)
 {
-    return (name >= 'A' && name <= 'Z') || (name >= 'a' && name <= 'z');
+    LARGE_INTEGER now, frequency;
+
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (unsigned long long) (now.QuadPart / frequency.QuadPart * 1000000 +
+                                 now.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
 }
 
 /*
-Validates if the selected piece belongs to the current player
+Converts a time limit into the performance counter value at which it runs out, so the search can
+test it with a single counter read and no division
 
-Precondition: 
-    - Board coordinates must be within valid range
-    - Player turn must be either 0 or 1
-    - Board must be properly initialized
+Precondition: None
 
-@param *currentPlayer Pointer to the current player's data
-@param board The game board array
-@param fromRow Source row coordinate
-@param fromCol Source column coordinate
-@param playerTurn Current player's turn indicator (0 or 1)
-@return Returns 1 if piece is valid for current player, 0 otherwise
+@param micros Time from now in microseconds, 0 or less for no limit
+@return Returns the counter value to stop at, 0 for no limit
 */
-int isValidpiece(player *currentPlayer, oniBrd board, int fromRow, int fromCol, int playerTurn)
+unsigned long long counterDeadline(long long micros)
 {
-    int result = 0;
+    LARGE_INTEGER now, frequency;
+    unsigned long long deadline = 0;
 
-    if(playerTurn == 0)
-    {
-        if (strcmp(board[fromRow][fromCol], "\x1b[34m" "| M |" "\x1b[0m") == 0 || //checks if the selected piece is itself from the current player
-            strcmp(board[fromRow][fromCol], "\x1b[34m" "| s |" "\x1b[0m") == 0)
-            result = 1;
-    }
-    else
+    if (micros > 0)
     {
-        if (strcmp(board[fromRow][fromCol], "\x1b[31m" "| M |" "\x1b[0m") == 0||
-            strcmp(board[fromRow][fromCol], "\x1b[31m" "| s |" "\x1b[0m") == 0)
-            result = 1;
+        QueryPerformanceCounter(&now);
+        QueryPerformanceFrequency(&frequency);
+        deadline = (unsigned long long) now.QuadPart + (unsigned long long) (micros / 1000000 * frequency.QuadPart +
+                   micros % 1000000 * frequency.QuadPart / 1000000);
     }
-    return result;
+    return deadline;
 }
 
 /*
-Validates if a desired move follows the game rules and card pattern
-
-Precondition: 
-    - Selected card must be valid (0 or 1)
-    - Board and player structures must be properly initialized
-
-@param *currentPlayer Pointer to the current player's data
-@param board The game board array
-@param fromRow Source row coordinate
-@param fromCol Source column coordinate
-@param toRow Destination row coordinate
-@param toCol Destination column coordinate
-@param playerTurn Current player's turn indicator (0 or 1)
-@param selectedCard Which of the player's cards is being used (0 or 1)
-@return Returns 1 if move is valid, 0 otherwise
-*/
-int isValidMove(player *currentPlayer, oniBrd board, int fromRow, int fromCol,
-                int toRow, int toCol, int playerTurn, int selectedCard)
-{
-    int isValidMovement = 0;
-    int isSamePosition = 0;
-    int isOccupiedByOwnPiece = 0;
-    int rowDisplacement = toRow - fromRow;
-    int columnDisplacement = toCol - fromCol;
-    int cardPatternRow = 0;
-    int cardPatternColumn = 0;
-    int isPatternMatch = 0;
-    int outofBounds = 0;
-
-    isSamePosition = (fromRow == toRow) && (fromCol == toCol);
-
-    if (playerTurn == 1)
-        rowDisplacement *= -1;
-
-    cardPatternRow = VISUAL_CARD_CENTER + rowDisplacement + 1;
-    cardPatternColumn = VISUAL_CARD_CENTER + columnDisplacement;
-
-    if (cardPatternRow < 0 || cardPatternRow >= TEXT_FILE_ROWS ||
-        cardPatternColumn < 0 || cardPatternColumn >= COLS)
-        outofBounds = 1;
-
-    if (playerTurn == 0)
-        isOccupiedByOwnPiece = (strcmp(board[toRow][toCol], "\x1b[34m" "| s |" "\x1b[0m") == 0 || strcmp(board[toRow][toCol], "\x1b[34m" "| M |" "\x1b[0m") == 0);
-    else
-        isOccupiedByOwnPiece = (strcmp(board[toRow][toCol], "\x1b[31m" "| s |" "\x1b[0m") == 0 || strcmp(board[toRow][toCol], "\x1b[31m" "| M |" "\x1b[0m") == 0);
+Checks a deadline from counterDeadline
 
-    if (!outofBounds)
-        isPatternMatch = currentPlayer->card.visualCard[selectedCard][cardPatternRow][cardPatternColumn] == 'x';
+Precondition: None
 
-    if (!isSamePosition && !isOccupiedByOwnPiece && isPatternMatch)
-        isValidMovement = 1;
+@param deadline The counter value to stop at, 0 for no limit
+@return Returns 1 once the counter has reached deadline, 0 before it or when there is no limit
+*/
+int deadlinePassed(unsigned long long deadline)
+{
+    LARGE_INTEGER now;
 
-    return isValidMovement;
+    QueryPerformanceCounter(&now);
+    return deadline != 0 && (unsigned long long) now.QuadPart >= deadline;
 }
+
 /*
-Checks if the current player has any valid moves available using the selected card. Iterates through all possible cards, 
-board positions, and potential moves to determine if there exists at least one valid move for the current player's pieces.
-Precondition: 
+Notes that the UI asks for input: the time since the previous key was handed out is that key's
+processing latency, screen output included
 
-- The board must be properly initialized
-- currentPlayer must point to a valid player structure
-- playerTurn must be either 1 (RED) or 2 (BLUE)
-@param currentPlayer Pointer to the current player's data (including their cards)
-@param board The game board represented as a 2D array
-@param playerTurn Indicates which player's turn it is (1 for RED, 2 for BLUE)
-@param selectedCard Which of the player's cards is being used (0 or 1)
-@return 1 if at least one valid move exists for the current player, 0 otherwise
- */
-int hasAnyValidMove(player *currentPlayer, oniBrd board, int playerTurn)
+Precondition:
+    - term must be set up
+
+@param term The terminal
+@return Returns no data type (void)
+*/
+void inputRequested(terminal *term)
 {
-    int novalidMove = 0;
-    int toCol;
-    int toRow;
-    int fromRow;
-    int fromCol;
-    int nCard;
+    unsigned long long *grown;
 
-    for(nCard = 0; nCard < MAX_CARD_PER_GAME; nCard++)
+    if (term->latencies != NULL && term->lastKey != 0)
     {
-        // loops all the possible positions in the array
-        for(fromRow = 0; fromRow < ROWS; fromRow++)
+        if (term->latencyCount == term->latencyCapacity)
         {
-            for(fromCol = 0; fromCol < COLS; fromCol++)
+            grown = realloc(term->latencies, (term->latencyCapacity * 2 + 1024) * sizeof(unsigned long long));
+            if (grown != NULL)
             {
-                if(playerTurn == 1)
-                {
-                    if(strcmp(board[fromRow][fromCol], "\x1b[31m" "| s |" "\x1b[0m") == 0 ||
-                       strcmp(board[fromRow][fromCol], "\x1b[31m" "| M |" "\x1b[0m") == 0)
-                    {
-                        for(toRow = 0; toRow < ROWS; toRow++)
-                        {
-                            for(toCol = 0; toCol < COLS; toCol++)
-                            {
-                                if(isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, playerTurn, nCard))
-                                    novalidMove = 1;
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    if(strcmp(board[fromRow][fromCol], "\x1b[34m" "| s |" "\x1b[0m") == 0 ||
-                       strcmp(board[fromRow][fromCol], "\x1b[34m" "| M |" "\x1b[0m") == 0)
-                    {
-                        for(toRow = 0; toRow < ROWS; toRow++)
-                        {
-                            for(toCol = 0; toCol < COLS; toCol++)
-                            {
-                                if(isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, playerTurn, nCard))
-                                    novalidMove = 1;
-                            }
-                        }
-                    }
-                }
+                term->latencies = grown;
+                term->latencyCapacity = term->latencyCapacity * 2 + 1024;
             }
         }
+        if (term->latencyCount < term->latencyCapacity)
+            term->latencies[term->latencyCount++] = microTime() - term->lastKey;
     }
-    return novalidMove;
 }
 
 /*
-Checks if a specific piece has any valid moves with the currently selected card
-This prevents players from selecting pieces that can't move with their chosen card
+Reads the next token of a keystroke script, skipping '#' comments. A script that runs out
+before the session ends cannot be continued, so the program stops
+
 Precondition:
-    - currentPlayer must be valid and initialized
-    - board must be properly populated
-    - fromRow/fromCol must be valid board coordinates
-    - playerTurn must be 0 (BLUE) or 1 (RED)
-    - selectedCard must be 0 or 1 (index of player's cards)
+    - term->script must be open
+    - token must have room for MAX_NAME_LEN characters
 
-@param currentPlayer Pointer to current player's data
-@param board The game board state
-@param fromRow Row of piece to check
-@param fromCol Column of piece to check  
-@param playerTurn Current player's turn indicator
-@param selectedCard Which card is being used (0 or 1)
-@return 1 if valid moves exist, 0 otherwise
+@param term The terminal
+@param token Receives the token
+@return Returns no data type (void)
 */
-int hasValidMoveForPiece(player *currentPlayer, oniBrd board, int fromRow, int fromCol, 
-                        int playerTurn, int selectedCard) 
+void readScriptToken(terminal *term, char *token)
 {
-    int toRow;
-    int toCol;
-    int moveValidExist = 0;
+    int found = 0;
+    int ch;
 
-    for(toRow = 0; toRow < ROWS; toRow++) 
+    while (!found)
     {
-        for(toCol = 0; toCol < COLS; toCol++) 
+        if (fscanf(term->script, "%30s", token) != 1)
+        {
+            fprintf(stderr, "Error: the keystroke script ended before the session\n");
+            exit(1);
+        }
+
+        if (token[0] == '#')
         {
-            if(isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, playerTurn, selectedCard)) 
-                moveValidExist = 1;
+            ch = fgetc(term->script);
+            while (ch != '\n' && ch != EOF)
+                ch = fgetc(term->script);
         }
+        else
+            found = 1;
     }
-    return moveValidExist;
 }
 
 /*
-Determines which player gets the first turn based on the color of the right game card
+Reads one key the way getch() does: arrow keys arrive as 224 followed by their code. Script
+tokens are UP, DOWN, LEFT, RIGHT, ENTER, or a single character
 
-Precondition: 
-    - crdsIG must be properly initialized with valid card displays
-    - crdsIG.rCardDisp[0] must contain either "red" or another valid color string
-    - The right card's display data must be loaded from its corresponding text file
+Precondition:
+    - term must be set up
 
-@param crdsIG The game cards data structure containing card display information
-@return Returns 1 if the first player (RED) should start, 0 if the second player (BLUE) should start otherwise -1
+@param term The terminal
+@return Returns the key code
 */
-int getFirstTurn(dataCrdsIG crdsIG) 
+int readKey(terminal *term)
 {
-    int result = -1;
-
-    if (strcmp(crdsIG.rCardDisp[0], "red") == 0)
-        result = 1;
-    else if(strcmp(crdsIG.rCardDisp[0], "blue") == 0)
-        result = 0;
+    char token[MAX_NAME_LEN];
+    int key;
 
-    return result;  
+    if (term->pending != 0)
+    {
+        key = term->pending;
+        term->pending = 0;
+    }
+    else
+    {
+        inputRequested(term);
+        if (term->script == NULL)
+            key = getch();
+        else
+        {
+            readScriptToken(term, token);
+            if (strcmp(token, "UP") == 0)
+                term->pending = KEY_UP;
+            else if (strcmp(token, "DOWN") == 0)
+                term->pending = KEY_DOWN;
+            else if (strcmp(token, "LEFT") == 0)
+                term->pending = KEY_LEFT;
+            else if (strcmp(token, "RIGHT") == 0)
+                term->pending = KEY_RIGHT;
+
+            if (term->pending != 0)
+                key = 224;
+            else if (strcmp(token, "ENTER") == 0)
+                key = KEY_ENTER;
+            else
+                key = (unsigned char) token[0];
+        }
+    }
+    term->lastKey = microTime();
+    return key;
 }
 
 /*
-Updates the HallOfFame with a winner's information
+Reads a word the way scanf("%s") does, from the keyboard or as the next script token
 
 Precondition:
-    - winner must contain valid name and turns
-    - HallOfFame.txt exists
+    - term must be set up
+    - out must have room for MAX_NAME_LEN characters
 
-@param winner The winning player's data
+@param term The terminal
+@param out Receives the word
 @return Returns no data type (void)
 */
-void updateHoF(player winner) 
+void readWord(terminal *term, char *out)
 {
-    lead leaders[MAX_LEAD_LINES/2 + 1] = {0};  
-    lead temp;
-    int count = 0;
-    int i = 0;
-    int j = 0;
-    int min_idx = 0;
-    FILE *fp;
+    inputRequested(term);
+    if (term->script == NULL)
+        scanf("%30s", out);
+    else
+        readScriptToken(term, out);
+    term->lastKey = microTime();
+}
+
+/*
+Reads a one-character answer the way scanf(" %c") does
+
+Precondition:
+    - term must be set up
+
+@param term The terminal
+@return Returns the character
+*/
+char readChoice(terminal *term)
+{
+    char token[MAX_NAME_LEN];
+    char choice;
+
+    inputRequested(term);
+    if (term->script == NULL)
+        scanf(" %c", &choice);
+    else
+    {
+        readScriptToken(term, token);
+        choice = token[0];
+    }
+    term->lastKey = microTime();
+    return choice;
+}
+
+/*
+Waits for ENTER on a line-buffered screen, or takes the next script token
+
+Precondition:
+    - term must be set up
+
+@param term The terminal
+@return Returns no data type (void)
+*/
+void waitEnter(terminal *term)
+{
+    char token[MAX_NAME_LEN];
+
+    inputRequested(term);
+    if (term->script == NULL)
+        getchar();
+    else
+        readScriptToken(term, token);
+    term->lastKey = microTime();
+}
+
+/*
+Clears the console unless the terminal is headless
+
+Precondition:
+    - term must be set up
+
+@param term The terminal
+@return Returns no data type (void)
+*/
+void clearScreen(terminal *term)
+{
+    if (!term->headless)
+        system("CLS");
+}
+
+/*
+Pauses so a message can be read, unless the terminal is headless
+
+Precondition:
+    - term must be set up
+
+@param term The terminal
+@param ms Pause in milliseconds
+@return Returns no data type (void)
+*/
+void pauseScreen(terminal *term, int ms)
+{
+    if (!term->headless)
+        Sleep(ms);
+}
+
+/*
+Resets the board to empty state
+
+Precondition:
+    - Board array must be properly allocated
+    - ROWS and COLS must match board dimensions
+
+@param board The game board to reset
+@return Returns no data type (void)
+*/
+void resetBoard(oniBrd board) 
+{
+    int i, j;
     
-    fp = fopen("HallOfFame.txt", "r");
+    for (i = 0; i < ROWS; i++) 
+    {
+        for (j = 0; j < COLS; j++) 
+        {
+            strcpy(board[i][j], "| _ |");
+        }
+    }
+}
+
+/*
+Records a move into the replay system
+
+Precondition:
+    - replayMoves array must have space for MAX_MOVES
+    - moveCount must point to valid integer < MAX_MOVES
+    - cardUsed must be null-terminated string < MAX_NAME_LEN
+
+@param replayMoves Array to store moves
+@param moveCount Pointer to current move count
+@param player Player number (1 or 2)
+@param from Starting position
+@param to Destination position
+@param cardUsed Name of card used for move
+@return Returns no data type (void)
+*/
+void recordMove(MoveRecord* replayMoves, int* moveCount, int player,
+                Position from, Position to, char* cardUsed) 
+{
+    if (*moveCount < MAX_MOVES) 
+    {
+        replayMoves[*moveCount].player = player;
+        replayMoves[*moveCount].from = from;
+        replayMoves[*moveCount].to = to;
+
+        strcpy(replayMoves[*moveCount].cardName, cardUsed);
+        (*moveCount)++;
+    }
+}
+
+/*
+Applies a single move to the board during replay
+
+Precondition:
+    - Board must be properly initialized
+    - move.from and move.to must be valid positions
+    - BOARD_MAX_LENGTH must be sufficient for piece strings
+
+@param board The game board to modify
+@param move The move record to apply, from == to for a card swap without moving
+@return Returns no data type (void)
+*/
+void applyMove(oniBrd board, MoveRecord move) 
+{
+    char piece[BOARD_MAX_LENGTH];
+    
+    if (move.from.x != move.to.x || move.from.y != move.to.y)
+    {
+        strcpy(piece, board[move.from.y][move.from.x]);
+        strcpy(board[move.to.y][move.to.x], piece);
+        strcpy(board[move.from.y][move.from.x], "| _ |");
+    }
+}
+
+/*
+Reads HallOfFame data from file and store into str100 storeHoF[]
+
+Precondition:
+    - HallOfFame.txt must exist
+    - storeHoF array must be allocated
+
+@param storeHoF Array to store HallOfFame entries
+@return Returns no data type (void)
+*/
+void readHoF(str100 storeHoF[])
+{
+    FILE *fp = fopen("HallOfFame.txt", "r");
+    int i;
+
+    if (fp != NULL) // file must Exist
+    {
+        for(i=0; i < MAX_LEAD_LINES; i++)
+            fscanf(fp, "%s", storeHoF[i]); 
+
+        fclose(fp);
+    }
+}
+
+/*
+Creates and returns a Position structure with specified coordinates
+
+Precondition:
+    - x and y must be valid board coordinates (0 <= x < COLS, 0 <= y < ROWS)
+
+@param x The column coordinate (0-based)
+@param y The row coordinate (0-based)
+@return Returns a Position struct with the specified coordinates
+*/
+Position makePosition(int x, int y) 
+{
+    Position p;
+    
+    p.x = x;
+    p.y = y;
+
+    return p;
+}
+
+/*
+Reads move cards file and store data into str30 moveDeck[]
+
+Precondition:
+    - movecards.txt must exist and be properly formatted
+    - moveDeck array must be allocated
+    - cardCount pointer must be valid
+
+@param moveDeck Array to store loaded card names
+@param cardCount Pointer to store number of cards loaded
+@return Returns no data type (void)
+*/
+int readMoveCards(str30 moveDeck[], int *cardCount) 
+{
+    int i;
+    FILE *fp;
+    int status = 0;
+    
+    fp = fopen("movecards.txt", "r");
+
+    if (fp != NULL) 
+    {
+        if(fscanf(fp, "%d", cardCount)==1)
+        {
+            status = 1;
+            for (i = 0; i < *cardCount; i++) 
+            {
+                fscanf(fp, "%s", moveDeck[i]);
+            }
+        }
+    
+    fclose(fp);
+    }
+    else
+        printf("Error: Cannot open file %s\n", "movecards.txt");
+    
+    return status;
+}
+
+/*
+Seeds a random generator so the same seed always produces the same sequence
+
+Precondition:
+    - rng must point to a valid rngState
+
+@param rng The generator to seed
+@param seed Any 64-bit value, zero included
+@return Returns no data type (void)
+*/
+void rngSeed(rngState *rng, unsigned long long seed)
+{
+    int i;
+    unsigned long long z;
+
+    // splitmix64 expands the single seed into the four state words
+    for (i = 0; i < 4; i++)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+/*
+Returns the next 64-bit value of a xoshiro256** generator
+
+Precondition:
+    - rng must have been seeded with rngSeed
+
+@param rng The generator to advance
+@return Returns the next pseudo random 64-bit value
+*/
+unsigned long long rngNext(rngState *rng)
+{
+    unsigned long long *s = rng->s;
+    unsigned long long x = s[1] * 5;
+    unsigned long long result = ((x << 7) | (x >> 57)) * 9;
+    unsigned long long t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+/*
+Returns a uniformly distributed integer in [0, bound) without modulo bias
+
+Precondition:
+    - rng must have been seeded with rngSeed
+    - bound must be > 0
+
+@param rng The generator to draw from
+@param bound Exclusive upper limit
+@return Returns a value from 0 to bound - 1
+*/
+int rngBelow(rngState *rng, int bound)
+{
+    unsigned long long limit = (unsigned long long) bound;
+    unsigned long long threshold = (0 - limit) % limit; // 2^64 mod bound, the biased tail to reject
+    unsigned long long value;
+
+    do
+    {
+        value = rngNext(rng);
+    } while (value < threshold);
+
+    return (int) (value % limit);
+}
+
+/*
+Shuffles all the cards before the Game starts and before the player draws
+
+Precondition: moveDeck must be initialized with cardCount valid strings,
+              and cardCount must be a positive integer less than or equal
+              to the size of moveDeck. int cardCount is > 0
+              rng must have been seeded with rngSeed
+
+@param moveDeck: 1D array of strings that stores the name of the cards, Its needed in the function because the
+       functions purpose is to shuffle all the cards before the player draws
+
+@param cardCount: the number of cards in moveDeck that should be shuffled
+@param rng: the game's own generator, so a deal depends only on its seed
+@return Returns no data type (void)
+*/
+void shuffleCards(str30 moveDeck[], int cardCount, rngState *rng)
+{
+    int i, j;
+    str30 temp;
+
+    for(i = cardCount - 1; i > 0; i--) // Fisher-Yates, every ordering is equally likely
+    {
+        j = rngBelow(rng, i + 1);
+
+        if (j != i)
+        {
+            strcpy(temp, moveDeck[i]);
+            strcpy(moveDeck[i], moveDeck[j]);
+            strcpy(moveDeck[j], temp);
+        }
+    }
+}
+
+/*
+Fills a card display row with empty squares for the current board size
+
+Precondition:
+    - row must hold at least BOARD_SIZE + 1 characters
+
+@param row The display row to fill
+@return Returns no data type (void)
+*/
+void blankCardRow(str30 row)
+{
+    memset(row, '.', BOARD_SIZE);
+    row[BOARD_SIZE] = '\0';
+}
+
+/*
+Reads a card text file into a color line and a BOARD_SIZE pattern. Smaller patterns
+(the 5x5 cards on a 7x7 build) are centered and padded with empty squares
+
+Precondition:
+    - cardName must name an existing <cardName>.txt file
+    - pattern must have TEXT_FILE_ROWS rows
+
+@param cardName Name of the card to load
+@param pattern Receives the color line followed by the pattern rows
+@return Returns 1 if the card was loaded, 0 otherwise
+*/
+int loadCardPattern(str30 cardName, str30 pattern[])
+{
+    char filename[MAX_FILENAME_LEN];
+    str30 fileRows[TEXT_FILE_ROWS];
+    FILE *fp;
+    int nRows = 0;
+    int pad, width, i;
+    int status = 0;
+
+    strcpy(filename, cardName);
+    strcat(filename, ".txt");
+    fp = fopen(filename, "r");
+
+    if (fp != NULL)
+    {
+        if (fscanf(fp, "%30s", pattern[0]) == 1)
+        {
+            while (nRows < BOARD_SIZE && fscanf(fp, "%30s", fileRows[nRows]) == 1)
+                nRows++;
+            status = nRows > 0 && nRows % 2 == 1;
+        }
+        fclose(fp);
+    }
+
+    if (status)
+    {
+        pad = (BOARD_SIZE - nRows) / 2;
+        for (i = 1; i < TEXT_FILE_ROWS; i++)
+        {
+            blankCardRow(pattern[i]);
+            if (i - 1 >= pad && i - 1 < pad + nRows)
+            {
+                width = strlen(fileRows[i - 1 - pad]);
+                if (width > BOARD_SIZE)
+                    status = 0;
+                else
+                    memcpy(pattern[i] + (BOARD_SIZE - width) / 2, fileRows[i - 1 - pad], width);
+            }
+        }
+    }
+
+    if (!status)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        Sleep(1000);
+    }
+    return status;
+}
+
+/*
+Loads every card of the deck, precomputes its destination masks for both sides and finds
+its mirror partner
+
+Precondition:
+    - moveDeck must hold cardCount card names, cardCount <= MAX_CARDS
+    - cards must have room for cardCount entries
+
+@param moveDeck Card names as read from movecards.txt
+@param cardCount Number of cards in moveDeck
+@param cards Receives the card table, indexed by card id
+@return Returns 1 if every card loaded, 0 otherwise
+*/
+int loadCardTable(str30 moveDeck[], int cardCount, cardInfo cards[])
+{
+    int id, other, isMirror, side, row, col, i, j;
+    int dRow, toRow, toCol;
+    int status = 1;
+
+    for (id = 0; id < cardCount; id++)
+    {
+        strcpy(cards[id].name, moveDeck[id]);
+        memset(cards[id].moves, 0, sizeof(cards[id].moves));
+
+        if (!loadCardPattern(cards[id].name, cards[id].pattern))
+            status = 0;
+
+        cards[id].color = strcmp(cards[id].pattern[0], "red") == 0;
+
+        // an 'x' is an offset from the pattern center; its row is flipped for RED, its column never is
+        for (side = 0; side < 2; side++)
+            for (row = 0; row < ROWS; row++)
+                for (col = 0; col < COLS; col++)
+                    for (i = 1; i < TEXT_FILE_ROWS; i++)
+                        for (j = 0; j < BOARD_SIZE; j++)
+                        {
+                            dRow = i - 1 - VISUAL_CARD_CENTER;
+                            if (side == 1)
+                                dRow = -dRow;
+                            toRow = row + dRow;
+                            toCol = col + j - VISUAL_CARD_CENTER;
+
+                            if (cards[id].pattern[i][j] == 'x' &&
+                                toRow >= 0 && toRow < ROWS && toCol >= 0 && toCol < COLS)
+                                cards[id].moves[side][SQUARE_OF(row, col)] |= SQUARE_BIT(SQUARE_OF(toRow, toCol));
+                        }
+    }
+
+    // mirror partners come from the patterns: Frog/Rabbit swap, Tiger maps onto itself
+    for (id = 0; id < cardCount; id++)
+    {
+        cards[id].mirror = -1;
+        for (other = 0; other < cardCount && cards[id].mirror < 0; other++)
+        {
+            isMirror = 1;
+            for (i = 1; i < TEXT_FILE_ROWS && isMirror; i++)
+                for (j = 0; j < BOARD_SIZE && isMirror; j++)
+                    isMirror = (cards[id].pattern[i][j] == 'x') == (cards[other].pattern[i][BOARD_SIZE - 1 - j] == 'x');
+
+            if (isMirror)
+                cards[id].mirror = other;
+        }
+    }
+    return status;
+}
+
+/*
+Finds the card id of a card name
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param cards The card table
+@param cardCount Number of cards in the table
+@param name Card name to look up
+@return Returns the card id, or -1 if the name is not in the table
+*/
+int findCardId(cardInfo cards[], int cardCount, const char *name)
+{
+    int id;
+    int result = -1;
+
+    for (id = 0; id < cardCount && result < 0; id++)
+    {
+        if (strcmp(cards[id].name, name) == 0)
+            result = id;
+    }
+    return result;
+}
+
+/*
+Squares one card reaches from a set of pieces, own pieces included
+
+Precondition:
+    - side must be 0 or 1
+
+@param pieces The pieces moving
+@param card The card they move with
+@param side Side the pieces belong to
+@return Returns the union of the card's destinations from every piece
+*/
+boardMask cardReach(boardMask pieces, const cardInfo *card, int side)
+{
+    boardMask reach = 0;
+    boardMask from;
+
+    for (from = pieces; from; from &= from - 1)
+        reach |= card->moves[side][LOWEST_SQUARE(from)];
+    return reach;
+}
+
+/*
+Computes every attack map of a position from scratch. Positions built by hand call this once;
+makeMove and applyCoreMove then keep the maps up to date
+
+Precondition:
+    - the pieces and cards of state must be set
+
+@param state The position, its attack maps are filled in
+@param cards The card table
+@return Returns no data type (void)
+*/
+void refreshAttacks(gameState *state, cardInfo cards[])
+{
+    int side, slot;
+
+    for (side = 0; side < 2; side++)
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            state->attacks[side][slot] = cardReach(state->pieces[side], &cards[state->hand[side][slot]], side);
+}
+
+/*
+Converts the displayed board and card state into the compact rules state
+
+Precondition:
+    - board, players and crdsIG must describe a game in progress
+    - cards must hold every card named by the players and crdsIG
+
+@param board The game board
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@param crdsIG Pointer to game cards data
+@param playerTurn Current player indicator (0 or 1)
+@param round Current round number
+@param cards The card table
+@param cardCount Number of cards in the table
+@param state Receives the converted position
+@return Returns no data type (void)
+*/
+void stateFromBoard(oniBrd board, player *p1, player *p2, dataCrdsIG *crdsIG, int playerTurn, int round,
+                    cardInfo cards[], int cardCount, gameState *state)
+{
+    player *owner[2];
+    int side, row, col, i;
+
+    owner[0] = p1;
+    owner[1] = p2;
+
+    for (side = 0; side < 2; side++)
+    {
+        state->pieces[side] = 0;
+        state->master[side] = -1;
+
+        for (i = 0; i < MAX_CARDS_PER_PLAYER; i++)
+            state->hand[side][i] = findCardId(cards, cardCount, owner[side]->card.playercard[i]);
+    }
+
+    for (row = 0; row < ROWS; row++)
+        for (col = 0; col < COLS; col++)
+            for (side = 0; side < 2; side++)
+            {
+                if (strcmp(board[row][col], owner[side]->pPiece.sensei) == 0)
+                {
+                    state->master[side] = SQUARE_OF(row, col);
+                    state->pieces[side] |= SQUARE_BIT(SQUARE_OF(row, col));
+                }
+                else if (strcmp(board[row][col], owner[side]->pPiece.student[0]) == 0)
+                    state->pieces[side] |= SQUARE_BIT(SQUARE_OF(row, col));
+            }
+
+    // the neutral card sits on whichever side is not "None"
+    if (strcmp(crdsIG->rCardName, "None") != 0)
+        state->neutral = findCardId(cards, cardCount, crdsIG->rCardName);
+    else
+        state->neutral = findCardId(cards, cardCount, crdsIG->lCardName);
+
+    state->side = playerTurn;
+    state->round = round;
+    refreshAttacks(state, cards);
+}
+
+/*
+Redraws the displayed board and cards from the compact rules state, the reverse of
+stateFromBoard. The neutral card sits on the right while Blue is to move and on Red's
+first turn, on the left otherwise, as switchCard leaves it
+
+Precondition:
+    - state must be a valid position whose cards are in cards
+    - populatePlayerPiece must have set up the piece strings of p1 and p2
+
+@param state The position to show
+@param cards The card table
+@param board Receives the pieces
+@param p1 Pointer to Player 1's data, its cards are replaced
+@param p2 Pointer to Player 2's data, its cards are replaced
+@param crdsIG Receives the neutral card
+@return Returns no data type (void)
+*/
+void boardFromState(const gameState *state, cardInfo cards[], oniBrd board, player *p1, player *p2,
+                    dataCrdsIG *crdsIG)
+{
+    player *owner[2];
+    int side, row, col, i, slot, sq;
+
+    owner[0] = p1;
+    owner[1] = p2;
+
+    for (row = 0; row < ROWS; row++)
+        for (col = 0; col < COLS; col++)
+        {
+            sq = SQUARE_OF(row, col);
+            strcpy(board[row][col], "| _ |");
+            for (side = 0; side < 2; side++)
+            {
+                if (state->master[side] == sq)
+                    strcpy(board[row][col], owner[side]->pPiece.sensei);
+                else if (state->pieces[side] & SQUARE_BIT(sq))
+                    strcpy(board[row][col], owner[side]->pPiece.student[0]);
+            }
+        }
+
+    for (side = 0; side < 2; side++)
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+        {
+            strcpy(owner[side]->card.playercard[slot], cards[state->hand[side][slot]].name);
+            for (i = 0; i < TEXT_FILE_ROWS; i++)
+                strcpy(owner[side]->card.visualCard[slot][i], cards[state->hand[side][slot]].pattern[i]);
+        }
+
+    strcpy(crdsIG->lCardName, "None");
+    strcpy(crdsIG->rCardName, "None");
+    for (i = 0; i < TEXT_FILE_ROWS; i++)
+    {
+        blankCardRow(crdsIG->lCardDisp[i]);
+        blankCardRow(crdsIG->rCardDisp[i]);
+    }
+
+    if (state->side == 0 || state->round == 1)
+    {
+        strcpy(crdsIG->rCardName, cards[state->neutral].name);
+        for (i = 0; i < TEXT_FILE_ROWS; i++)
+            strcpy(crdsIG->rCardDisp[i], cards[state->neutral].pattern[i]);
+    }
+    else
+    {
+        strcpy(crdsIG->lCardName, cards[state->neutral].name);
+        for (i = 0; i < TEXT_FILE_ROWS; i++)
+            strcpy(crdsIG->lCardDisp[i], cards[state->neutral].pattern[i]);
+    }
+}
+
+/*
+Converts a move recorded by recordMove into a compact move
+
+Precondition:
+    - cards must hold the card named by the record
+
+@param record The recorded move, from == to for a card swap without moving
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns the compact move
+*/
+coreMove coreMoveFromRecord(const MoveRecord *record, cardInfo cards[], int cardCount)
+{
+    int card = findCardId(cards, cardCount, record->cardName);
+    coreMove move = MAKE_MOVE(card, 0, 0);
+
+    if (record->from.x != record->to.x || record->from.y != record->to.y)
+        move = MAKE_MOVE(card, SQUARE_OF(record->from.y, record->from.x), SQUARE_OF(record->to.y, record->to.x));
+
+    return move;
+}
+
+/*
+Generates every legal move for the side to move. When no piece can move, the
+only legal moves are passes that swap one of the hand cards with the neutral card
+
+Precondition:
+    - state must be a valid position
+    - moves must have room for MAX_CORE_MOVES entries
+
+@param state The position to generate moves for
+@param cards The card table
+@param moves Receives the legal moves
+@return Returns the number of legal moves
+*/
+int generateMoves(const gameState *state, cardInfo cards[], coreMove moves[])
+{
+    int side = state->side;
+    boardMask own = state->pieces[side];
+    boardMask from, to;
+    int slot, card, fromSq, toSq;
+    int count = 0;
+
+    for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+    {
+        card = state->hand[side][slot];
+        for (from = own; from; from &= from - 1)
+        {
+            fromSq = LOWEST_SQUARE(from);
+            for (to = cards[card].moves[side][fromSq] & ~own; to; to &= to - 1)
+            {
+                toSq = LOWEST_SQUARE(to);
+                moves[count++] = MAKE_MOVE(card, fromSq, toSq);
+            }
+        }
+    }
+
+    if (count == 0)
+    {
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            moves[count++] = MAKE_MOVE(state->hand[side][slot], 0, 0);
+    }
+    return count;
+}
+
+/*
+Fills the Zobrist keys used to hash positions. The keys come from a fixed seed so
+hashes are identical in every process and every run
+
+Precondition:
+    - keys must point to a valid zobristKeys
+
+@param keys The key table to fill
+@return Returns no data type (void)
+*/
+void initZobrist(zobristKeys *keys)
+{
+    rngState rng;
+    int side, type, sq, card, owner;
+
+    rngSeed(&rng, 0x4F4E4954414D41ULL); // "ONITAMA"
+
+    for (side = 0; side < 2; side++)
+        for (type = 0; type < 2; type++)
+            for (sq = 0; sq < NUM_SQUARES; sq++)
+                keys->piece[side][type][sq] = rngNext(&rng);
+
+    for (card = 0; card < MAX_CARDS; card++)
+        for (owner = 0; owner < 3; owner++)
+            keys->card[card][owner] = rngNext(&rng);
+
+    keys->sideToMove = rngNext(&rng);
+}
+
+/*
+Computes the Zobrist hash of a position. Hand cards are hashed by owner only, so the
+slot order inside a hand does not change the hash, and neither does the round number
+
+Precondition:
+    - state must be a valid position
+    - keys must have been filled by initZobrist
+
+@param state The position to hash
+@param keys The Zobrist key table
+@return Returns the 64-bit position hash
+*/
+unsigned long long hashState(const gameState *state, const zobristKeys *keys)
+{
+    unsigned long long hash = 0;
+    boardMask rest;
+    int side, slot, sq;
+
+    for (side = 0; side < 2; side++)
+    {
+        for (rest = state->pieces[side]; rest; rest &= rest - 1)
+        {
+            sq = LOWEST_SQUARE(rest);
+            hash ^= keys->piece[side][sq == state->master[side]][sq];
+        }
+
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            hash ^= keys->card[state->hand[side][slot]][side];
+    }
+    hash ^= keys->card[state->neutral][2];
+
+    if (state->side == 1)
+        hash ^= keys->sideToMove;
+
+    return hash;
+}
+
+/*
+Mirrors a move left to right, swapping its card for the mirror partner
+
+Precondition:
+    - the move's card must have a mirror partner
+
+@param move The move to mirror
+@param cards The card table
+@return Returns the mirrored move
+*/
+coreMove mirrorMove(coreMove move, cardInfo cards[])
+{
+    coreMove result = MAKE_MOVE(cards[MOVE_CARD(move)].mirror, 0, 0);
+
+    if (!MOVE_IS_PASS(move))
+        result = MAKE_MOVE(cards[MOVE_CARD(move)].mirror, MIRROR_SQUARE(MOVE_FROM(move)), MIRROR_SQUARE(MOVE_TO(move)));
+
+    return result;
+}
+
+/*
+Returns the card whose Zobrist keys stand for a card in the mirror hash: its mirror partner, or
+the card itself when it has none, which canonicalHash then never uses
+
+Precondition:
+    - card must be a loaded card
+
+@param cards The card table
+@param card The card id
+@return Returns the card id to hash
+*/
+int mirrorKeyCard(cardInfo cards[], int card)
+{
+    return cards[card].mirror >= 0 ? cards[card].mirror : card;
+}
+
+/*
+Computes the hash of the left-right mirror of a position, with every square reflected and every
+card swapped for its mirror partner, without building the mirror. makeMove keeps it up to date
+from then on
+
+Precondition:
+    - state must be a valid position
+    - keys must have been filled by initZobrist
+
+@param state The position to hash
+@param cards The card table
+@param keys The Zobrist key table
+@return Returns the 64-bit mirror hash
+*/
+unsigned long long hashMirror(const gameState *state, cardInfo cards[], const zobristKeys *keys)
+{
+    unsigned long long hash = 0;
+    boardMask rest;
+    int side, slot, sq;
+
+    for (side = 0; side < 2; side++)
+    {
+        for (rest = state->pieces[side]; rest; rest &= rest - 1)
+        {
+            sq = LOWEST_SQUARE(rest);
+            hash ^= keys->piece[side][sq == state->master[side]][MIRROR_SQUARE(sq)];
+        }
+
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            hash ^= keys->card[mirrorKeyCard(cards, state->hand[side][slot])][side];
+    }
+    hash ^= keys->card[mirrorKeyCard(cards, state->neutral)][2];
+
+    if (state->side == 1)
+        hash ^= keys->sideToMove;
+
+    return hash;
+}
+
+/*
+Computes the symmetry-aware key of a position: the smaller of its hash and its mirror hash. A
+position and its mirror therefore share transposition table entries. Both hashes are kept up
+to date by makeMove, so this is O(1)
+
+Precondition:
+    - state must be a valid position
+    - hash and mirrorHash must be the hashState and hashMirror values of state
+
+@param state The position
+@param hash The position's hash
+@param mirrorHash The position's mirror hash
+@param cards The card table
+@param mirrored Receives 1 if the key is the mirror hash, 0 otherwise
+@return Returns the canonical 64-bit key
+*/
+unsigned long long canonicalHash(const gameState *state, unsigned long long hash, unsigned long long mirrorHash,
+                                 cardInfo cards[], int *mirrored)
+{
+    *mirrored = 0;
+    if (cards[state->hand[0][0]].mirror >= 0 && cards[state->hand[0][1]].mirror >= 0 &&
+        cards[state->hand[1][0]].mirror >= 0 && cards[state->hand[1][1]].mirror >= 0 &&
+        cards[state->neutral].mirror >= 0 && mirrorHash < hash)
+    {
+        hash = mirrorHash;
+        *mirrored = 1;
+    }
+    return hash;
+}
+
+/*
+Empties a hash history for a new game
+
+Precondition:
+    - history must point to a valid hashHistory
+
+@param history The history to clear
+@return Returns no data type (void)
+*/
+void historyClear(hashHistory *history)
+{
+    memset(history->counts, 0, sizeof(history->counts));
+    history->count = 0;
+    history->filled = 0;
+}
+
+/*
+Finds the count slot of a hash: the slot holding it, or the empty slot that ends its probe run.
+The table is never more than half full, so the run is short
+
+Precondition:
+    - history must have been cleared with historyClear
+
+@param history The game's history
+@param hash The hash to look for
+@return Returns the slot index
+*/
+int historySlot(const hashHistory *history, unsigned long long hash)
+{
+    int slot = (int) (hash & (HISTORY_SLOTS - 1));
+
+    while (history->counts[slot].count != 0 && history->counts[slot].hash != hash)
+        slot = (slot + 1) & (HISTORY_SLOTS - 1);
+    return slot;
+}
+
+/*
+Counts how often a position occurs in the history, with one probe of the count table
+
+Precondition:
+    - history must have been cleared with historyClear
+
+@param history The game's history
+@param hash Hash of the position to look for
+@return Returns the number of occurrences
+*/
+int historyOccurrences(const hashHistory *history, unsigned long long hash)
+{
+    return history->counts[historySlot(history, hash)].count;
+}
+
+/*
+Takes one occurrence of a hash off the count table. A slot that empties is refilled from later
+slots of the probe run (backward-shift deletion), so no lookup stops short at a hole
+
+Precondition:
+    - hash must occur in history
+
+@param history The game's history
+@param hash The hash to remove
+@return Returns no data type (void)
+*/
+void historyUncount(hashHistory *history, unsigned long long hash)
+{
+    int hole = historySlot(history, hash);
+    int next, home;
+
+    history->counts[hole].count--;
+    if (history->counts[hole].count == 0)
+    {
+        next = (hole + 1) & (HISTORY_SLOTS - 1);
+        while (history->counts[next].count != 0)
+        {
+            // the entry may fill the hole when the hole lies between its home slot and where it sits
+            home = (int) (history->counts[next].hash & (HISTORY_SLOTS - 1));
+            if (((next - home) & (HISTORY_SLOTS - 1)) >= ((next - hole) & (HISTORY_SLOTS - 1)))
+            {
+                history->counts[hole] = history->counts[next];
+                history->counts[next].count = 0;
+                hole = next;
+            }
+            next = (next + 1) & (HISTORY_SLOTS - 1);
+        }
+    }
+}
+
+/*
+Adds a played position to the history, dropping the oldest one once the ring is full
+
+Precondition:
+    - history must have been cleared with historyClear
+
+@param history The game's history
+@param hash Hash of the position
+@return Returns no data type (void)
+*/
+void historyPush(hashHistory *history, unsigned long long hash)
+{
+    unsigned long long *slot = &history->ring[history->count & (HISTORY_RING - 1)];
+    int counted;
+
+    if (history->filled == HISTORY_RING)
+        historyUncount(history, *slot);
+    else
+        history->filled++;
+
+    *slot = hash;
+    counted = historySlot(history, hash);
+    history->counts[counted].hash = hash;
+    history->counts[counted].count++;
+    history->count++;
+}
+
+/*
+Removes the latest position from the history, as when a search backs out of a move
+
+Precondition:
+    - the latest change to history must be a historyPush
+
+@param history The game's history
+@return Returns no data type (void)
+*/
+void historyPop(hashHistory *history)
+{
+    history->count--;
+    history->filled--;
+    historyUncount(history, history->ring[history->count & (HISTORY_RING - 1)]);
+}
+
+/*
+Reads the draw rule from "-repetition <n>" (0 disables it) and "-maxplies <n>"
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param rule Receives the draw rule
+@return Returns no data type (void)
+*/
+void readDrawRule(int argc, char *argv[], drawRule *rule)
+{
+    int i;
+
+    rule->repetitions = DEFAULT_REPETITIONS;
+    rule->maxPlies = MAX_MOVES;
+
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "-repetition") == 0)
+            rule->repetitions = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-maxplies") == 0)
+            rule->maxPlies = atoi(argv[i + 1]);
+    }
+
+    if (rule->maxPlies < 1 || rule->maxPlies > MAX_MOVES) // recordMove keeps at most MAX_MOVES moves
+        rule->maxPlies = MAX_MOVES;
+}
+
+/*
+Reads the time control from "-clock <minutes>[+<seconds>]", the time each side starts with and
+the increment added after every move, e.g. "-clock 5+3". Without the flag the game is untimed
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param clock Receives the clocks, both stopped
+@return Returns no data type (void)
+*/
+void readClock(int argc, char *argv[], gameClock *clock)
+{
+    char *rest;
+    double minutes = 0.0, seconds = 0.0;
+    int i;
+
+    memset(clock, 0, sizeof(*clock));
+    clock->running = -1;
+
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "-clock") == 0)
+        {
+            minutes = strtod(argv[i + 1], &rest);
+            if (*rest == '+')
+                seconds = strtod(rest + 1, NULL);
+        }
+    }
+
+    if (minutes > 0.0)
+    {
+        clock->enabled = 1;
+        clock->remaining[0] = (long long) (minutes * 60000000.0);
+        clock->remaining[1] = clock->remaining[0];
+        clock->increment = seconds > 0.0 ? (long long) (seconds * 1000000.0) : 0;
+    }
+}
+
+/*
+Reads a side's clock, including the time of the move it is thinking about
+
+Precondition:
+    - side must be 0 or 1
+
+@param clock The clocks
+@param side The side to read
+@return Returns the microseconds the side has left, negative once its time has run out
+*/
+long long clockRemaining(const gameClock *clock, int side)
+{
+    long long left = clock->remaining[side];
+
+    if (clock->running == side)
+        left -= (long long) (microTime() - clock->started);
+    return left;
+}
+
+/*
+Starts the clock of the side to move
+
+Precondition:
+    - both clocks must be stopped
+    - side must be 0 or 1
+
+@param clock The clocks
+@param side The side to move
+@return Returns no data type (void)
+*/
+void startClock(gameClock *clock, int side)
+{
+    clock->running = side;
+    clock->started = microTime();
+}
+
+/*
+Stops the running clock and charges it the time since startClock. A move played in time earns
+the increment
+
+Precondition:
+    - a clock must be running
+
+@param clock The clocks
+@param moved 1 if the side finished a move, 0 if the time went to an undo or redo
+@return Returns 1 while the side still has time, 0 once its time has run out (always 1 untimed)
+*/
+int stopClock(gameClock *clock, int moved)
+{
+    int side = clock->running;
+    int inTime;
+
+    clock->remaining[side] = clockRemaining(clock, side);
+    clock->running = -1;
+    inTime = !clock->enabled || clock->remaining[side] > 0;
+    if (inTime && moved)
+        clock->remaining[side] += clock->increment;
+    return inTime;
+}
+
+/*
+Writes a clock reading as minutes and seconds, with tenths once under CLOCK_TENTHS_BELOW seconds
+
+Precondition:
+    - out must hold at least 24 characters
+
+@param micros The time left, shown as 0:00.0 when negative
+@param out Receives the text
+@return Returns no data type (void)
+*/
+void formatClock(long long micros, char *out)
+{
+    long long tenths = micros > 0 ? micros / 100000 : 0;
+
+    if (tenths < CLOCK_TENTHS_BELOW * 10)
+        sprintf(out, "%lld:%02lld.%lld", tenths / 600, tenths / 10 % 60, tenths % 10);
+    else
+        sprintf(out, "%lld:%02lld", tenths / 600, tenths / 10 % 60);
+}
+
+/*
+Plans the engine's time for one move: an even share of the clock over CLOCK_MOVES_TO_GO moves plus
+the increment it earns back, never more than the clock holds after CLOCK_RESERVE_MS
+
+Precondition:
+    - clock must be enabled
+    - side must be 0 or 1
+
+@param clock The clocks
+@param side The side to move
+@return Returns the search's time limit in milliseconds, at least 1
+*/
+int moveBudget(const gameClock *clock, int side)
+{
+    long long usable = clockRemaining(clock, side) / 1000 - CLOCK_RESERVE_MS;
+    long long budget = usable / CLOCK_MOVES_TO_GO + clock->increment / 1000;
+
+    if (budget > usable)
+        budget = usable;
+    if (budget < 1)
+        budget = 1;
+    return (int) budget;
+}
+
+/*
+Checks the win condition of a compact position: a Sensei standing on the opponent's temple
+arch wins first, then a captured Sensei loses
+
+Precondition:
+    - state must be a valid position
+
+@param state The position to check
+@return Returns 1 if player 1 wins, 2 if player 2 wins, 0 if no winner yet
+*/
+int coreWinner(const gameState *state)
+{
+    int result = 0;
+
+    if (state->master[0] == SQUARE_OF(0, COLS/2))
+        result = 1;
+    else if (state->master[1] == SQUARE_OF(ROWS-1, COLS/2))
+        result = 2;
+    else if (state->master[0] < 0)
+        result = 2;
+    else if (state->master[1] < 0)
+        result = 1;
+
+    return result;
+}
+
+/*
+Plays a move on a copy of the position: moves and captures the piece, hands the used
+card over to the neutral slot and takes the neutral card, then passes the turn. Only the
+attack maps whose pieces or card changed are recomputed
+
+Precondition:
+    - move must be legal in src (as produced by generateMoves)
+
+@param src The position before the move
+@param move The move to play
+@param cards The card table
+@param dst Receives the position after the move
+@return Returns no data type (void)
+*/
+void applyCoreMove(const gameState *src, coreMove move, cardInfo cards[], gameState *dst)
+{
+    int side = src->side;
+    int card = MOVE_CARD(move);
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int slot;
+
+    *dst = *src;
+    slot = dst->hand[side][0] == card ? 0 : 1;
+    dst->hand[side][slot] = dst->neutral;
+    dst->neutral = card;
+
+    if (!MOVE_IS_PASS(move))
+    {
+        dst->pieces[side] ^= SQUARE_BIT(from) | SQUARE_BIT(to);
+        if (dst->master[side] == from)
+            dst->master[side] = to;
+        dst->attacks[side][!slot] = cardReach(dst->pieces[side], &cards[dst->hand[side][!slot]], side);
+
+        if (dst->pieces[!side] & SQUARE_BIT(to))
+        {
+            dst->pieces[!side] &= ~SQUARE_BIT(to);
+            if (dst->master[!side] == to)
+                dst->master[!side] = -1;
+            dst->attacks[!side][0] = cardReach(dst->pieces[!side], &cards[dst->hand[!side][0]], !side);
+            dst->attacks[!side][1] = cardReach(dst->pieces[!side], &cards[dst->hand[!side][1]], !side);
+        }
+    }
+
+    dst->attacks[side][slot] = cardReach(dst->pieces[side], &cards[dst->hand[side][slot]], side);
+    dst->side = !side;
+    dst->round++;
+}
+
+/*
+Plays a move in place and keeps the hash and, when asked, the mirror hash up to date: only the
+moved piece, a captured piece, the two cards that change hands and the side to move are touched. Only the side that moved
+can have won, so the game-over check looks at its move alone instead of the whole board.
+Attack maps are recomputed for the mover, and for the opponent only after a capture
+
+Precondition:
+    - move must be legal in state (as produced by generateMoves)
+    - hash must be the hash of state under keys
+
+@param state The position, updated in place
+@param move The move to play
+@param cards The card table
+@param keys The Zobrist key table
+@param hash The position hash, updated in place
+@param mirrorHash The hashMirror value of the position, updated in place, NULL when not kept
+@param undo Receives what unmakeMove needs to take the move back
+@return Returns 1 if player 1 has now won, 2 if player 2 has, 0 otherwise (as coreWinner)
+*/
+int makeMove(gameState *state, coreMove move, cardInfo cards[], const zobristKeys *keys, unsigned long long *hash,
+             unsigned long long *mirrorHash, undoRecord *undo)
+{
+    int side = state->side;
+    int card = MOVE_CARD(move);
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int type = state->master[side] == from;
+    int mirrorCard = mirrorKeyCard(cards, card);
+    int mirrorNeutral = mirrorKeyCard(cards, state->neutral);
+    unsigned long long mirrorChange = keys->sideToMove;
+    int winner = 0;
+
+    undo->move = move;
+    undo->hash = *hash;
+    undo->mirrorHash = mirrorHash != NULL ? *mirrorHash : 0;
+    undo->captured = 0;
+    undo->slot = state->hand[side][0] == card ? 0 : 1;
+    memcpy(undo->attacks, state->attacks, sizeof(undo->attacks));
+
+    if (!MOVE_IS_PASS(move))
+    {
+        if (state->pieces[!side] & SQUARE_BIT(to))
+        {
+            undo->captured = state->master[!side] == to ? 2 : 1;
+            state->pieces[!side] &= ~SQUARE_BIT(to);
+            *hash ^= keys->piece[!side][undo->captured == 2][to];
+            mirrorChange ^= keys->piece[!side][undo->captured == 2][MIRROR_SQUARE(to)];
+            if (undo->captured == 2)
+                state->master[!side] = -1;
+            state->attacks[!side][0] = cardReach(state->pieces[!side], &cards[state->hand[!side][0]], !side);
+            state->attacks[!side][1] = cardReach(state->pieces[!side], &cards[state->hand[!side][1]], !side);
+        }
+
+        state->pieces[side] ^= SQUARE_BIT(from) | SQUARE_BIT(to);
+        *hash ^= keys->piece[side][type][from] ^ keys->piece[side][type][to];
+        mirrorChange ^= keys->piece[side][type][MIRROR_SQUARE(from)] ^ keys->piece[side][type][MIRROR_SQUARE(to)];
+        if (type)
+            state->master[side] = to;
+        state->attacks[side][!undo->slot] = cardReach(state->pieces[side], &cards[state->hand[side][!undo->slot]], side);
+
+        if (undo->captured == 2 || state->master[side] == (side == 0 ? SQUARE_OF(0, COLS/2) : SQUARE_OF(ROWS-1, COLS/2)))
+            winner = side + 1;
+    }
+
+    *hash ^= keys->card[card][side] ^ keys->card[card][2];
+    *hash ^= keys->card[state->neutral][2] ^ keys->card[state->neutral][side];
+    *hash ^= keys->sideToMove;
+    mirrorChange ^= keys->card[mirrorCard][side] ^ keys->card[mirrorCard][2];
+    mirrorChange ^= keys->card[mirrorNeutral][2] ^ keys->card[mirrorNeutral][side];
+    if (mirrorHash != NULL)
+        *mirrorHash ^= mirrorChange;
+    state->hand[side][undo->slot] = state->neutral;
+    state->neutral = card;
+    state->attacks[side][undo->slot] = cardReach(state->pieces[side], &cards[state->hand[side][undo->slot]], side);
+    state->side = !side;
+    state->round++;
+
+    return winner;
+}
+
+/*
+Takes back the last move played with makeMove
+
+Precondition:
+    - undo must be the record of the last move made on state
+
+@param state The position, restored in place
+@param undo The record makeMove filled in
+@param hash Receives the hash before the move
+@param mirrorHash Receives the mirror hash before the move, NULL when not kept
+@return Returns no data type (void)
+*/
+void unmakeMove(gameState *state, const undoRecord *undo, unsigned long long *hash, unsigned long long *mirrorHash)
+{
+    int side = !state->side;
+    int from = MOVE_FROM(undo->move);
+    int to = MOVE_TO(undo->move);
+
+    state->side = side;
+    state->round--;
+    state->neutral = state->hand[side][undo->slot];
+    state->hand[side][undo->slot] = MOVE_CARD(undo->move);
+
+    if (!MOVE_IS_PASS(undo->move))
+    {
+        state->pieces[side] ^= SQUARE_BIT(from) | SQUARE_BIT(to);
+        if (state->master[side] == to)
+            state->master[side] = from;
+
+        if (undo->captured != 0)
+            state->pieces[!side] |= SQUARE_BIT(to);
+        if (undo->captured == 2)
+            state->master[!side] = to;
+    }
+    memcpy(state->attacks, undo->attacks, sizeof(state->attacks));
+    *hash = undo->hash;
+    if (mirrorHash != NULL)
+        *mirrorHash = undo->mirrorHash;
+}
+
+/*
+Name of an evaluation feature as written in EVAL_FILE
+
+Precondition:
+    - feature must be below EVAL_FEATURES
+
+@param feature The feature index (EVAL_MATERIAL ...)
+@return Returns the feature's name
+*/
+const char *evalFeatureName(int feature)
+{
+    static const char *names[EVAL_FEATURES] = {"material", "master_safety", "temple_distance", "mobility",
+                                               "neutral_card"};
+
+    return names[feature];
+}
+
+/*
+Sets the built-in evaluation weights, used when EVAL_FILE is missing or leaves a feature out
+
+Precondition: None
+
+@param weights Receives the weights
+@return Returns no data type (void)
+*/
+void defaultEvalWeights(evalWeights *weights)
+{
+    memset(weights, 0, sizeof(evalWeights));
+    weights->weight[EVAL_MATERIAL] = 100;
+    weights->weight[EVAL_TEMPLE] = 4;
+}
+
+/*
+Reads evaluation weights from a config file of "name value" lines; "#" starts a comment.
+Features the file does not name keep their default weight, unknown names are ignored
+
+Precondition: None
+
+@param filename The config file
+@param weights Receives the weights
+@return Returns 1 if the file was read, 0 if it could not be opened (defaults are set)
+*/
+int loadEvalWeights(const char *filename, evalWeights *weights)
+{
+    FILE *fp = fopen(filename, "r");
+    char line[MAX_NAME_LEN + 32];
+    char name[MAX_NAME_LEN + 1];
+    int value, i;
+
+    defaultEvalWeights(weights);
+    if (fp != NULL)
+    {
+        while (fgets(line, sizeof(line), fp) != NULL)
+        {
+            if (line[0] != '#' && sscanf(line, "%31s %d", name, &value) == 2)
+                for (i = 0; i < EVAL_FEATURES; i++)
+                    if (strcmp(name, evalFeatureName(i)) == 0)
+                        weights->weight[i] = value;
+        }
+        fclose(fp);
+    }
+    return fp != NULL;
+}
+
+/*
+Writes evaluation weights in the format read by loadEvalWeights
+
+Precondition: None
+
+@param filename The config file to create
+@param weights The weights to write
+@param source What the weights were fitted to, written as a comment
+@return Returns 1 on success, 0 if the file could not be written
+*/
+int saveEvalWeights(const char *filename, const evalWeights *weights, const char *source)
+{
+    FILE *fp = fopen(filename, "w");
+    int i;
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "# evaluation weights, one \"name value\" per line, tuned on %s\n", source);
+        for (i = 0; i < EVAL_FEATURES; i++)
+            fprintf(fp, "%s %d\n", evalFeatureName(i), weights->weight[i]);
+        fclose(fp);
+    }
+    return fp != NULL;
+}
+
+/*
+Counts the destinations a side's pieces reach with one card
+
+Precondition:
+    - side must be 0 or 1
+
+@param state The position
+@param cards The card table
+@param side The side moving
+@param card Card id to move with
+@return Returns the number of moves
+*/
+int cardMobility(const gameState *state, cardInfo cards[], int side, int card)
+{
+    boardMask own = state->pieces[side];
+    boardMask from;
+    int count = 0;
+
+    for (from = own; from; from &= from - 1)
+        count += COUNT_SQUARES(cards[card].moves[side][LOWEST_SQUARE(from)] & ~own);
+    return count;
+}
+
+/*
+Measures the evaluation features of a position, each as the side to move's value minus its
+opponent's:
+    - material: students on the board
+    - master_safety: -1 while the opposing attack map covers the sensei
+    - temple_distance: how close the sensei is to the opposing temple, in king steps
+    - mobility: moves with the two cards in hand
+    - neutral_card: moves the neutral card will give its next holder, the side to move
+
+Precondition:
+    - state must be a valid position with both senseis on the board
+
+@param state The position
+@param cards The card table
+@param features Receives EVAL_FEATURES values
+@return Returns no data type (void)
+*/
+void evalFeatures(const gameState *state, cardInfo cards[], int features[])
+{
+    int side, slot, sign, templeRow, row, col, dist;
+
+    memset(features, 0, EVAL_FEATURES * sizeof(int));
+    for (side = 0; side < 2; side++)
+    {
+        sign = side == state->side ? 1 : -1;
+        features[EVAL_MATERIAL] += sign * (COUNT_SQUARES(state->pieces[side]) - 1);
+
+        features[EVAL_MASTER_SAFETY] -= sign * (int) ((ATTACKED_BY(state, !side) >> state->master[side]) & 1);
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            features[EVAL_MOBILITY] += sign * cardMobility(state, cards, side, state->hand[side][slot]);
+
+        // a sensei closer to the opposing temple threatens the Way of the Stream
+        templeRow = side == 0 ? 0 : ROWS - 1;
+        row = state->master[side] / COLS;
+        col = state->master[side] % COLS;
+        dist = abs(row - templeRow);
+        if (abs(col - COLS/2) > dist)
+            dist = abs(col - COLS/2);
+        features[EVAL_TEMPLE] += sign * (BOARD_SIZE - dist);
+    }
+    features[EVAL_NEUTRAL] = cardMobility(state, cards, state->side, state->neutral);
+}
+
+/*
+Static evaluation of a position from the side to move's point of view: the weighted sum of
+its evalFeatures
+
+Precondition:
+    - state must be a valid position with both senseis on the board
+
+@param state The position to evaluate
+@param cards The card table
+@param weights The feature weights
+@return Returns the score in centipawn-like units, positive favours the side to move
+*/
+int evaluateState(const gameState *state, cardInfo cards[], const evalWeights *weights)
+{
+    int features[EVAL_FEATURES];
+    int i, score = 0;
+
+    evalFeatures(state, cards, features);
+    for (i = 0; i < EVAL_FEATURES; i++)
+        score += weights->weight[i] * features[i];
+    return score;
+}
+
+/*
+Index of a piece among the network inputs. Each side sees the board from its own end, so side 1
+reads the rows upside down as its cards do, and its pieces are the "own" ones
+
+Precondition:
+    - perspective and owner must be 0 or 1
+    - square must be on the board
+
+@param perspective The side whose accumulator is updated
+@param owner The side the piece belongs to
+@param master 1 for the sensei, 0 for a student
+@param square The piece's square
+@return Returns the input feature index
+*/
+int nnuePieceFeature(int perspective, int owner, int master, int square)
+{
+    if (perspective == 1)
+        square = (ROWS - 1 - square / COLS) * COLS + square % COLS;
+    return ((owner != perspective) * 2 + master) * NUM_SQUARES + square;
+}
+
+/*
+Index of a card's place among the network inputs
+
+Precondition:
+    - perspective must be 0 or 1, holder 0, 1 or 2
+
+@param perspective The side whose accumulator is updated
+@param holder The side holding the card, 2 for the neutral card
+@param card The card id
+@return Returns the input feature index
+*/
+int nnueCardFeature(int perspective, int holder, int card)
+{
+    int place = holder == 2 ? 2 : holder != perspective;
+
+    return NNUE_PIECE_FEATURES + place * MAX_CARDS + card;
+}
+
+/*
+Reads a network in the NNUE_MAGIC format written by an external trainer
+
+Precondition: None
+
+@param filename The network file
+@param net Receives the network, net->loaded is 0 when nothing usable was read
+@return Returns 1 if the network was loaded, 0 if the file is missing or is not a network for this board size
+*/
+int loadNetwork(const char *filename, nnueNet *net)
+{
+    FILE *fp = fopen(filename, "rb");
+    nnueHeader header;
+    signed char output[2 * NNUE_HIDDEN];
+    int i;
+
+    net->loaded = 0;
+    if (fp != NULL)
+    {
+        if (fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, NNUE_MAGIC, 8) == 0 &&
+            header.version == NNUE_VERSION && header.inputs == NNUE_INPUTS && header.hidden == NNUE_HIDDEN &&
+            header.divisor > 0 &&
+            fread(net->featureBias, sizeof(net->featureBias), 1, fp) == 1 &&
+            fread(net->featureWeights, sizeof(net->featureWeights), 1, fp) == 1 &&
+            fread(output, sizeof(output), 1, fp) == 1)
+        {
+            for (i = 0; i < 2 * NNUE_HIDDEN; i++)
+                net->outputWeights[i] = output[i];
+            net->divisor = header.divisor;
+            net->outputBias = header.outputBias;
+            net->loaded = 1;
+        }
+        fclose(fp);
+    }
+    return net->loaded;
+}
+
+/*
+Builds a perspective's accumulator from a parent: adds the weight rows of the features a move
+switched on and subtracts those it switched off, eight values per SSE2 instruction
+
+Precondition:
+    - added and removed must hold valid input feature indices
+
+@param net The network
+@param parent The accumulator values before the change
+@param added Features switched on
+@param addCount Number of features in added
+@param removed Features switched off
+@param removeCount Number of features in removed
+@param child Receives the accumulator values after the change, may be parent
+@return Returns no data type (void)
+*/
+void nnueApply(const nnueNet *net, const short parent[], const int added[], int addCount, const int removed[],
+               int removeCount, short child[])
+{
+    int i, j;
+#ifdef __SSE2__
+    __m128i sum;
+
+    for (i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        sum = _mm_loadu_si128((const __m128i *) (parent + i));
+        for (j = 0; j < addCount; j++)
+            sum = _mm_add_epi16(sum, _mm_loadu_si128((const __m128i *) (net->featureWeights[added[j]] + i)));
+        for (j = 0; j < removeCount; j++)
+            sum = _mm_sub_epi16(sum, _mm_loadu_si128((const __m128i *) (net->featureWeights[removed[j]] + i)));
+        _mm_storeu_si128((__m128i *) (child + i), sum);
+    }
+#else
+    int sum;
+
+    for (i = 0; i < NNUE_HIDDEN; i++)
+    {
+        sum = parent[i];
+        for (j = 0; j < addCount; j++)
+            sum += net->featureWeights[added[j]][i];
+        for (j = 0; j < removeCount; j++)
+            sum -= net->featureWeights[removed[j]][i];
+        child[i] = (short) sum;
+    }
+#endif
+}
+
+/*
+Computes both accumulators of a position from scratch, at the root of a search
+
+Precondition:
+    - net must be loaded
+    - state must be a valid position
+
+@param net The network
+@param state The position
+@param acc Receives the accumulators
+@return Returns no data type (void)
+*/
+void nnueRefresh(const nnueNet *net, const gameState *state, nnueAccumulator *acc)
+{
+    int active[NNUE_INPUTS];
+    boardMask rest;
+    int perspective, side, slot, square, count;
+
+    for (perspective = 0; perspective < 2; perspective++)
+    {
+        count = 0;
+        for (side = 0; side < 2; side++)
+        {
+            for (rest = state->pieces[side]; rest != 0; rest &= rest - 1)
+            {
+                square = LOWEST_SQUARE(rest);
+                active[count++] = nnuePieceFeature(perspective, side, square == state->master[side], square);
+            }
+            for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+                active[count++] = nnueCardFeature(perspective, side, state->hand[side][slot]);
+        }
+        active[count++] = nnueCardFeature(perspective, 2, state->neutral);
+        nnueApply(net, net->featureBias, active, count, NULL, 0, acc->values[perspective]);
+    }
+}
+
+/*
+Updates the accumulators across a move without looking at the rest of the board: the moved
+piece, a captured piece, the played card going to the middle and the neutral card coming into
+the mover's hand
+
+Precondition:
+    - net must be loaded
+    - move must be legal in state, which is the position before it
+
+@param net The network
+@param state The position before the move
+@param move The move
+@param parent Accumulators of state
+@param child Receives the accumulators after the move
+@return Returns no data type (void)
+*/
+void nnueMove(const nnueNet *net, const gameState *state, coreMove move, const nnueAccumulator *parent,
+              nnueAccumulator *child)
+{
+    int added[NNUE_MAX_CHANGES], removed[NNUE_MAX_CHANGES];
+    int side = state->side;
+    int card = MOVE_CARD(move);
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int master = state->master[side] == from;
+    int perspective, addCount, removeCount;
+
+    for (perspective = 0; perspective < 2; perspective++)
+    {
+        added[0] = nnueCardFeature(perspective, 2, card);
+        added[1] = nnueCardFeature(perspective, side, state->neutral);
+        removed[0] = nnueCardFeature(perspective, side, card);
+        removed[1] = nnueCardFeature(perspective, 2, state->neutral);
+        addCount = removeCount = 2;
+
+        if (!MOVE_IS_PASS(move))
+        {
+            added[addCount++] = nnuePieceFeature(perspective, side, master, to);
+            removed[removeCount++] = nnuePieceFeature(perspective, side, master, from);
+            if (state->pieces[!side] & SQUARE_BIT(to))
+                removed[removeCount++] = nnuePieceFeature(perspective, !side, state->master[!side] == to, to);
+        }
+        nnueApply(net, parent->values[perspective], added, addCount, removed, removeCount,
+                  child->values[perspective]);
+    }
+}
+
+/*
+Network evaluation: the clipped accumulators of the side to move and of its opponent, weighted
+by the output layer. SSE2 multiplies eight 16-bit pairs and adds them into four 32-bit sums
+per instruction
+
+Precondition:
+    - net must be loaded
+    - acc must hold the accumulators of the position
+
+@param net The network
+@param acc The accumulators
+@param side The side to move
+@return Returns the score from the side to move's point of view, kept clear of the win scores
+*/
+int nnueEvaluate(const nnueNet *net, const nnueAccumulator *acc, int side)
+{
+    const short *halves[2];
+    int i, half, score;
+    long long sum = net->outputBias;
+#ifdef __SSE2__
+    __m128i total = _mm_setzero_si128();
+    __m128i ceiling = _mm_set1_epi16(NNUE_CLIP);
+    __m128i zero = _mm_setzero_si128();
+    __m128i clipped;
+    int lanes[4];
+#endif
+
+    halves[0] = acc->values[side];
+    halves[1] = acc->values[!side];
+    for (half = 0; half < 2; half++)
+    {
+#ifdef __SSE2__
+        for (i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            clipped = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *) (halves[half] + i)), zero),
+                                    ceiling);
+            total = _mm_add_epi32(total, _mm_madd_epi16(clipped, _mm_loadu_si128((const __m128i *)
+                                  (net->outputWeights + half * NNUE_HIDDEN + i))));
+        }
+#else
+        for (i = 0; i < NNUE_HIDDEN; i++)
+        {
+            if (halves[half][i] >= NNUE_CLIP)
+                sum += NNUE_CLIP * net->outputWeights[half * NNUE_HIDDEN + i];
+            else if (halves[half][i] > 0)
+                sum += halves[half][i] * net->outputWeights[half * NNUE_HIDDEN + i];
+        }
+#endif
+    }
+#ifdef __SSE2__
+    _mm_storeu_si128((__m128i *) lanes, total);
+    sum += (long long) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    sum /= net->divisor;
+    score = (int) sum;
+    if (sum > WIN_SCORE - MAX_SEARCH_DEPTH - 1)
+        score = WIN_SCORE - MAX_SEARCH_DEPTH - 1;
+    else if (sum < -WIN_SCORE + MAX_SEARCH_DEPTH + 1)
+        score = -WIN_SCORE + MAX_SEARCH_DEPTH + 1;
+    return score;
+}
+
+/*
+Resets everything of a search but its transposition table, and reads the evaluation weights
+from EVAL_FILE and the network from NNUE_FILE when there is one
+
+Precondition:
+    - cards and keys must stay valid for the lifetime of the search
+
+@param ctx The search context to set up
+@param cards The card table
+@param keys The Zobrist key table
+@return Returns no data type (void)
+*/
+void setupSearch(searchContext *ctx, cardInfo cards[], zobristKeys *keys)
+{
+    ctx->cards = cards;
+    ctx->keys = keys;
+    ctx->table = NULL;
+    ctx->ttMask = 0;
+    ctx->ttFile = NULL;
+    ctx->ttMapping = NULL;
+    ctx->ttView = NULL;
+    ctx->nodes = 0;
+    ctx->deadline = 0;
+    ctx->stopped = 0;
+    ctx->trace = NULL;
+    loadEvalWeights(EVAL_FILE, &ctx->weights);
+    loadNetwork(NNUE_FILE, &ctx->net);
+    historyClear(&ctx->history);
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
+/*
+Allocates the transposition table of a search and resets its counters
+
+Precondition:
+    - cards and keys must stay valid for the lifetime of the search
+    - ttBits must be between 10 and 30
+
+@param ctx The search context to set up
+@param cards The card table
+@param keys The Zobrist key table
+@param ttBits Log2 of the number of transposition table entries
+@return Returns 1 on success, 0 if the table could not be allocated
+*/
+int initSearch(searchContext *ctx, cardInfo cards[], zobristKeys *keys, int ttBits)
+{
+    setupSearch(ctx, cards, keys);
+    ctx->ttMask = ((unsigned long long) 1 << ttBits) - 1;
+    ctx->table = calloc(ctx->ttMask + 1, sizeof(ttEntry));
+
+    return ctx->table != NULL;
+}
+
+/*
+Fingerprints a card table: Zobrist keys hash card ids, so entries are only meaningful to a
+process that loaded the same cards in the same order
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns a 64-bit FNV-1a hash of the board size and the card names in order
+*/
+unsigned long long cardTablePrint(cardInfo cards[], int cardCount)
+{
+    unsigned long long print = 0xCBF29CE484222325ULL ^ BOARD_SIZE;
+    int i, j;
+
+    for (i = 0; i < cardCount; i++)
+        for (j = 0; j == 0 || cards[i].name[j - 1] != '\0'; j++)
+            print = (print ^ (unsigned char) cards[i].name[j]) * 0x100000001B3ULL;
+
+    return print;
+}
+
+/*
+Checksums the fields of a transposition table file header that precede the checksum
+
+Precondition:
+    - header must point to a header
+
+@param header The header
+@return Returns the FNV-1a hash of magic, version, ttBits and cardPrint
+*/
+unsigned long long ttHeaderChecksum(const ttFileHeader *header)
+{
+    const unsigned char *bytes = (const unsigned char *) header;
+    unsigned long long sum = 0xCBF29CE484222325ULL;
+    size_t i;
+
+    for (i = 0; i < offsetof(ttFileHeader, checksum); i++)
+        sum = (sum ^ bytes[i]) * 0x100000001B3ULL;
+
+    return sum;
+}
+
+/*
+Releases the transposition table of a search. A mapped table is written back to its file
+by the OS as the view is unmapped
+
+Precondition:
+    - ctx must have been set up with initSearch or initSearchFile
+
+@param ctx The search context to release
+@return Returns no data type (void)
+*/
+void freeSearch(searchContext *ctx)
+{
+    if (ctx->ttView != NULL)
+        UnmapViewOfFile(ctx->ttView);
+    if (ctx->ttMapping != NULL)
+        CloseHandle(ctx->ttMapping);
+    if (ctx->ttFile != NULL)
+        CloseHandle(ctx->ttFile);
+    if (ctx->ttFile == NULL)
+        free(ctx->table);
+
+    ctx->table = NULL;
+    ctx->ttView = NULL;
+    ctx->ttMapping = NULL;
+    ctx->ttFile = NULL;
+}
+
+/*
+Sets up a search whose transposition table lives in a memory-mapped file, so what one session
+learns is there for the next one and for other processes mapping the same file. Nothing is read
+up front: pages come in on first touch, so opening a table of any size is instant. A new or
+empty file is sized for 2^ttBits entries; an existing file keeps its own size. Every entry
+carries its key XOR its data, so an entry torn by a crash or a concurrent writer is a miss
+
+Precondition:
+    - cards and keys must stay valid for the lifetime of the search
+    - ttBits must be between 10 and 30
+
+@param ctx The search context to set up
+@param cards The card table
+@param cardCount Number of cards in the table
+@param keys The Zobrist key table
+@param ttBits Log2 of the number of entries of a new table file
+@param filename The table file, created if it does not exist
+@return Returns 1 on success, 0 if the file cannot be mapped or belongs to another version or card set
+*/
+int initSearchFile(searchContext *ctx, cardInfo cards[], int cardCount, zobristKeys *keys, int ttBits,
+                   const char *filename)
+{
+    LARGE_INTEGER size;
+    unsigned long long bytes = 0;
+    int fresh = 0;
+    int ok = 1;
+
+    setupSearch(ctx, cards, keys);
+    ctx->ttFile = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (ctx->ttFile == INVALID_HANDLE_VALUE)
+    {
+        ctx->ttFile = NULL;
+        ok = 0;
+    }
+
+    if (ok && GetFileSizeEx(ctx->ttFile, &size) && size.QuadPart == 0)
+    {
+        fresh = 1;
+        bytes = sizeof(ttFileHeader) + ((unsigned long long) 1 << ttBits) * sizeof(ttEntry);
+    }
+
+    // the mapping grows a new file to its full size, the OS supplies zeroed pages as they are touched
+    if (ok)
+        ctx->ttMapping = CreateFileMappingA(ctx->ttFile, NULL, PAGE_READWRITE, (DWORD) (bytes >> 32),
+                                            (DWORD) (bytes & 0xFFFFFFFF), NULL);
+    if (ctx->ttMapping != NULL)
+        ctx->ttView = MapViewOfFile(ctx->ttMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    ok = ok && ctx->ttView != NULL;
+
+    if (ok && fresh)
+    {
+        memset(ctx->ttView, 0, sizeof(ttFileHeader));
+        memcpy(ctx->ttView->magic, TT_FILE_MAGIC, sizeof(ctx->ttView->magic));
+        ctx->ttView->version = TT_FILE_VERSION;
+        ctx->ttView->ttBits = ttBits;
+        ctx->ttView->cardPrint = cardTablePrint(cards, cardCount);
+        ctx->ttView->checksum = ttHeaderChecksum(ctx->ttView);
+    }
+    else if (ok)
+        ok = GetFileSizeEx(ctx->ttFile, &size) &&
+             memcmp(ctx->ttView->magic, TT_FILE_MAGIC, sizeof(ctx->ttView->magic)) == 0 &&
+             ctx->ttView->version == TT_FILE_VERSION &&
+             ctx->ttView->checksum == ttHeaderChecksum(ctx->ttView) &&
+             ctx->ttView->cardPrint == cardTablePrint(cards, cardCount) &&
+             ctx->ttView->ttBits >= 10 && ctx->ttView->ttBits <= 30 &&
+             (unsigned long long) size.QuadPart ==
+                 sizeof(ttFileHeader) + ((unsigned long long) 1 << ctx->ttView->ttBits) * sizeof(ttEntry);
+
+    if (ok)
+    {
+        ctx->table = (ttEntry *) (ctx->ttView + 1);
+        ctx->ttMask = ((unsigned long long) 1 << ctx->ttView->ttBits) - 1;
+    }
+    else
+    {
+        printf("Error: %s is not a transposition table file of this version and card set\n", filename);
+        freeSearch(ctx);
+    }
+    return ok;
+}
+
+/*
+Sets up a search for the analysis modes: the table is mapped from "-tt-file <file>" when given,
+allocated in memory otherwise, with 2^ttBits entries
+
+Precondition:
+    - cards and keys must stay valid for the lifetime of the search
+
+@param ctx The search context to set up
+@param cards The card table
+@param cardCount Number of cards in the table
+@param keys The Zobrist key table
+@param ttFile The table file, NULL for a table in memory
+@param ttBits Log2 of the number of entries, as read by ttBitsArg
+@return Returns 1 on success, 0 if the table could not be set up
+*/
+int openSearch(searchContext *ctx, cardInfo cards[], int cardCount, zobristKeys *keys, const char *ttFile, int ttBits)
+{
+    int ok;
+
+    if (ttFile != NULL)
+        ok = initSearchFile(ctx, cards, cardCount, keys, ttBits, ttFile);
+    else
+        ok = initSearch(ctx, cards, keys, ttBits);
+    return ok;
+}
+
+/*
+Sorts moves so the hash move comes first, then sensei captures, then other captures
+
+Precondition:
+    - moves must hold count legal moves of state
+
+@param state The position the moves belong to
+@param moves The moves to order in place
+@param count Number of moves
+@param hashMove Best move remembered for this position, or 0 for none
+@return Returns no data type (void)
+*/
+void orderMoves(const gameState *state, coreMove moves[], int count, coreMove hashMove)
+{
+    int keys[MAX_CORE_MOVES];
+    int i, j, tmpKey;
+    coreMove tmpMove;
+    boardMask enemy = state->pieces[!state->side];
+
+    for (i = 0; i < count; i++)
+    {
+        keys[i] = 0;
+        if (moves[i] == hashMove)
+            keys[i] = 3;
+        else if (MOVE_TO(moves[i]) == state->master[!state->side] && !MOVE_IS_PASS(moves[i]))
+            keys[i] = 2;
+        else if (enemy & SQUARE_BIT(MOVE_TO(moves[i])) && !MOVE_IS_PASS(moves[i]))
+            keys[i] = 1;
+    }
+
+    // insertion sort, stable so generation order breaks ties
+    for (i = 1; i < count; i++)
+    {
+        tmpKey = keys[i];
+        tmpMove = moves[i];
+        for (j = i - 1; j >= 0 && keys[j] < tmpKey; j--)
+        {
+            keys[j + 1] = keys[j];
+            moves[j + 1] = moves[j];
+        }
+        keys[j + 1] = tmpKey;
+        moves[j + 1] = tmpMove;
+    }
+}
+
+/*
+Writes a move as its card name followed by from/to coordinates in the (x, y) order
+replayMovesSequence prints, e.g. "Tiger 2 4 2 2", or "Tiger pass" for a card swap
+
+Precondition:
+    - out must have room for MAX_NAME_LEN + 16 characters
+
+@param move The move to write
+@param cards The card table
+@param out Receives the text
+@return Returns no data type (void)
+*/
+void formatMove(coreMove move, cardInfo cards[], char *out)
+{
+    if (MOVE_IS_PASS(move))
+        sprintf(out, "%s pass", cards[MOVE_CARD(move)].name);
+    else
+        sprintf(out, "%s %d %d %d %d", cards[MOVE_CARD(move)].name,
+                MOVE_FROM(move) % COLS, MOVE_FROM(move) / COLS, MOVE_TO(move) % COLS, MOVE_TO(move) / COLS);
+}
+
+/*
+Writes a principal variation as its moves separated by commas, leaving out the moves that do not
+fit in room characters
+
+Precondition:
+    - line must hold at least one move
+    - room must be at least MAX_NAME_LEN + 16
+
+@param line The variation to write
+@param cards The card table
+@param room Characters available in out, terminator included
+@param out Receives the text
+@return Returns no data type (void)
+*/
+void formatPV(const pvLine *line, cardInfo cards[], int room, char *out)
+{
+    char moveText[MAX_NAME_LEN + 16];
+    int used, i;
+    int fits = 1;
+
+    formatMove(line->moves[0], cards, out);
+    used = (int) strlen(out);
+    for (i = 1; i < line->length && fits; i++)
+    {
+        formatMove(line->moves[i], cards, moveText);
+        fits = used + 2 + (int) strlen(moveText) < room;
+        if (fits)
+            used += sprintf(out + used, ", %s", moveText);
+    }
+}
+
+/*
+Opens a node of the search trace: a "B" event for Chrome's trace viewer, or an object with a
+"children" array in the JSON tree
+
+Precondition:
+    - trace->fp must be open and trace->level below MAX_SEARCH_DEPTH + 1
+
+@param trace The trace being written
+@param nodes Node counter of the search when the node starts
+@param name Label of the node, the move or the iteration
+@param alpha Lower bound of the node's window, from the point of view of the side that moved
+@param beta Upper bound of the node's window
+@return Returns no data type (void)
+*/
+void traceBegin(searchTrace *trace, unsigned long long nodes, const char *name, int alpha, int beta)
+{
+    if (!trace->first[trace->level])
+        fputs(",\n", trace->fp);
+    trace->first[trace->level] = 0;
+
+    if (trace->chrome)
+        fprintf(trace->fp, "{\"name\":\"%s\",\"cat\":\"search\",\"ph\":\"B\",\"ts\":%llu,\"pid\":1,\"tid\":1,"
+                "\"args\":{\"ply\":%d,\"alpha\":%d,\"beta\":%d}}",
+                name, microTime() - trace->start, trace->level, alpha, beta);
+    else
+        fprintf(trace->fp, "{\"name\":\"%s\",\"alpha\":%d,\"beta\":%d,\"children\":[", name, alpha, beta);
+
+    trace->nodes[trace->level] = nodes;
+    trace->level++;
+    trace->first[trace->level] = !trace->chrome; // Chrome events are one flat list
+}
+
+/*
+Closes the innermost open node of the search trace with its score and subtree size
+
+Precondition:
+    - a node must be open
+
+@param trace The trace being written
+@param nodes Node counter of the search when the node ends
+@param score Score of the node from the point of view of the side that moved
+@return Returns no data type (void)
+*/
+void traceEnd(searchTrace *trace, unsigned long long nodes, int score)
+{
+    trace->level--;
+    if (trace->chrome)
+        fprintf(trace->fp, ",\n{\"ph\":\"E\",\"ts\":%llu,\"pid\":1,\"tid\":1,\"args\":{\"score\":%d,\"nodes\":%llu}}",
+                microTime() - trace->start, score, nodes - trace->nodes[trace->level]);
+    else
+        fprintf(trace->fp, "],\"score\":%d,\"nodes\":%llu}", score, nodes - trace->nodes[trace->level]);
+}
+
+/*
+Negamax alpha-beta search with a transposition table. Children are visited with makeMove and
+unmakeMove on the one position, which is left as it was found
+
+Precondition:
+    - ctx must have been set up with initSearch
+    - state must be a valid position, hash its hash and mirrorHash its hashMirror value under ctx->keys
+
+@param ctx The search context
+@param state The position to search
+@param hash The hash of state
+@param mirrorHash The mirror hash of state
+@param depth Remaining depth in plies
+@param alpha Lower bound of the search window
+@param beta Upper bound of the search window
+@param ply Distance from the root, used to prefer faster wins
+@return Returns the score from the side to move's point of view
+*/
+int alphaBeta(searchContext *ctx, gameState *state, unsigned long long hash, unsigned long long mirrorHash, int depth,
+              int alpha, int beta, int ply)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    coreMove bestMove = 0;
+    coreMove hashMove = 0;
+    undoRecord undo;
+    ttEntry *entry;
+    unsigned long long key, childHash, childMirror, data;
+    int count, i, score, ttScore;
+    int bestScore = -WIN_SCORE;
+    int origAlpha = alpha;
+    int mirrored, flag;
+    int traced = ctx->trace != NULL && ply < ctx->trace->maxPly;
+    char moveText[MAX_NAME_LEN + 16];
+
+    ctx->nodes++;
+    if (coreWinner(state) != 0)
+        return -(WIN_SCORE - ply); // the side that just moved has won
+
+    // returning to a position already on the board or the search path can only cycle, score it a draw
+    if (historyOccurrences(&ctx->history, hash) > 0)
+        return 0;
+
+    // leaves count too, most nodes are leaves and the overshoot past the deadline stays under a check interval
+    if (ctx->deadline != 0 && (ctx->nodes & DEADLINE_CHECK_MASK) == 0 && deadlinePassed(ctx->deadline))
+        ctx->stopped = 1;
+    if (ctx->stopped)
+        return 0;
+
+    if (depth <= 0)
+        return ctx->net.loaded ? nnueEvaluate(&ctx->net, &ctx->accumulators[ply], state->side) :
+                                 evaluateState(state, ctx->cards, &ctx->weights);
+
+    // mirrored positions share an entry, its move is stored in canonical orientation
+    key = canonicalHash(state, hash, mirrorHash, ctx->cards, &mirrored);
+    entry = &ctx->table[key & ctx->ttMask];
+    data = entry->data;
+    ctx->stats.ttProbes++;
+    if ((entry->check ^ data) == key)
+    {
+        ctx->stats.ttHits++;
+        hashMove = mirrored ? mirrorMove(TT_MOVE(data), ctx->cards) : TT_MOVE(data);
+        if (TT_DEPTH(data) >= depth)
+        {
+            ttScore = TT_SCORE(data);
+            if (ttScore > WIN_SCORE - MAX_SEARCH_DEPTH)
+                ttScore -= ply;
+            else if (ttScore < -WIN_SCORE + MAX_SEARCH_DEPTH)
+                ttScore += ply;
+
+            if (TT_FLAG(data) == TT_EXACT ||
+                (TT_FLAG(data) == TT_LOWER && ttScore >= beta) ||
+                (TT_FLAG(data) == TT_UPPER && ttScore <= alpha))
+            {
+                ctx->stats.ttCutoffs++;
+                return ttScore;
+            }
+        }
+    }
+
+    count = generateMoves(state, ctx->cards, moves);
+    orderMoves(state, moves, count, hashMove);
+
+    historyPush(&ctx->history, hash);
+    for (i = 0; i < count && alpha < beta && !ctx->stopped; i++)
+    {
+        childHash = hash;
+        childMirror = mirrorHash;
+        if (ctx->net.loaded)
+            nnueMove(&ctx->net, state, moves[i], &ctx->accumulators[ply], &ctx->accumulators[ply + 1]);
+        makeMove(state, moves[i], ctx->cards, ctx->keys, &childHash, &childMirror, &undo);
+        if (traced)
+        {
+            formatMove(moves[i], ctx->cards, moveText);
+            traceBegin(ctx->trace, ctx->nodes, moveText, alpha, beta);
+        }
+        score = -alphaBeta(ctx, state, childHash, childMirror, depth - 1, -beta, -alpha, ply + 1);
+        unmakeMove(state, &undo, &childHash, &childMirror);
+        if (traced)
+            traceEnd(ctx->trace, ctx->nodes, score);
+
+        if (!ctx->stopped && score > bestScore)
+        {
+            bestScore = score;
+            bestMove = moves[i];
+            if (score > alpha)
+                alpha = score;
+        }
+    }
+    historyPop(&ctx->history);
+
+    if (ctx->stopped)
+        return 0;
+
+    // i is one past the move that failed high
+    if (alpha >= beta)
+    {
+        ctx->stats.cutoffs++;
+        if (i == 1)
+            ctx->stats.firstCutoffs++;
+    }
+
+    // mate scores are stored relative to this node so they stay valid at any ply
+    ttScore = bestScore;
+    if (ttScore > WIN_SCORE - MAX_SEARCH_DEPTH)
+        ttScore += ply;
+    else if (ttScore < -WIN_SCORE + MAX_SEARCH_DEPTH)
+        ttScore -= ply;
+
+    if (bestScore <= origAlpha)
+        flag = TT_UPPER;
+    else if (bestScore >= beta)
+        flag = TT_LOWER;
+    else
+        flag = TT_EXACT;
+
+    data = TT_PACK(mirrored ? mirrorMove(bestMove, ctx->cards) : bestMove, ttScore, depth, flag);
+    entry->check = key ^ data;
+    entry->data = data;
+
+    return bestScore;
+}
+
+/*
+Decides whether another iteration can finish in the time left. An iteration costs about the last
+one times the growth between the last two, and one cut off by the deadline is thrown away, so an
+iteration that cannot finish is not started and its time stays on the clock
+
+Precondition:
+    - stats must hold the counters of the iterations up to depth
+
+@param stats Counters of the running search
+@param depth The iteration just completed
+@param started microTime() when the search began
+@param timeMs Time limit of the search in milliseconds, 0 for no limit
+@return Returns 1 if the next iteration is expected to finish in time, 0 if not
+*/
+int iterationFits(const searchStats *stats, int depth, unsigned long long started, int timeMs)
+{
+    unsigned long long expected = stats->iterMicros[depth];
+    int fits = 1;
+
+    if (timeMs > 0)
+    {
+        if (depth > 1 && stats->iterNodes[depth - 1] > 0)
+            expected = expected * stats->iterNodes[depth] / stats->iterNodes[depth - 1];
+        fits = microTime() - started + expected <= (unsigned long long) timeMs * 1000;
+    }
+    return fits;
+}
+
+/*
+Iterative deepening search from the root. Keeps the result of the last completed
+iteration when the time limit runs out, and does not start one it cannot finish
+
+Precondition:
+    - ctx must have been set up with initSearch
+    - ctx->history must hold the positions played before state, cleared for a lone position
+    - state must be a valid position that is not already won
+
+@param ctx The search context
+@param state The position to analyze
+@param maxDepth Deepest iteration to run, at most MAX_SEARCH_DEPTH
+@param timeMs Time limit in milliseconds, 0 for no limit
+@param result Receives best move, score, completed depth and node count
+@return Returns no data type (void)
+*/
+void searchPosition(searchContext *ctx, const gameState *state, int maxDepth, int timeMs, searchResult *result)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    gameState work = *state;
+    undoRecord undo;
+    unsigned long long hash = hashState(state, ctx->keys);
+    unsigned long long mirrorHash = hashMirror(state, ctx->cards, ctx->keys);
+    unsigned long long childHash, childMirror;
+    int count, depth, i, score, alpha;
+    int iterBestScore;
+    coreMove iterBest;
+    unsigned long long started = microTime();
+    unsigned long long iterStarted, iterNodes;
+    char label[MAX_NAME_LEN + 16];
+
+    ctx->nodes = 0;
+    ctx->stopped = 0;
+    ctx->deadline = counterDeadline((long long) timeMs * 1000);
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    if (ctx->net.loaded)
+        nnueRefresh(&ctx->net, state, &ctx->accumulators[0]);
+
+    count = generateMoves(state, ctx->cards, moves);
+    result->best = moves[0];
+    result->score = 0;
+    result->depth = 0;
+    historyPush(&ctx->history, hash);
+
+    for (depth = 1; depth <= maxDepth && !ctx->stopped; depth++)
+    {
+        orderMoves(state, moves, count, result->best);
+        alpha = -WIN_SCORE;
+        iterBest = moves[0];
+        iterBestScore = -WIN_SCORE;
+        iterStarted = microTime();
+        iterNodes = ctx->nodes;
+        if (ctx->trace != NULL)
+        {
+            sprintf(label, "depth %d", depth);
+            traceBegin(ctx->trace, ctx->nodes, label, -WIN_SCORE, WIN_SCORE);
+        }
+
+        for (i = 0; i < count && !ctx->stopped; i++)
+        {
+            childHash = hash;
+            childMirror = mirrorHash;
+            if (ctx->net.loaded)
+                nnueMove(&ctx->net, &work, moves[i], &ctx->accumulators[0], &ctx->accumulators[1]);
+            makeMove(&work, moves[i], ctx->cards, ctx->keys, &childHash, &childMirror, &undo);
+            if (ctx->trace != NULL && ctx->trace->maxPly > 0)
+            {
+                formatMove(moves[i], ctx->cards, label);
+                traceBegin(ctx->trace, ctx->nodes, label, alpha, WIN_SCORE);
+            }
+            score = -alphaBeta(ctx, &work, childHash, childMirror, depth - 1, -WIN_SCORE, -alpha, 1);
+            unmakeMove(&work, &undo, &childHash, &childMirror);
+            if (ctx->trace != NULL && ctx->trace->maxPly > 0)
+                traceEnd(ctx->trace, ctx->nodes, score);
+
+            if (!ctx->stopped && score > iterBestScore)
+            {
+                iterBestScore = score;
+                iterBest = moves[i];
+                if (score > alpha)
+                    alpha = score;
+            }
+        }
+
+        if (ctx->trace != NULL)
+            traceEnd(ctx->trace, ctx->nodes, iterBestScore);
+
+        if (!ctx->stopped)
+        {
+            result->best = iterBest;
+            result->score = iterBestScore;
+            result->depth = depth;
+            ctx->stats.iterNodes[depth] = ctx->nodes - iterNodes;
+            ctx->stats.iterMicros[depth] = microTime() - iterStarted;
+
+            if (iterBestScore > WIN_SCORE - MAX_SEARCH_DEPTH)
+                depth = maxDepth; // a forced win was found, deeper iterations cannot improve it
+            else if (!iterationFits(&ctx->stats, depth, started, timeMs))
+                depth = maxDepth;
+        }
+    }
+    historyPop(&ctx->history);
+    result->nodes = ctx->nodes;
+    ctx->stats.micros = microTime() - started;
+}
+
+/*
+Follows the moves the transposition table remembers from the position after first, giving the
+principal variation that starts with it. Each move is checked against the legal moves before it
+is played, so a colliding or overwritten entry ends the line instead of corrupting it
+
+Precondition:
+    - ctx must hold the table filled by the search of state
+    - first must be a legal move of state
+
+@param ctx The search context
+@param state The root position
+@param first The root move the variation starts with
+@param maxLength Most moves to return, at most MAX_PV_LEN
+@param pv Receives the moves of the variation
+@return Returns the number of moves written, at least 1
+*/
+int extractPV(searchContext *ctx, const gameState *state, coreMove first, int maxLength, coreMove pv[])
+{
+    coreMove moves[MAX_CORE_MOVES];
+    gameState work = *state;
+    undoRecord undo;
+    ttEntry *entry;
+    unsigned long long hash = hashState(state, ctx->keys);
+    unsigned long long mirrorHash = hashMirror(state, ctx->cards, ctx->keys);
+    unsigned long long key, data;
+    int length = 1, found = 1;
+    int count, i, mirrored;
+    coreMove move = 0;
+
+    pv[0] = first;
+    makeMove(&work, first, ctx->cards, ctx->keys, &hash, &mirrorHash, &undo);
+    while (found && length < maxLength && coreWinner(&work) == 0)
+    {
+        key = canonicalHash(&work, hash, mirrorHash, ctx->cards, &mirrored);
+        entry = &ctx->table[key & ctx->ttMask];
+        data = entry->data;
+        found = (entry->check ^ data) == key;
+        if (found)
+        {
+            move = mirrored ? mirrorMove(TT_MOVE(data), ctx->cards) : TT_MOVE(data);
+            count = generateMoves(&work, ctx->cards, moves);
+            found = 0;
+            for (i = 0; i < count && !found; i++)
+                found = moves[i] == move;
+        }
+
+        if (found)
+        {
+            pv[length++] = move;
+            makeMove(&work, move, ctx->cards, ctx->keys, &hash, &mirrorHash, &undo);
+        }
+    }
+
+    return length;
+}
+
+/*
+Iterative deepening search that ranks the lineCount best root moves instead of only the best one.
+Every root move is searched with its lower bound at the score of the current last line, so a
+move that cannot enter the list fails low as cheaply as in a single-PV search; only the moves
+that do enter it are scored exactly. A variation is read from the table right after its move is
+searched, before other root moves overwrite its entries. Results are those of the last completed
+iteration
+
+Precondition:
+    - ctx must have been set up with initSearch
+    - ctx->history must hold the positions played before state, cleared for a lone position
+    - state must be a valid position that is not already won
+    - lineCount must be between 1 and MAX_MULTIPV
+
+@param ctx The search context
+@param state The position to analyze
+@param maxDepth Deepest iteration to run, at most MAX_SEARCH_DEPTH
+@param timeMs Time limit in milliseconds, 0 for no limit
+@param lineCount Number of lines wanted
+@param lines Receives the lines, best first, each with its score and principal variation
+@param result Receives the best move, its score, completed depth and node count
+@return Returns the number of lines written, fewer than lineCount when there are fewer legal moves
+*/
+int searchMultiPV(searchContext *ctx, const gameState *state, int maxDepth, int timeMs, int lineCount,
+                  pvLine lines[], searchResult *result)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    coreMove ordered[MAX_CORE_MOVES];
+    pvLine top[MAX_MULTIPV];
+    gameState work = *state;
+    undoRecord undo;
+    unsigned long long hash = hashState(state, ctx->keys);
+    unsigned long long mirrorHash = hashMirror(state, ctx->cards, ctx->keys);
+    unsigned long long childHash, childMirror;
+    int count, depth, i, j, k, score, alpha, filled, decided, ranked;
+    int found = 0;
+    unsigned long long started = microTime();
+    unsigned long long iterStarted, iterNodes;
+
+    ctx->nodes = 0;
+    ctx->stopped = 0;
+    ctx->deadline = counterDeadline((long long) timeMs * 1000);
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    if (ctx->net.loaded)
+        nnueRefresh(&ctx->net, state, &ctx->accumulators[0]);
+
+    count = generateMoves(state, ctx->cards, moves);
+    orderMoves(state, moves, count, 0);
+    if (lineCount > count)
+        lineCount = count;
+    result->best = moves[0];
+    result->score = 0;
+    result->depth = 0;
+    historyPush(&ctx->history, hash);
+
+    for (depth = 1; depth <= maxDepth && !ctx->stopped; depth++)
+    {
+        filled = 0;
+        iterStarted = microTime();
+        iterNodes = ctx->nodes;
+
+        for (i = 0; i < count && !ctx->stopped; i++)
+        {
+            alpha = filled < lineCount ? -WIN_SCORE : top[filled - 1].score;
+            childHash = hash;
+            childMirror = mirrorHash;
+            if (ctx->net.loaded)
+                nnueMove(&ctx->net, &work, moves[i], &ctx->accumulators[0], &ctx->accumulators[1]);
+            makeMove(&work, moves[i], ctx->cards, ctx->keys, &childHash, &childMirror, &undo);
+            score = -alphaBeta(ctx, &work, childHash, childMirror, depth - 1, -WIN_SCORE, -alpha, 1);
+            unmakeMove(&work, &undo, &childHash, &childMirror);
+
+            // insert into the list kept best first, the last line drops out when it is full
+            if (!ctx->stopped && (filled < lineCount || score > alpha))
+            {
+                if (filled < lineCount)
+                    filled++;
+                for (j = filled - 1; j > 0 && top[j - 1].score < score; j--)
+                    top[j] = top[j - 1];
+                top[j].score = score;
+                top[j].length = extractPV(ctx, state, moves[i], depth < MAX_PV_LEN ? depth : MAX_PV_LEN,
+                                          top[j].moves);
+            }
+        }
+
+        if (!ctx->stopped)
+        {
+            found = filled;
+            decided = 1;
+            for (i = 0; i < found; i++)
+            {
+                lines[i] = top[i];
+                if (top[i].score > -WIN_SCORE + MAX_SEARCH_DEPTH && top[i].score < WIN_SCORE - MAX_SEARCH_DEPTH)
+                    decided = 0;
+            }
+            result->best = top[0].moves[0];
+            result->score = top[0].score;
+            result->depth = depth;
+            ctx->stats.iterNodes[depth] = ctx->nodes - iterNodes;
+            ctx->stats.iterMicros[depth] = microTime() - iterStarted;
+
+            // the ranked moves lead the next iteration, the others keep their order
+            j = 0;
+            for (i = 0; i < found; i++)
+                ordered[j++] = top[i].moves[0];
+            for (i = 0; i < count; i++)
+            {
+                ranked = 0;
+                for (k = 0; k < found; k++)
+                    if (top[k].moves[0] == moves[i])
+                        ranked = 1;
+                if (!ranked)
+                    ordered[j++] = moves[i];
+            }
+            memcpy(moves, ordered, count * sizeof(coreMove));
+
+            if (decided)
+                depth = maxDepth; // every line is a forced result, deeper iterations cannot change them
+            else if (!iterationFits(&ctx->stats, depth, started, timeMs))
+                depth = maxDepth;
+        }
+    }
+    historyPop(&ctx->history);
+
+    result->nodes = ctx->nodes;
+    ctx->stats.micros = microTime() - started;
+    return found;
+}
+
+/*
+Fills the analysis panel shown beside the board: a title row, then the COACH_LINES best moves of
+the position, each with its score for the side to move and as much of its variation as fits.
+Wins and losses are shown as the number of plies until they happen. The search runs for
+COACH_TIME_MS without the game's earlier positions, so repetitions are not foreseen
+
+Precondition:
+    - state must be a valid position
+
+@param state The position to analyze
+@param cards The card table
+@param panel Receives the rows, none when the game is over or no table could be allocated
+@return Returns no data type (void)
+*/
+void fillAnalysisPanel(const gameState *state, cardInfo cards[], analysisPanel *panel)
+{
+    searchContext ctx;
+    searchResult result;
+    zobristKeys keys;
+    pvLine lines[COACH_LINES];
+    char scoreText[24];
+    char pvText[MAX_PANEL_TEXT];
+    int found, i;
+
+    panel->lineCount = 0;
+    initZobrist(&keys);
+    if (coreWinner(state) == 0 && initSearch(&ctx, cards, &keys, COACH_TT_BITS))
+    {
+        historyClear(&ctx.history);
+        found = searchMultiPV(&ctx, state, MAX_SEARCH_DEPTH, COACH_TIME_MS, COACH_LINES, lines, &result);
+        sprintf(panel->text[0], "\x1b[36m" "Best moves, depth %d" "\x1b[0m", result.depth);
+        for (i = 0; i < found; i++)
+        {
+            if (lines[i].score > WIN_SCORE - MAX_SEARCH_DEPTH)
+                sprintf(scoreText, "win in %d", WIN_SCORE - lines[i].score);
+            else if (lines[i].score < -WIN_SCORE + MAX_SEARCH_DEPTH)
+                sprintf(scoreText, "loss in %d", WIN_SCORE + lines[i].score);
+            else
+                sprintf(scoreText, "%+d", lines[i].score);
+            formatPV(&lines[i], cards, MAX_PANEL_TEXT - 16, pvText);
+            sprintf(panel->text[i + 1], "%d. %-10s %s", i + 1, scoreText, pvText);
+        }
+        panel->lineCount = found + 1;
+        freeSearch(&ctx);
+    }
+}
+
+/*
+Takes a node from the solver's pool
+
+Precondition:
+    - solver must have been reset with pnReset
+
+@param solver The solver
+@return Returns the pool index of the node, or -1 if the pool is exhausted
+*/
+int pnAllocNode(pnSolver *solver)
+{
+    int index = solver->freeList;
+
+    if (index >= 0)
+    {
+        solver->freeList = solver->nodes[index].sibling;
+        solver->used++;
+        if (solver->used > solver->peak)
+            solver->peak = solver->used;
+    }
+    return index;
+}
+
+/*
+Returns a node and everything below it to the pool
+
+Precondition:
+    - index must be a node in use that is no longer linked from its parent
+
+@param solver The solver
+@param index The subtree to release
+@return Returns no data type (void)
+*/
+void pnFreeSubtree(pnSolver *solver, int index)
+{
+    int child = solver->nodes[index].child;
+    int next;
+
+    while (child != -1)
+    {
+        next = solver->nodes[child].sibling;
+        pnFreeSubtree(solver, child);
+        child = next;
+    }
+
+    solver->nodes[index].sibling = solver->freeList;
+    solver->freeList = index;
+    solver->used--;
+}
+
+/*
+Empties the pool and places a new root
+
+Precondition:
+    - solver->nodes must hold solver->capacity nodes
+
+@param solver The solver
+@param state The position to solve
+@param attacker The side that has to force the win
+@return Returns no data type (void)
+*/
+void pnReset(pnSolver *solver, const gameState *state, int attacker)
+{
+    int i;
+    pnNode *root;
+
+    for (i = 0; i < solver->capacity; i++)
+        solver->nodes[i].sibling = i + 1 < solver->capacity ? i + 1 : -1;
+    solver->freeList = 0;
+    solver->used = 0;
+    solver->peak = 0;
+    solver->attacker = attacker;
+    solver->stopped = 0;
+    solver->expansions = 0;
+
+    solver->root = pnAllocNode(solver);
+    root = &solver->nodes[solver->root];
+    root->state = *state;
+    root->hash = hashState(state, solver->keys);
+    root->proof = 1;
+    root->disproof = 1;
+    root->parent = -1;
+    root->child = -1;
+    root->sibling = -1;
+    root->distance = 0;
+    root->move = 0;
+}
+
+/*
+Checks whether a position already occurs on the path from the root to a node
+
+Precondition:
+    - index must be a node in use
+
+@param solver The solver
+@param index The last node of the path
+@param hash Hash of the position to look for
+@return Returns 1 if the position repeats the path, 0 otherwise
+*/
+int pnRepeats(pnSolver *solver, int index, unsigned long long hash)
+{
+    int found = 0;
+
+    while (index != -1 && !found)
+    {
+        found = solver->nodes[index].hash == hash;
+        index = solver->nodes[index].parent;
+    }
+    return found;
+}
+
+/*
+Adds two proof or disproof numbers, saturating at PN_INFINITY
+
+Precondition:
+    - a and b must be at most PN_INFINITY
+
+@param a First number
+@param b Second number
+@return Returns the capped sum
+*/
+unsigned int pnSum(unsigned int a, unsigned int b)
+{
+    return a + b >= PN_INFINITY ? PN_INFINITY : a + b;
+}
+
+/*
+Recomputes a node's proof and disproof numbers from its children. The attacker needs one
+winning child (OR node), the defender must be refuted in every child (AND node)
+
+Precondition:
+    - index must be an expanded node
+
+@param solver The solver
+@param index The node to update
+@return Returns no data type (void)
+*/
+void pnSetNumbers(pnSolver *solver, int index)
+{
+    pnNode *node = &solver->nodes[index];
+    pnNode *c;
+    int orNode = node->state.side == solver->attacker;
+    int child;
+
+    node->proof = orNode ? PN_INFINITY : 0;
+    node->disproof = orNode ? 0 : PN_INFINITY;
+
+    for (child = node->child; child != -1; child = c->sibling)
+    {
+        c = &solver->nodes[child];
+        if (orNode)
+        {
+            if (c->proof < node->proof)
+                node->proof = c->proof;
+            node->disproof = pnSum(node->disproof, c->disproof);
+        }
+        else
+        {
+            node->proof = pnSum(node->proof, c->proof);
+            if (c->disproof < node->disproof)
+                node->disproof = c->disproof;
+        }
+    }
+}
+
+/*
+Garbage collects below a solved node. A disproven node drops all children; a proven node
+keeps only the child of its principal line (the fastest win for the attacker, the longest
+resistance for the defender) so the winning line survives at a few nodes per ply
+
+Precondition:
+    - index must be an expanded node whose proof or disproof number is 0
+
+@param solver The solver
+@param index The solved node
+@return Returns no data type (void)
+*/
+void pnCollect(pnSolver *solver, int index)
+{
+    pnNode *node = &solver->nodes[index];
+    int orNode = node->state.side == solver->attacker;
+    int keep = -1;
+    int child, next;
+
+    for (child = node->child; child != -1 && node->proof == 0; child = solver->nodes[child].sibling)
+    {
+        if (solver->nodes[child].proof == 0 &&
+            (keep == -1 ||
+             (orNode && solver->nodes[child].distance < solver->nodes[keep].distance) ||
+             (!orNode && solver->nodes[child].distance > solver->nodes[keep].distance)))
+            keep = child;
+    }
+
+    child = node->child;
+    while (child != -1)
+    {
+        next = solver->nodes[child].sibling;
+        if (child != keep)
+            pnFreeSubtree(solver, child);
+        child = next;
+    }
+
+    node->child = keep;
+    if (keep != -1)
+    {
+        solver->nodes[keep].sibling = -1;
+        node->distance = solver->nodes[keep].distance + 1;
+    }
+}
+
+/*
+Adds every move of a leaf as a child. Wins and losses are solved on the spot and a move
+back into a position on the current path is a draw, which never proves a win
+
+Precondition:
+    - index must be an unexpanded, unsolved node
+
+@param solver The solver
+@param index The leaf to expand
+@return Returns 1 on success, 0 if the pool ran out (the leaf is left unexpanded)
+*/
+int pnExpand(pnSolver *solver, int index)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    pnNode *c;
+    int count, i, child, winner;
+    int last = -1;
+    int ok = 1;
+
+    count = generateMoves(&solver->nodes[index].state, solver->cards, moves);
+
+    for (i = 0; i < count && ok; i++)
+    {
+        child = pnAllocNode(solver);
+        if (child < 0)
+            ok = 0;
+        else
+        {
+            c = &solver->nodes[child];
+            applyCoreMove(&solver->nodes[index].state, moves[i], solver->cards, &c->state);
+            c->hash = hashState(&c->state, solver->keys);
+            c->parent = index;
+            c->child = -1;
+            c->sibling = -1;
+            c->distance = 0;
+            c->move = moves[i];
+            c->proof = 1;
+            c->disproof = 1;
+
+            winner = coreWinner(&c->state);
+            if (winner == solver->attacker + 1)
+            {
+                c->proof = 0;
+                c->disproof = PN_INFINITY;
+            }
+            else if (winner != 0 || pnRepeats(solver, index, c->hash))
+            {
+                c->proof = PN_INFINITY;
+                c->disproof = 0;
+            }
+
+            if (last == -1)
+                solver->nodes[index].child = child;
+            else
+                solver->nodes[last].sibling = child;
+            last = child;
+        }
+    }
+
+    if (!ok)
+    {
+        child = solver->nodes[index].child;
+        while (child != -1)
+        {
+            last = solver->nodes[child].sibling;
+            pnFreeSubtree(solver, child);
+            child = last;
+        }
+        solver->nodes[index].child = -1;
+    }
+    return ok;
+}
+
+/*
+Walks down from a node to the most-proving leaf: the child with the smallest proof number
+where the attacker moves, the smallest disproof number where the defender moves
+
+Precondition:
+    - index must be an unsolved node
+
+@param solver The solver
+@param index Node to start from
+@return Returns the pool index of the leaf to expand
+*/
+int pnSelect(pnSolver *solver, int index)
+{
+    int child, best;
+    int orNode;
+
+    while (solver->nodes[index].child != -1)
+    {
+        orNode = solver->nodes[index].state.side == solver->attacker;
+        best = solver->nodes[index].child;
+        for (child = solver->nodes[best].sibling; child != -1; child = solver->nodes[child].sibling)
+        {
+            if (( orNode && solver->nodes[child].proof < solver->nodes[best].proof) ||
+                (!orNode && solver->nodes[child].disproof < solver->nodes[best].disproof))
+                best = child;
+        }
+        index = best;
+    }
+    return index;
+}
+
+/*
+Propagates new numbers from an expanded leaf towards the root, collecting solved nodes,
+and stops at the first ancestor whose numbers did not change
+
+Precondition:
+    - index must be the node expanded last
+
+@param solver The solver
+@param index The expanded node
+@return Returns the node the next most-proving leaf search can start from
+*/
+int pnUpdate(pnSolver *solver, int index)
+{
+    pnNode *node;
+    unsigned int oldProof, oldDisproof;
+    int last = index;
+    int changed = 1;
+
+    while (index != -1 && changed)
+    {
+        node = &solver->nodes[index];
+        oldProof = node->proof;
+        oldDisproof = node->disproof;
+
+        pnSetNumbers(solver, index);
+        if (node->proof == 0 || node->disproof == 0)
+            pnCollect(solver, index);
+
+        changed = node->proof != oldProof || node->disproof != oldDisproof;
+        last = index;
+        index = node->parent;
+    }
+    return last;
+}
+
+/*
+Proof-number search: tries to prove that attacker can force a win from the position,
+within the node pool and time limit of the solver
+
+Precondition:
+    - solver->nodes, capacity, cards, keys and deadline must be set
+    - state must be a valid position that is not already won
+
+@param solver The solver, its tree holds the winning line afterwards
+@param state The position to solve
+@param attacker The side that has to force the win
+@return Returns 1 if the win is proven, 0 if it is disproven, -1 if the search ran out of nodes or time
+*/
+int pnSolve(pnSolver *solver, const gameState *state, int attacker)
+{
+    pnNode *root;
+    int current, leaf;
+
+    pnReset(solver, state, attacker);
+    root = &solver->nodes[solver->root];
+    current = solver->root;
+
+    while (root->proof != 0 && root->disproof != 0 && !solver->stopped)
+    {
+        leaf = pnSelect(solver, current);
+        if (!pnExpand(solver, leaf))
+            solver->stopped = 1;
+        else
+        {
+            solver->expansions++;
+            current = pnUpdate(solver, leaf);
+
+            if (solver->deadline != 0 && (solver->expansions & 1023) == 0 && deadlinePassed(solver->deadline))
+                solver->stopped = 1;
+        }
+    }
+
+    return root->proof == 0 ? 1 : (root->disproof == 0 ? 0 : -1);
+}
+
+/*
+Exhaustive check, without pruning heuristics or a transposition table, that attacker can
+force a win within a number of plies whoever is to move
+
+Precondition:
+    - state must be a valid position
+
+@param state The position to check
+@param cards The card table
+@param attacker The side that has to win
+@param plies Plies left, the attacker's winning move included
+@return Returns 1 if every defence loses within plies, 0 otherwise
+*/
+int forcedWin(const gameState *state, cardInfo cards[], int attacker, int plies)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    gameState child;
+    int winner = coreWinner(state);
+    int orNode = state->side == attacker;
+    int count, i, result;
+
+    if (winner != 0)
+        result = winner == attacker + 1;
+    else if (plies <= 0)
+        result = 0;
+    else
+    {
+        // the attacker needs one winning move, the defender must have none that holds
+        count = generateMoves(state, cards, moves);
+        result = !orNode;
+        for (i = 0; i < count && result != orNode; i++)
+        {
+            applyCoreMove(state, moves[i], cards, &child);
+            result = forcedWin(&child, cards, attacker, plies - 1);
+        }
+    }
+    return result;
+}
+
+/*
+Summarizes the counters of a finished search: nodes per second, effective branching factor of
+the last iteration, transposition table hit and cutoff rates (per probe) and the share of
+fail-high nodes that were cut by their first move
+
+Precondition:
+    - result and stats must come from the same searchPosition call
+    - out must have room for MAX_RESULT_LEN characters
+
+@param result The search result
+@param stats The search counters
+@param out Receives the text, starting with a space
+@return Returns no data type (void)
+*/
+void formatSearchStats(const searchResult *result, const searchStats *stats, char *out)
+{
+    double probes = stats->ttProbes > 0 ? (double) stats->ttProbes : 1.0;
+    double ebf = 0.0;
+
+    if (result->depth >= 2 && stats->iterNodes[result->depth - 1] > 0)
+        ebf = (double) stats->iterNodes[result->depth] / stats->iterNodes[result->depth - 1];
+
+    sprintf(out, " nps %.0f ebf %.2f tthit %.1f%% ttcut %.1f%% firstcut %.1f%% time %.1fms",
+            result->nodes * 1000000.0 / (stats->micros > 0 ? stats->micros : 1), ebf,
+            100.0 * stats->ttHits / probes, 100.0 * stats->ttCutoffs / probes,
+            stats->cutoffs > 0 ? 100.0 * stats->firstCutoffs / stats->cutoffs : 0.0, stats->micros / 1000.0);
+}
+
+/*
+Writes a position in the compact notation used by the batch modes:
+"<rows top to bottom> <P1 cards> <P2 cards> <neutral> <b|r> <round>". Rows are separated
+by '/', M/S are Player 1 (BLUE), m/s are Player 2 (RED) and digits count empty squares,
+e.g. "ssmss/5/5/5/SSMSS Boar,Crab Tiger,Eel Frog r 1"
+
+Precondition:
+    - state must be a valid position
+    - out must have room for MAX_POSITION_LEN characters
+
+@param state The position to write
+@param cards The card table
+@param out Receives the notation
+@return Returns no data type (void)
+*/
+void formatPosition(const gameState *state, cardInfo cards[], char *out)
+{
+    int row, col, sq, empty;
+    char *p = out;
+
+    for (row = 0; row < ROWS; row++)
+    {
+        empty = 0;
+        for (col = 0; col < COLS; col++)
+        {
+            sq = SQUARE_OF(row, col);
+            if (state->pieces[0] & SQUARE_BIT(sq) || state->pieces[1] & SQUARE_BIT(sq))
+            {
+                if (empty > 0)
+                    *p++ = (char) ('0' + empty);
+                empty = 0;
+
+                if (state->pieces[0] & SQUARE_BIT(sq))
+                    *p++ = sq == state->master[0] ? 'M' : 'S';
+                else
+                    *p++ = sq == state->master[1] ? 'm' : 's';
+            }
+            else
+                empty++;
+        }
+        if (empty > 0)
+            *p++ = (char) ('0' + empty);
+        if (row < ROWS - 1)
+            *p++ = '/';
+    }
+
+    sprintf(p, " %s,%s %s,%s %s %c %d",
+            cards[state->hand[0][0]].name, cards[state->hand[0][1]].name,
+            cards[state->hand[1][0]].name, cards[state->hand[1][1]].name,
+            cards[state->neutral].name, state->side == 0 ? 'b' : 'r', state->round);
+}
+
+/*
+Reads a position written by formatPosition and checks that it is well formed
+
+Precondition:
+    - text must be a null-terminated string
+    - cards must hold cardCount loaded cards
+
+@param text The notation to read
+@param cards The card table
+@param cardCount Number of cards in the table
+@param state Receives the position
+@return Returns 1 if the position was read, 0 if it is malformed
+*/
+int parsePosition(const char *text, cardInfo cards[], int cardCount, gameState *state)
+{
+    char rows[MAX_POSITION_LEN];
+    char names[MAX_CARD_PER_GAME][MAX_NAME_LEN];
+    char sideChar;
+    int ids[MAX_CARD_PER_GAME];
+    int row = 0, col = 0;
+    int i, j, side, sq;
+    int ok = 1;
+    const char *p;
+
+    if (sscanf(text, "%199s %30[^,],%30s %30[^,],%30s %30s %c %d", rows, names[0], names[1],
+               names[2], names[3], names[4], &sideChar, &state->round) != 8)
+        ok = 0;
+
+    state->pieces[0] = state->pieces[1] = 0;
+    state->master[0] = state->master[1] = -1;
+
+    for (p = rows; ok && *p != '\0'; p++)
+    {
+        if (*p == '/')
+        {
+            ok = col == COLS;
+            row++;
+            col = 0;
+        }
+        else if (*p >= '1' && *p <= '9')
+            col += *p - '0';
+        else if (row < ROWS && col < COLS && strchr("MSms", *p) != NULL)
+        {
+            side = *p == 'm' || *p == 's';
+            sq = SQUARE_OF(row, col);
+            state->pieces[side] |= SQUARE_BIT(sq);
+            if (*p == 'M' || *p == 'm')
+            {
+                ok = state->master[side] < 0;
+                state->master[side] = sq;
+            }
+            col++;
+        }
+        else
+            ok = 0;
+
+        if (col > COLS)
+            ok = 0;
+    }
+    if (row != ROWS - 1 || col != COLS)
+        ok = 0;
+
+    for (i = 0; ok && i < MAX_CARD_PER_GAME; i++)
+    {
+        ids[i] = findCardId(cards, cardCount, names[i]);
+        ok = ids[i] >= 0;
+        for (j = 0; ok && j < i; j++)
+            ok = ids[j] != ids[i];
+    }
+
+    if (ok)
+    {
+        state->hand[0][0] = ids[0];
+        state->hand[0][1] = ids[1];
+        state->hand[1][0] = ids[2];
+        state->hand[1][1] = ids[3];
+        state->neutral = ids[4];
+        state->side = sideChar == 'r';
+        refreshAttacks(state, cards);
+        ok = (sideChar == 'b' || sideChar == 'r') && state->round >= 1 &&
+             COUNT_SQUARES(state->pieces[0]) <= NUM_OF_STUD && COUNT_SQUARES(state->pieces[1]) <= NUM_OF_STUD;
+    }
+    return ok;
+}
+
+/*
+Distributes the first 5 index of moveDeck cards to players and sets up the initial game cards
+
+Precondition: 
+    - moveDeck must contain at least 5 initialized card strings
+    - p1 and p2 must be valid player pointers with properly allocated card arrays
+    - crdsIG must be a valid dataCrdsIG pointer
+    - moveDeck must have been previously shuffled
+
+@param str30 moveDeck[] Array containing the shuffled deck of cards to distribute
+@param *p1 Pointer to player 1's data structure to receive their cards
+@param *p2 Pointer to player 2's data structure to receive their cards
+@param *crdsIG Pointer to game card data structure for initial setup
+@return Returns no data type (void)
+*/
+void assignMoveCards(str30 moveDeck[], player *p1, player *p2, dataCrdsIG *crdsIG) 
+{
+    int i;
+
+    // Assigns the first 4 cards to player 1 and 2 and the fifth card in the index of movedeck to the rightcard or middle card
+    strcpy(p1->card.playercard[0], moveDeck[0]);
+    strcpy(p1->card.playercard[1], moveDeck[1]);
+
+    strcpy(p2->card.playercard[0], moveDeck[2]);
+    strcpy(p2->card.playercard[1], moveDeck[3]);
+
+    strcpy(crdsIG->lCardName, "None"); // Initializes the left card
+    strcpy(crdsIG->rCardName, moveDeck[4]);
+
+    // loads the patterns of the cards each player holds, padded to the board size
+    for (i = 0; i < MAX_CARDS_PER_PLAYER; i++)
+    {
+        loadCardPattern(p1->card.playercard[i], p1->card.visualCard[i]);
+        loadCardPattern(p2->card.playercard[i], p2->card.visualCard[i]);
+    }
+
+    // the middle card or rightcard
+    loadCardPattern(crdsIG->rCardName, crdsIG->rCardDisp);
+
+    for(i=0;i<TEXT_FILE_ROWS;i++) // initializes the left card for displaying otherwise it would display null chars
+        blankCardRow(crdsIG->lCardDisp[i]);
+}
+
+/*
+Checks if a character is alphabetic
+
+Precondition: 
+    - Input must be a single character
+
+@param name The character to check
+@return Returns 1 if character is alphabetic, 0 otherwise
+*/
+int isAlpha (char name)
+{
+    return (name >= 'A' && name <= 'Z') || (name >= 'a' && name <= 'z');
+}
+
+/*
+Finds the pieces of the side to move that have at least one legal move with a card, the squares
+the piece cursor may stop on
+
+Precondition:
+    - state must be a valid position, usually built with stateFromBoard
+    - card must be one of the hand cards of the side to move
+
+@param state The position
+@param cards The card table
+@param card The card the player chose
+@return Returns the mask of the movable pieces
+*/
+boardMask legalPieces(const gameState *state, cardInfo cards[], int card)
+{
+    int side = state->side;
+    boardMask own = state->pieces[side];
+    boardMask movable = 0;
+    boardMask from;
+    int fromSq;
+
+    for (from = own; from; from &= from - 1)
+    {
+        fromSq = LOWEST_SQUARE(from);
+        if (cards[card].moves[side][fromSq] & ~own)
+            movable |= SQUARE_BIT(fromSq);
+    }
+    return movable;
+}
+
+/*
+Finds the squares a piece may move to with a card, the squares the destination cursor may stop on
+
+Precondition:
+    - state must be a valid position, usually built with stateFromBoard
+    - square must hold a piece of the side to move
+
+@param state The position
+@param cards The card table
+@param card The card the player chose
+@param square Square of the chosen piece
+@return Returns the mask of the legal destinations
+*/
+boardMask legalDestinations(const gameState *state, cardInfo cards[], int card, int square)
+{
+    return cards[card].moves[state->side][square] & ~state->pieces[state->side];
+}
+
+/*
+Moves a board cursor to the next target square in the direction of an arrow key. LEFT and RIGHT
+step through the targets in reading order, wrapping around, so every target can be reached;
+UP and DOWN jump to the closest target in the nearest row that has one, wrapping at the edge
+
+Precondition:
+    - targets must include square
+
+@param targets Squares the cursor may stop on
+@param square Current cursor square
+@param key KEY_UP, KEY_DOWN, KEY_LEFT or KEY_RIGHT
+@return Returns the new cursor square, square itself if there is no target that way
+*/
+int nextTarget(boardMask targets, int square, int key)
+{
+    int best = square;
+    int bestCost = NUM_SQUARES * NUM_SQUARES;
+    int step = (key == KEY_LEFT || key == KEY_UP) ? -1 : 1;
+    int i, sq, rows, cost;
+
+    if (key == KEY_LEFT || key == KEY_RIGHT)
+    {
+        for (i = 1; i < NUM_SQUARES && best == square; i++)
+        {
+            sq = (square + step * i + NUM_SQUARES) % NUM_SQUARES;
+            if (targets & SQUARE_BIT(sq))
+                best = sq;
+        }
+    }
+    else
+    {
+        for (sq = 0; sq < NUM_SQUARES; sq++)
+        {
+            rows = (step * (sq / COLS - square / COLS) + ROWS) % ROWS;
+            cost = rows * COLS + abs(sq % COLS - square % COLS);
+            if ((targets & SQUARE_BIT(sq)) && rows > 0 && cost < bestCost)
+            {
+                best = sq;
+                bestCost = cost;
+            }
+        }
+    }
+    return best;
+}
+
+/*
+Checks if the current player has any valid moves available with either of their cards.
+Uses the precomputed card masks instead of trying every square pair on the board
+
+Precondition:
+    - state must be a valid position, usually built with stateFromBoard
+    - cards must be the loaded card table
+
+@param state The position to check, side to move is the current player
+@param cards The card table
+@return 1 if at least one valid move exists for the current player, 0 otherwise
+ */
+int hasAnyValidMove(const gameState *state, cardInfo cards[])
+{
+    int side = state->side;
+    boardMask own = state->pieces[side];
+    boardMask reach = 0;
+    boardMask from;
+    int slot, fromSq;
+
+    for (from = own; from; from &= from - 1)
+    {
+        fromSq = LOWEST_SQUARE(from);
+        for (slot = 0; slot < MAX_CARDS_PER_PLAYER; slot++)
+            reach |= cards[state->hand[side][slot]].moves[side][fromSq];
+    }
+    return (reach & ~own) != 0;
+}
+
+/*
+Determines which player gets the first turn based on the color of the right game card
+
+Precondition: 
+    - crdsIG must be properly initialized with valid card displays
+    - crdsIG.rCardDisp[0] must contain either "red" or another valid color string
+    - The right card's display data must be loaded from its corresponding text file
+
+@param crdsIG The game cards data structure containing card display information
+@return Returns 1 if the first player (RED) should start, 0 if the second player (BLUE) should start otherwise -1
+*/
+int getFirstTurn(dataCrdsIG crdsIG) 
+{
+    int result = -1;
+
+    if (strcmp(crdsIG.rCardDisp[0], "red") == 0)
+        result = 1;
+    else if(strcmp(crdsIG.rCardDisp[0], "blue") == 0)
+        result = 0;
+
+    return result;  
+}
+
+/*
+Sets up an empty rating table
+
+Precondition: None
+
+@param table The table to set up
+@return Returns no data type (void)
+*/
+void ratingTableInit(ratingTable *table)
+{
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->slots = NULL;
+    table->slotMask = 0;
+}
+
+/*
+Releases the memory of a rating table
+
+Precondition:
+    - table must have been set up with ratingTableInit
+
+@param table The table to release
+@return Returns no data type (void)
+*/
+void ratingTableFree(ratingTable *table)
+{
+    free(table->entries);
+    free(table->slots);
+    ratingTableInit(table);
+}
+
+/*
+Hashes a player name for the rating table's index (FNV-1a)
+
+Precondition:
+    - name must be a terminated string
+
+@param name The player name
+@return Returns the hash
+*/
+unsigned int nameHash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    int i;
+
+    for (i = 0; name[i] != '\0'; i++)
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    return hash;
+}
+
+/*
+Finds a player in the rating table, adding a new player at RATING_START when the name is not
+there yet. The index is rebuilt twice as large whenever the table fills half of it
+
+Precondition:
+    - table must have been set up with ratingTableInit
+    - name must be shorter than MAX_NAME_LEN
+
+@param table The table
+@param name The player name
+@return Returns the player's entry, or -1 if the table could not grow
+*/
+int ratingPlayer(ratingTable *table, const char *name)
+{
+    ratingEntry *grown;
+    int *slots;
+    unsigned int slot, mask;
+    int i;
+    int found = -1;
+
+    if (table->count >= table->capacity)
+    {
+        i = table->capacity > 0 ? table->capacity * 2 : 64;
+        grown = realloc(table->entries, i * sizeof(ratingEntry));
+        slots = malloc(2 * i * sizeof(int));
+        if (grown != NULL)
+            table->entries = grown;
+
+        if (grown != NULL && slots != NULL)
+        {
+            free(table->slots);
+            table->slots = slots;
+            table->capacity = i;
+            table->slotMask = 2 * i - 1;
+            memset(slots, -1, 2 * i * sizeof(int));
+            for (i = 0; i < table->count; i++)
+            {
+                for (slot = nameHash(table->entries[i].name) & table->slotMask; slots[slot] >= 0;
+                     slot = (slot + 1) & table->slotMask)
+                    ;
+                slots[slot] = i;
+            }
+        }
+        else
+            free(slots);
+    }
+
+    if (table->count < table->capacity)
+    {
+        mask = table->slotMask;
+        for (slot = nameHash(name) & mask; table->slots[slot] >= 0 && found < 0; slot = (slot + 1) & mask)
+        {
+            if (strcmp(table->entries[table->slots[slot]].name, name) == 0)
+                found = table->slots[slot];
+        }
+
+        if (found < 0)
+        {
+            found = table->count++;
+            table->slots[slot] = found;
+            memset(&table->entries[found], 0, sizeof(ratingEntry));
+            strcpy(table->entries[found].name, name);
+            table->entries[found].rating = RATING_START;
+        }
+    }
+    return found;
+}
+
+/*
+Returns the score a player is expected to make against an opponent under the Elo model
+
+Precondition: None
+
+@param rating The player's rating
+@param opponent The opponent's rating
+@return Returns the expected score between 0 and 1
+*/
+double expectedScore(double rating, double opponent)
+{
+    return 1.0 / (1.0 + pow(10.0, (opponent - rating) / 400.0));
+}
+
+/*
+Adds a game to both players' counts of games, wins, draws and losses
+
+Precondition:
+    - first and second must be different players
+
+@param first Player 1's entry
+@param second Player 2's entry
+@param score Player 1's result in half points: 2 win, 1 draw, 0 loss
+@return Returns no data type (void)
+*/
+void countResult(ratingEntry *first, ratingEntry *second, int score)
+{
+    first->games++;
+    second->games++;
+    if (score == 2)
+    {
+        first->wins++;
+        second->losses++;
+    }
+    else if (score == 0)
+    {
+        first->losses++;
+        second->wins++;
+    }
+    else
+    {
+        first->draws++;
+        second->draws++;
+    }
+}
+
+/*
+Rates one game: both players move by RATING_K times the difference between the result and the
+expected score, in O(1). The counts of games, wins, draws and losses are updated too
+
+Precondition:
+    - first and second must be different players
+
+@param first Player 1's entry
+@param second Player 2's entry
+@param score Player 1's result in half points: 2 win, 1 draw, 0 loss
+@return Returns no data type (void)
+*/
+void rateGame(ratingEntry *first, ratingEntry *second, int score)
+{
+    double change = RATING_K * (score / 2.0 - expectedScore(first->rating, second->rating));
+
+    first->rating += change;
+    second->rating -= change;
+    countResult(first, second, score);
+}
+
+/*
+Reads a ratings file written by saveRatings into an empty table. Files from before the
+fixed-width layout, one player per line and no header, are read too
+
+Precondition:
+    - table must be set up and empty
+
+@param table Receives the players
+@param filename The ratings file
+@return Returns 1 if the file was read, 0 if there is none yet
+*/
+int loadRatings(ratingTable *table, const char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    char line[RATING_LINE + 1];
+    ratingEntry entry;
+    int i;
+
+    if (fp != NULL)
+    {
+        // the header starts with '#', a player line never does; empty slots are blank lines
+        if (fgets(line, sizeof(line), fp) == NULL || line[0] != '#')
+            rewind(fp);
+        while (fscanf(fp, "%30s %lf %d %d %d %d", entry.name, &entry.rating, &entry.games, &entry.wins,
+                      &entry.draws, &entry.losses) == 6)
+        {
+            i = ratingPlayer(table, entry.name);
+            if (i >= 0)
+                table->entries[i] = entry;
+        }
+        fclose(fp);
+    }
+    return fp != NULL;
+}
+
+/*
+Orders rating entries from the highest rating down (qsort callback)
+
+Precondition:
+    - a and b must point to ratingEntry values
+
+@param a First entry
+@param b Second entry
+@return Returns a negative, zero or positive value like strcmp
+*/
+int compareRatings(const void *a, const void *b)
+{
+    const ratingEntry *x = (const ratingEntry *) a;
+    const ratingEntry *y = (const ratingEntry *) b;
+    int result = 0;
+
+    if (x->rating != y->rating)
+        result = x->rating > y->rating ? -1 : 1;
+    else
+        result = strcmp(x->name, y->name);
+
+    return result;
+}
+
+/*
+Formats one record of the ratings file: a player's line "name rating games wins draws losses",
+the header, or a blank line for an empty slot, padded with spaces to RATING_LINE bytes
+
+Precondition: None
+
+@param line Receives RATING_LINE bytes, not terminated
+@param entry The player to write, or NULL
+@param header The header text to write when entry is NULL, or NULL for an empty slot
+@return Returns no data type (void)
+*/
+void formatRating(char line[], const ratingEntry *entry, const char *header)
+{
+    char text[RATING_LINE];
+    int length = 0;
+
+    if (entry != NULL)
+        length = snprintf(text, sizeof(text), "%s %.4f %d %d %d %d", entry->name, entry->rating, entry->games,
+                          entry->wins, entry->draws, entry->losses);
+    else if (header != NULL)
+        length = snprintf(text, sizeof(text), "%s", header);
+
+    if (length < 0)
+        length = 0;
+    if (length > RATING_LINE - 1)
+        length = RATING_LINE - 1;
+
+    memset(line, ' ', RATING_LINE);
+    memcpy(line, text, length);
+    line[RATING_LINE - 1] = '\n';
+}
+
+/*
+Writes the table as a ratings file: a "# ratings <slots> <players>" header, then one
+RATING_LINE-byte record per slot. Every player sits in the slot its name hashes to, or the
+next free one after it, and at most half the slots are used, so recordResult can find and
+rewrite two players in place
+
+Precondition:
+    - table must have been set up with ratingTableInit
+
+@param table The rating table
+@param filename File to write
+@return Returns 1 on success, 0 if the file could not be written
+*/
+int saveRatings(const ratingTable *table, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    char line[RATING_LINE];
+    char header[RATING_LINE];
+    int *slotEntry;
+    unsigned int slot;
+    int slots = RATING_SLOTS;
+    int i;
+    int ok;
+
+    while (slots < 2 * table->count)
+        slots *= 2;
+    slotEntry = malloc(slots * sizeof(int));
+    ok = fp != NULL && slotEntry != NULL;
+
+    if (ok)
+    {
+        memset(slotEntry, -1, slots * sizeof(int));
+        for (i = 0; i < table->count; i++)
+        {
+            for (slot = nameHash(table->entries[i].name) & (slots - 1); slotEntry[slot] >= 0;
+                 slot = (slot + 1) & (slots - 1))
+                ;
+            slotEntry[slot] = i;
+        }
+
+        sprintf(header, "# ratings %d %d", slots, table->count);
+        formatRating(line, NULL, header);
+        ok = fwrite(line, 1, RATING_LINE, fp) == RATING_LINE;
+        for (i = 0; i < slots && ok; i++)
+        {
+            formatRating(line, slotEntry[i] >= 0 ? &table->entries[slotEntry[i]] : NULL, NULL);
+            ok = fwrite(line, 1, RATING_LINE, fp) == RATING_LINE;
+        }
+    }
+
+    if (fp != NULL && fclose(fp) != 0)
+        ok = 0;
+    free(slotEntry);
+    return ok;
+}
+
+/*
+Finds a player's record in an open ratings file, probing the slots from the name's hash
+
+Precondition:
+    - fp must be a ratings file written by saveRatings, opened in binary mode
+    - slots must be its slot count
+
+@param fp The ratings file
+@param slots Number of record slots, a power of two
+@param name The player name
+@param entry Receives the player's record, or an empty name when the player is not there
+@return Returns the player's slot or the empty slot where they belong, -1 on a read error
+*/
+int findRatingRecord(FILE *fp, int slots, const char *name, ratingEntry *entry)
+{
+    char line[RATING_LINE + 1];
+    unsigned int slot = nameHash(name) & (slots - 1);
+    int probes = 0;
+    int result = -2;
+
+    while (result == -2)
+    {
+        if (probes == slots || fseek(fp, (long) (slot + 1) * RATING_LINE, SEEK_SET) != 0 ||
+            fread(line, 1, RATING_LINE, fp) != RATING_LINE)
+            result = -1;
+        else
+        {
+            line[RATING_LINE] = '\0';
+            if (sscanf(line, "%30s %lf %d %d %d %d", entry->name, &entry->rating, &entry->games, &entry->wins,
+                       &entry->draws, &entry->losses) != 6)
+            {
+                entry->name[0] = '\0';
+                result = (int) slot;
+            }
+            else if (strcmp(entry->name, name) == 0)
+                result = (int) slot;
+
+            slot = (slot + 1) & (slots - 1);
+            probes++;
+        }
+    }
+    return result;
+}
+
+/*
+Rates one game directly in the ratings file, in O(1): reads the two players' records, and
+writes back those two records and, for a new player, the header. Nothing is written when the
+file is missing, has the older layout, or would become more than half full
+
+Precondition:
+    - name1 and name2 must be different names without spaces
+
+@param filename The ratings file
+@param name1 Player 1's name
+@param name2 Player 2's name
+@param score Player 1's result in half points: 2 win, 1 draw, 0 loss
+@return Returns 1 if the game was rated, 0 if the file must be rewritten by saveRatings
+*/
+int rateInFile(const char *filename, const char *name1, const char *name2, int score)
+{
+    FILE *fp = fopen(filename, "r+b");
+    char line[RATING_LINE + 1];
+    char header[RATING_LINE];
+    ratingEntry first, second;
+    int slots = 0;
+    int players = 0;
+    int a = -1;
+    int b = -1;
+    int added = 0;
+    int ok = fp != NULL && fread(line, 1, RATING_LINE, fp) == RATING_LINE;
+
+    if (ok)
+    {
+        line[RATING_LINE] = '\0';
+        ok = sscanf(line, "# ratings %d %d", &slots, &players) == 2 && slots >= RATING_SLOTS &&
+             (slots & (slots - 1)) == 0 && fseek(fp, 0, SEEK_END) == 0 &&
+             ftell(fp) == (long) (slots + 1) * RATING_LINE;
+    }
+
+    if (ok)
+    {
+        a = findRatingRecord(fp, slots, name1, &first);
+        b = findRatingRecord(fp, slots, name2, &second);
+        added = (first.name[0] == '\0') + (second.name[0] == '\0');
+
+        // two new players can hash to the same free slot, the full rewrite separates them
+        ok = a >= 0 && b >= 0 && a != b && 2 * (players + added) <= slots;
+    }
+
+    if (ok)
+    {
+        if (first.name[0] == '\0')
+        {
+            memset(&first, 0, sizeof(ratingEntry));
+            strcpy(first.name, name1);
+            first.rating = RATING_START;
+        }
+        if (second.name[0] == '\0')
+        {
+            memset(&second, 0, sizeof(ratingEntry));
+            strcpy(second.name, name2);
+            second.rating = RATING_START;
+        }
+        rateGame(&first, &second, score);
+
+        formatRating(line, &first, NULL);
+        ok = fseek(fp, (long) (a + 1) * RATING_LINE, SEEK_SET) == 0 && fwrite(line, 1, RATING_LINE, fp) == RATING_LINE;
+        formatRating(line, &second, NULL);
+        ok = ok && fseek(fp, (long) (b + 1) * RATING_LINE, SEEK_SET) == 0 &&
+             fwrite(line, 1, RATING_LINE, fp) == RATING_LINE;
+        if (added > 0)
+        {
+            sprintf(header, "# ratings %d %d", slots, players + added);
+            formatRating(line, NULL, header);
+            ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(line, 1, RATING_LINE, fp) == RATING_LINE;
+        }
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+    return ok;
+}
+
+/*
+Records a finished game: appends it to Results.txt, the history "-ratings" recomputes from,
+and rates it in Ratings.txt, where only the two players' records are rewritten. The whole
+file is read and written again only to create it, to convert an older file, or to double its
+slots once half are used, so a game costs O(1) amortized. A game a player has against
+themself is recorded but not rated
+
+Precondition:
+    - name1 and name2 must be names without spaces
+
+@param name1 Player 1's name
+@param name2 Player 2's name
+@param winner 1 or 2 for the winning player, 0 for a draw
+@return Returns no data type (void)
+*/
+void recordResult(const char *name1, const char *name2, int winner)
+{
+    FILE *fp = fopen("Results.txt", "a");
+    ratingTable table;
+    int score = winner == 1 ? 2 : (winner == 2 ? 0 : 1);
+    int a, b;
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "%s %s %d\n", name1, name2, winner);
+        fclose(fp);
+    }
+
+    if (strcmp(name1, name2) != 0 && !rateInFile("Ratings.txt", name1, name2, score))
+    {
+        ratingTableInit(&table);
+        loadRatings(&table, "Ratings.txt");
+        a = ratingPlayer(&table, name1);
+        b = ratingPlayer(&table, name2);
+        if (a >= 0 && b >= 0)
+        {
+            rateGame(&table.entries[a], &table.entries[b], score);
+            saveRatings(&table, "Ratings.txt");
+        }
+        ratingTableFree(&table);
+    }
+}
+
+/*
+Updates the HallOfFame with a winner's information
+
+Precondition:
+    - winner must contain valid name and turns
+    - HallOfFame.txt exists
+
+@param winner The winning player's data
+@return Returns no data type (void)
+*/
+void updateHoF(player winner) 
+{
+    lead leaders[MAX_LEAD_LINES/2 + 1] = {0};  
+    lead temp;
+    int count = 0;
+    int i = 0;
+    int j = 0;
+    int min_idx = 0;
+    FILE *fp;
+    
+    fp = fopen("HallOfFame.txt", "r");
+
+    if (fp != NULL) 
+    {
+    while (count < MAX_LEAD_LINES / 2 &&
+           fscanf(fp, "%s", leaders[count].name) == 1 &&
+           fscanf(fp, "%d", &leaders[count].turns) == 1)
+        {
+            count++;
+        }
+        fclose(fp);
+    }
+
+    /* 2. Add new winner */
+    if (count < MAX_LEAD_LINES/2 + 1) 
+    {
+        strcpy(leaders[count].name, winner.name);
+        leaders[count].turns = winner.turns;
+        count++;
+    }
+
+    // Sort by turns 
+    for (i = 0; i < count - 1; i++) 
+    {
+        min_idx = i;
+        for (j = i + 1; j < count; j++) 
+        {
+            if (leaders[j].turns < leaders[min_idx].turns) 
+                min_idx = j;
+        }
+        
+        if (min_idx != i)
+        { 
+            /* Swap elements */
+            strcpy(temp.name, leaders[i].name);
+            temp.turns = leaders[i].turns;
+
+            strcpy(leaders[i].name, leaders[min_idx].name);
+            leaders[i].turns = leaders[min_idx].turns;
+            
+            strcpy(leaders[min_idx].name, temp.name);
+            leaders[min_idx].turns = temp.turns;
+        }
+    }
+
+    if (count > MAX_LEAD_LINES/2) //Keep only top MAX_LEAD_LINES/2 entries 
+        count = MAX_LEAD_LINES/2;
+
+   
+    // Write back to file 
+    fp = fopen("HallOfFame.txt", "w");
+
+    for (i = 0; i < count; i++) 
+        fprintf(fp, "%s\n%d\n", leaders[i].name, leaders[i].turns);
+        
+    fclose(fp);
+
+}
+
+/*
+Displays the hall of fame: the fastest wins, then the RATING_LEADERS best rated players
+
+Precondition:
+    - HallOfFame.txt must exist in working directory
+@param term The terminal
+@return Returns no data type (void)
+*/
+void displayHoF(terminal *term)
+{
+    str100 hallofFame[MAX_LEAD_LINES] = {0};
+    ratingTable ratings;
+    int i;
+
+    readHoF(hallofFame);
+    ratingTableInit(&ratings);
+    loadRatings(&ratings, "Ratings.txt");
+
+    clearScreen(term);
+    printf("\n");
+    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "\x1b[1m" "           --HALL OF FAME--           " "\x1b[0m" "\x1b[36m" "|" "\x1b[0m" "\n");
+
+    if(hallofFame[0][0] == '\0')
+        printf("\x1b[33m" "No Hall of Fame entries yet. Be the first to make history!\n" "\x1b[0m");
+
+    else
+    {
+        for(i = 0; i < MAX_LEAD_LINES; i+=2)
+        {
+            if(hallofFame[i][0] == '\0')
+                i = MAX_LEAD_LINES;
+
+            else
+            {
+                printf("\x1b[36m" "Top %d:\n" "\x1b[0m", (i / 2) + 1);
+                printf("\x1b[35m" "Name:" "\x1b[0m" "%s\n", hallofFame[i]);
+                printf("\x1b[35m" "Turns It Took To Win: " "\x1b[0m" "%s", hallofFame[i+1]);
+            }
+            printf("\n");
+        }
+    }
+
+    // Ratings.txt is kept in hash order, sorted here for display only
+    if (ratings.count > 0)
+        qsort(ratings.entries, ratings.count, sizeof(ratingEntry), compareRatings);
+    printf("\n\t\t" "\x1b[36m" "|" "\x1b[0m" "\x1b[1m" "             --RATINGS--              " "\x1b[0m" "\x1b[36m" "|" "\x1b[0m" "\n");
+    if (ratings.count == 0)
+        printf("\x1b[33m" "No rated games yet.\n" "\x1b[0m");
+    for (i = 0; i < ratings.count && i < RATING_LEADERS; i++)
+        printf("\x1b[36m" "%2d. " "\x1b[0m" "%-20s %5.0f   " "\x1b[35m" "W/D/L " "\x1b[0m" "%d/%d/%d\n", i + 1,
+               ratings.entries[i].name, ratings.entries[i].rating, ratings.entries[i].wins, ratings.entries[i].draws,
+               ratings.entries[i].losses);
+    ratingTableFree(&ratings);
+
+    printf("\n\n\n\t\t" "\x1b[36m" "|" "\x1b[0m" "   Press " "\x1b[32m" "ENTER" "\x1b[0m" " to return to Main Menu   " "\x1b[36m" "|" "\x1b[0m" "\n");
+    waitEnter(term);
+}
+
+/*
+Displays game instructions and controls
+
+Precondition: None
+@param term The terminal
+@return Returns no data type (void)
+*/
+void howToPlay(terminal *term)
+{
+    clearScreen(term);
+    printf("\n");
+    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "\x1b[1m" "           HOW TO PLAY ONITAMA!           " "\x1b[0m" "\x1b[36m" "|" "\x1b[0m" "\n");
+
+    printf("\x1b[33m" " Overview:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" Onitama is a two-player turn-based strategy game played on a %dx%d board.\n", ROWS, COLS);
+    printf(" Each player has %d pieces: one " "\x1b[1m" "SENSEI" "\x1b[0m" " (Master) and %d " "\x1b[1m" "STUDENTS" "\x1b[0m" ".\n\n",
+           NUM_OF_STUD, NUM_OF_STUD - 1);
+
+    printf("\x1b[33m" " Objective:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" To win, you must accomplish one of these:\n");
+    printf(" " "\x1b[32m" "1." "\x1b[0m" " Capture your opponent's " "\x1b[1m" "SENSEI" "\x1b[0m" "\n");
+    printf(" " "\x1b[32m" "2." "\x1b[0m" " Move your " "\x1b[1m" "SENSEI" "\x1b[0m" " to your opponent's starting temple (center of their back row)\n\n");
+
+    printf("\x1b[33m" " Game Setup:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" - Players start with their pieces arranged on opposite sides\n");
+    printf(" - Each player begins with 2 unique movement cards\n");
+    printf(" - There's 1 neutral card that isn't assigned to either player\n\n");
+
+    printf("\x1b[33m" " Movement Rules:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" - On your turn, you must perform " "\x1b[1m" "ONE" "\x1b[0m" " action:\n");
+    printf("   " "\x1b[32m" "1." "\x1b[0m" " Move a piece according to one of your movement cards\n");
+    printf("   " "\x1b[32m" "2." "\x1b[0m" " Exchange one of your cards with the neutral card\n");
+    printf(" - After moving, the used card becomes the neutral card\n");
+    printf(" - Movement patterns are shown on the cards (arrows indicate possible moves)\n\n");
+
+    printf("\x1b[33m" " Special Rules:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" - " "\x1b[1m" "SENSEI" "\x1b[0m" " can be captured like any other piece\n");
+    printf(" - " "\x1b[1m" "STUDENTS" "\x1b[0m" " can capture opponent's pieces by landing on them\n");
+    printf(" - If a " "\x1b[1m" "STUDENT" "\x1b[0m" " reaches the opponent's temple row, it remains there\n\n");
+
+    printf("\x1b[33m" " Undo and Redo:" "\x1b[0m" "\n");
+    printf(" ------------------------------------------\n");
+    printf(" - While choosing a card, press " "\x1b[32m" "U" "\x1b[0m" " to take back the last move\n");
+    printf(" - Press " "\x1b[32m" "R" "\x1b[0m" " to play an undone move again, until a new move is made\n\n");
+
+    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "   Press " "\x1b[32m" "ENTER" "\x1b[0m" " to return to Main Menu   " "\x1b[36m" "|" "\x1b[0m" "\n");
+
+    waitEnter(term);
+}
+
+/*
+Initializes player piece names with proper colors
+
+Precondition:
+    - Player structures must be allocated
+    - Color macros must be properly defined
+
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@return Returns no data type (void)
+*/
+void populatePlayerPiece(player *p1, player *p2)
+{
+    int i;
+
+    for(i = 0; i < NUM_OF_STUD; i++)
+    {
+        if(i==NUM_OF_STUD/2)
+        strcpy(p1->pPiece.sensei, "\x1b[34m" "| M |" "\x1b[0m");
+        else
+        strcpy(p1->pPiece.student[i], "\x1b[34m" "| s |" "\x1b[0m");
+    }
+
+
+    for(i = 0; i < NUM_OF_STUD; i++)
+    {
+        if(i==NUM_OF_STUD/2)
+        strcpy(p2->pPiece.sensei, "\x1b[31m" "| M |" "\x1b[0m");
+        else
+        strcpy(p2->pPiece.student[i], "\x1b[31m" "| s |" "\x1b[0m");
+    }
+}
+
+/*
+Initializes the game board with starting piece positions
+
+Precondition:
+    - Board must be properly allocated
+    - Player structures must have initialized piece names
+
+@param board The game board to populate
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@return Returns no data type (void)
+*/
+void populateBoard(oniBrd board, player *p1, player *p2) 
+{
+    int i, j;
+
+    for(i = 0; i < ROWS; i++)
+    {
+        for(j = 0; j < COLS; j++)
+        {   
+            strcpy(board[i][j], "| _ |");
+        }
+    }
+
+    for(j = 0; j < COLS; j++)
+    {
+        if(j == COLS/2)
+            strcpy(board[ROWS-1][j], p1->pPiece.sensei);
+        else if(j < NUM_OF_STUD)
+            strcpy(board[ROWS-1][j], p1->pPiece.student[j]);
+    }
+
+    for(j = 0; j < COLS; j++)
+    {
+        if(j == COLS/2)
+            strcpy(board[0][j], p2->pPiece.sensei);
+        else if(j < NUM_OF_STUD)  
+            strcpy(board[0][j], p2->pPiece.student[j]);
+    }
+
+}
+
+/*
+Displays the current board state during replay
+
+Precondition:
+    - Board must be properly initialized
+
+@param board The game board to display
+@param panel Lines shown to the right of the board rows, NULL for none
+@param term The terminal the screen is drawn on
+@return Returns no data type (void)
+*/
+void displayReplayBoard(oniBrd board, const analysisPanel *panel, terminal *term)
+{
+    int i, j;
+
+    clearScreen(term);
+    printf("\n\t\t\t\t\t\t" "\x1b[36m" " O N I T A M A   R E P L A Y " "\x1b[0m" "\n\n");
+
+    printf("\t\t\t\t ");
+    for (i = 0; i < COLS; i++)
+    {
+        printf("+-------");
+    }
+    printf("+\n");
+
+    for (i = 0; i < ROWS; i++)
+    {
+        printf("\t\t\t\t ");
+        for (j = 0; j < COLS; j++)
+        {
+            printf("| %s ", board[i][j]);
+        }
+        printf("|");
+        if (panel != NULL && i < panel->lineCount)
+            printf("\t%s", panel->text[i]);
+        printf("\n\t\t\t\t ");
+
+        for (j = 0; j < COLS; j++)
+        {
+            printf("+-------");
+        }
+        printf("+\n");
+    }
+    printf("\n");
+}
+/*
+Plays back all recorded moves in sequence to recreate the game
+
+Precondition:
+    - replayMoves must contain moveCount valid moves
+    - moveCount must be <= MAX_MOVES
+    - Board display functions must be initialized
+
+@param replayMoves Array containing all recorded moves
+@param moveCount Number of moves in replayMoves array
+@param start The position the game started from, followed move by move for the analysis panel
+@param cards The card table
+@param cardCount Number of cards in the table
+@param term The terminal
+@return Returns no data type (void)
+*/
+void replayMovesSequence(MoveRecord* replayMoves, int moveCount, const gameState *start, cardInfo cards[],
+                         int cardCount, terminal *term)
+{
+    oniBrd board;
+    analysisPanel panel;
+    gameState state = *start;
+    zobristKeys keys;
+    undoRecord undo;
+    unsigned long long hash;
+    int analyze;
+    int i;
+
+    resetBoard(board);
+    // Set up initial board state
+    for (i = 0; i < COLS; i++)
+    {
+        if (i == COLS/2)
+        {
+            strcpy(board[0][i], "\x1b[31m" "| M |" "\x1b[0m");      // Player 2 (RED) pieces at top
+            strcpy(board[ROWS-1][i], "\x1b[34m" "| M |" "\x1b[0m"); // Player 1 (BLUE) pieces at bottom
+        }
+        else
+        {
+            strcpy(board[0][i], "\x1b[31m" "| s |" "\x1b[0m");
+            strcpy(board[ROWS-1][i], "\x1b[34m" "| s |" "\x1b[0m");
+        }
+    }
+
+    initZobrist(&keys);
+    hash = hashState(&state, &keys);
+    panel.lineCount = 0;
+
+    displayReplayBoard(board, NULL, term);
+    printf("Press A to replay with the engine's best moves beside every position, any other key to start replay...");
+    analyze = readKey(term);
+    analyze = analyze == 'a' || analyze == 'A';
+
+    for (i = 0; i < moveCount; i++)
+    {
+        if (analyze)
+            fillAnalysisPanel(&state, cards, &panel);
+        displayReplayBoard(board, &panel, term);
+        printf("Move %d/%d: Player %d used %s\n", i + 1, moveCount,
+               replayMoves[i].player, replayMoves[i].cardName);
+        if (replayMoves[i].from.x == replayMoves[i].to.x && replayMoves[i].from.y == replayMoves[i].to.y)
+            printf("No valid moves, card swapped without moving\n");
+        else
+            printf("From: (%d, %d) To: (%d, %d)\n",
+                   replayMoves[i].from.x, replayMoves[i].from.y,
+                   replayMoves[i].to.x, replayMoves[i].to.y);
+
+        applyMove(board, replayMoves[i]);
+        makeMove(&state, coreMoveFromRecord(&replayMoves[i], cards, cardCount), cards, &keys, &hash, NULL, &undo);
+        pauseScreen(term, 1000);
+    }
+    displayReplayBoard(board, NULL, term);
+}
+/*
+Displays the current game board with all pieces and cards
+
+Precondition:
+    - Board must be properly populated
+    - Player structures must be initialized
+    - crdsIG must contain current card displays
+    - selRow and selCol must be valid coordinates or -1
+    - nFlagPiece must be 0 or 1
+
+@param board The game board
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@param crdsIG Pointer to game cards display data
+@param selRow Currently selected row (-1 for none)
+@param selCol Currently selected column (-1 for none)
+@param nFlagPiece Selection highlight flag
+@param threatened Squares whose piece is marked as under attack, 0 for none
+@param targets Squares the cursor may stop on, marked in green, 0 for none
+@param clock The game clocks shown beside the player names, NULL or disabled for none
+@param panel Analysis lines shown to the right of the card column, NULL for none
+@param term The terminal the frame is drawn on
+@return Returns no data type (void)
+*/
+void displayBoard(oniBrd board, player *p1, player *p2, dataCrdsIG *crdsIG, int selRow, int selCol, int nFlagPiece,
+                  boardMask threatened, boardMask targets, const gameClock *clock, const analysisPanel *panel,
+                  terminal *term)
+{
+    int i, j;
+    char clockText[2][24];
+    int timed = clock != NULL && clock->enabled;
+
+    if (timed)
+    {
+        formatClock(clockRemaining(clock, 0), clockText[0]);
+        formatClock(clockRemaining(clock, 1), clockText[1]);
+    }
+
+    clearScreen(term);
+    printf("\n\t\t\t\t\t\t" "\x1b[36m" " O N I T A M A " "\x1b[0m" "\t\t\t\t\t\t\n");
+
+
+    printf(" " "\x1b[31m" "[Player 2] " "\x1b[0m" "%s's Cards:", p2->name);
+    if (timed && clock->running == 1)
+        printf("\t\t\t\t" "\x1b[33m" "Clock %s" "\x1b[0m", clockText[1]); // Yellow while the clock runs
+    else if (timed)
+        printf("\t\t\t\tClock %s", clockText[1]);
+    printf("\n");
+
+    for (i = TEXT_FILE_ROWS - 1; i >= 0; i--)
+    {
+        printf(" \t\t\t\t\t" "\x1b[31m" "| " "\x1b[0m" "%6s" "\x1b[31m" " |\t\t| " "\x1b[0m", p2->card.visualCard[0][i]);
+        printf("%6s" "\x1b[31m" " |\n" "\x1b[0m", p2->card.visualCard[1][i]);
+    }
+
+    printf(" \t\t\t\t\t  " "\x1b[31m" "%6s" "\x1b[0m" "\t\t  " "\x1b[31m" "%6s\n" "\x1b[0m", p2->card.playercard[0], p2->card.playercard[1]);
+
+    printf("\n\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m");
+    printf("\n\t\t" "\x1b[33m" "| Card: %6s |" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "| Card: %6s |\n" "\x1b[0m",
+           crdsIG->lCardName, crdsIG->rCardName);
+    printf("\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m");
+    printf("\n\n\t\t\t\t ");
+
+    for (i = 0; i < COLS+1; i++)
+    {
+        printf("+-------");
+    }
+    printf("+\n");
+
+    for (i = 0; i < ROWS; i++)
+    {
+        printf("\t\t%s\t\t", crdsIG->lCardDisp[i]);
+        for (j = 0; j < COLS; j++)
+        {
+            printf("| ");
+            if (i == selRow && j == selCol && nFlagPiece == 1) //if nFlagPiece is 1 prints the arrow for user to
+                                                               //see where the current position is he currently selecting
+            {
+                // Changed to Magenta for the arrows
+                printf("\x1b[35m" ">" "\x1b[0m"); // Magenta '>' and reset color immediately
+                printf("%s", board[i][j]);         // Print board content (e.g., "| M |" or "| s |" which have their own colors)
+                printf("\x1b[35m" "<" "\x1b[0m"); // Magenta '<' and reset color immediately
+            }
+            else if (targets & SQUARE_BIT(SQUARE_OF(i, j)))
+                printf("\x1b[32m" "*" "\x1b[0m" "%s" "\x1b[32m" "*" "\x1b[0m", board[i][j]); // Green '*' around a square the cursor can reach
+            else if (threatened & SQUARE_BIT(SQUARE_OF(i, j)))
+                printf("\x1b[33m" "!" "\x1b[0m" "%s" "\x1b[33m" "!" "\x1b[0m", board[i][j]); // Yellow '!' around an attacked piece
+            else
+                printf(" %s ", board[i][j]);
+            printf(" ");
+        }
+
+        printf("|\t\t");
+        if (i < TEXT_FILE_ROWS)
+        {
+            printf("%s", crdsIG->rCardDisp[i]);
+        }
+        if (panel != NULL && i < panel->lineCount)
+            printf("\t%s", panel->text[i]);
+
+        printf("\n\t\t\t\t ");
+
+        for (j = 0; j < COLS+1; j++)
+        {
+            printf("+-------");
+        }
+        printf("+\n");
+    }
+
+    printf("\t\t%s", crdsIG->lCardDisp[TEXT_FILE_ROWS-1]);
+    printf("\t\t\t\t\t\t\t\t\t\t%s\n\n", crdsIG->rCardDisp[TEXT_FILE_ROWS-1]);
+
+    // Player 1 (bottom) cards with better labels
+    printf(" " "\x1b[34m" "[Player 1] " "\x1b[0m" "%s's Cards:", p1->name);
+    if (timed && clock->running == 0)
+        printf("\t\t\t\t" "\x1b[33m" "Clock %s" "\x1b[0m", clockText[0]);
+    else if (timed)
+        printf("\t\t\t\tClock %s", clockText[0]);
+    printf("\n");
+    for (i = 0; i < TEXT_FILE_ROWS; i++)
+    {
+        printf(" \t\t\t\t\t" "\x1b[34m" "| " "\x1b[0m" "%6s" "\x1b[34m" " |\t\t| " "\x1b[0m", p1->card.visualCard[0][i]);
+        printf("%6s" "\x1b[34m" " |\n" "\x1b[0m", p1->card.visualCard[1][i]);
+    }
+    printf(" \t\t\t\t\t  " "\x1b[34m" "%6s" "\x1b[0m" "\t\t  " "\x1b[34m" "%6s\n\n" "\x1b[0m", p1->card.playercard[0], p1->card.playercard[1]);
+}
+/*
+Swaps a player's card with a game card according to game rules
+
+Precondition:
+    - currentPlayer must have valid cards
+    - crdsIG must contain valid game cards
+    - selectedCard must be 0 or 1
+    - playerTurn must be 0 or 1
+    - round must be >= 1
+
+@param currentPlayer Pointer to current player's data
+@param crdsIG Pointer to game cards data
+@param selectedCard Which player card to swap (0 or 1)
+@param playerTurn Current player indicator (0 or 1)
+@param round Current round number
+@return Returns no data type (void)
+*/
+void switchCard(player *currentPlayer, dataCrdsIG *crdsIG, int selectedCard, int playerTurn, int round)
+{
+    str30 usedCard;
+    str30 visualUsedCard[TEXT_FILE_ROWS];
+    int i;
+
+    strcpy(usedCard, currentPlayer->card.playercard[selectedCard]);
+
+    if (playerTurn == 0) // Blue's turn
+    {
+        // Blue takes the right card, puts used card to the left
+        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->rCardName);
+        strcpy(crdsIG->lCardName, usedCard);
+        strcpy(crdsIG->rCardName, "None");
+
+        for(i = 0; i < TEXT_FILE_ROWS; i++)
+        {
+            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
+            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->rCardDisp[i]);
+            strcpy(crdsIG->lCardDisp[i], visualUsedCard[i]);
+            blankCardRow(crdsIG->rCardDisp[i]);
+        }
+    }
+    else if (playerTurn == 1 && round == 1) // Red's first move
+    {
+        // Red takes the right card, puts used card back to right
+        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->rCardName);
+        strcpy(crdsIG->rCardName, usedCard);
+
+        for(i = 0; i < TEXT_FILE_ROWS; i++)
+        {
+            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
+            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->rCardDisp[i]);
+            strcpy(crdsIG->rCardDisp[i], visualUsedCard[i]);
+        }
+    }
+    else if (playerTurn == 1) // Red's later turns
+    {
+        // Red takes the left card, puts used card to the right
+        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->lCardName);
+        strcpy(crdsIG->rCardName, usedCard);
+        strcpy(crdsIG->lCardName, "None");
+        for(i = 0; i < TEXT_FILE_ROWS; i++)
+        {
+            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
+            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->lCardDisp[i]);
+            strcpy(crdsIG->rCardDisp[i], visualUsedCard[i]);
+            blankCardRow(crdsIG->lCardDisp[i]);
+        }
+    }
+}
+
+/*
+Manages a single player's turn including piece selection and movement
+
+Precondition:
+    - All player structures must be initialized
+    - Board must be properly populated
+    - crdsIG must contain current game cards
+    - playerTurn must be 0 or 1
+    - round must be >= 1
+
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@param board The game board
+@param crdsIG Pointer to game cards data
+@param playerTurn Pointer to current player indicator
+@param round Pointer to current round number
+@param replayMoves Array to store moves
+@param moveCount Pointer to current move count
+@param cards The card table
+@param cardCount Number of cards in the table
+@param clock The game clocks shown on the board
+@param term The terminal
+@return Returns TURN_PLAYED once a move was played, TURN_UNDO or TURN_REDO when the player pressed
+        U or R while choosing a card, in which case nothing was changed
+*/
+int gameTurn(player *p1, player *p2, oniBrd board, dataCrdsIG *crdsIG, int *playerTurn, int *round,
+              MoveRecord* replayMoves, int* moveCount, cardInfo cards[], int cardCount, const gameClock *clock,
+              terminal *term)
+{
+    int nArrkey;
+    int nFlagPiece = 0;
+    int fromRow = 0, fromCol = 0;
+    int toRow = 0 , toCol = 0;
+    int selectedCard = 0;
+    int noValidMoveFlag = 0;
+    int command = TURN_PLAYED;
+    player *currentPlayer;
+    gameState state;
+    analysisPanel panel;
+    boardMask threatened, shown, movable, destinations;
+    int square;
+
+
+    if (*playerTurn == 0)
+        currentPlayer = p1;
+       else
+         currentPlayer = p2;
+
+    stateFromBoard(board, p1, p2, crdsIG, *playerTurn, *round, cards, cardCount, &state);
+    panel.lineCount = 0;
+    threatened = (state.pieces[0] & ATTACKED_BY(&state, 1)) | (state.pieces[1] & ATTACKED_BY(&state, 0));
+    shown = term->showThreats ? threatened : 0;
+
+    if (!hasAnyValidMove(&state, cards)) //Check if the player has any valid moves at all
+    {
+        noValidMoveFlag = 1;
+        do //card selection phase to swap
+        {
+            displayBoard(board, p1, p2, crdsIG, 0, 0, 0, shown, 0, clock, &panel, term);
+            printf("\x1b[31m" "\nPlayer %s has no valid moves this turn.\n" "\x1b[0m", currentPlayer->name);
+            printf("You must still place one of your move cards on the side and pick up the one from the center.\n");
+            printf("Choose card to place (LEFT/RIGHT), then press ENTER. U undoes the last move, R redoes it.\n");
+            printf("Press A to show the engine's best moves, T to mark attacked pieces.\n");
+            printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
+
+            nArrkey = readKey(term);
+            if (nArrkey == 0 || nArrkey == 224)
+            {
+                nArrkey = readKey(term);
+                if (nArrkey == KEY_LEFT)
+                    selectedCard = 0;
+                else if (nArrkey == KEY_RIGHT)
+                    selectedCard = 1;
+            }
+            else if (nArrkey == 'u' || nArrkey == 'U')
+                command = TURN_UNDO;
+            else if (nArrkey == 'r' || nArrkey == 'R')
+                command = TURN_REDO;
+            else if (nArrkey == 'a' || nArrkey == 'A')
+                fillAnalysisPanel(&state, cards, &panel);
+            else if (nArrkey == 't' || nArrkey == 'T')
+            {
+                term->showThreats = !term->showThreats;
+                shown = term->showThreats ? threatened : 0;
+            }
+        } while (nArrkey != KEY_ENTER && command == TURN_PLAYED);
+
+        if (command == TURN_PLAYED)
+        {
+            // a swap without moving is recorded with from == to so the replay and GameLog keep the card flow
+            recordMove(replayMoves, moveCount, *playerTurn + 1, makePosition(0, 0), makePosition(0, 0),
+                       currentPlayer->card.playercard[selectedCard]);
+            switchCard(currentPlayer, crdsIG, selectedCard, *playerTurn, *round);
+
+            if (*playerTurn == 0)
+                *playerTurn = 1;
+            else
+                *playerTurn = 0;
+
+            *round = *round + 1;
+            currentPlayer->turns++;
+        }
+    }
+
+    if(!noValidMoveFlag) // card selection phase if has a valid move
+    {
+        selectedCard = 0;
+        do
+        {
+            displayBoard(board, p1, p2, crdsIG, fromRow, fromCol, nFlagPiece, shown, 0, clock, &panel, term);
+            printf("\n%s's turn\n", currentPlayer->name);
+            printf("Choose your move card using LEFT/RIGHT arrow. Press ENTER to confirm.\n");
+            printf("Press U to undo the last move, R to redo an undone move, A to show the engine's best moves,\n");
+            printf("T to mark attacked pieces.\n");
+            printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
+
+            nArrkey = readKey(term);
+            if (nArrkey == 0 || nArrkey == 224)
+            {
+                nArrkey = readKey(term);
+                if (nArrkey == KEY_LEFT)
+                    selectedCard = 0;
+                else if (nArrkey == KEY_RIGHT)
+                    selectedCard = 1;
+
+            }
+            else if (nArrkey == 'u' || nArrkey == 'U')
+                command = TURN_UNDO;
+            else if (nArrkey == 'r' || nArrkey == 'R')
+                command = TURN_REDO;
+            else if (nArrkey == 'a' || nArrkey == 'A')
+                fillAnalysisPanel(&state, cards, &panel);
+            else if (nArrkey == 't' || nArrkey == 'T')
+            {
+                term->showThreats = !term->showThreats;
+                shown = term->showThreats ? threatened : 0;
+            }
+        } while (nArrkey != KEY_ENTER && command == TURN_PLAYED);
+
+        strcpy(currentPlayer->pSelectedCard, currentPlayer->card.playercard[selectedCard]);
+
+        if (command == TURN_PLAYED)
+        {
+            // the legal pieces and destinations are worked out once, the cursor then only visits them
+            movable = legalPieces(&state, cards, state.hand[state.side][selectedCard]);
+
+            if (movable == 0) // the other card must have a move, hasAnyValidMove said so
+            {
+                printf("\x1b[31m" "\nPlayer %s has no valid moves for the selected card.\n" "\x1b[0m", currentPlayer->name);
+                printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
+                printf("Press any key to Continue...\n");
+                readKey(term);
+                selectedCard = !selectedCard;
+                strcpy(currentPlayer->pSelectedCard, currentPlayer->card.playercard[selectedCard]);
+                movable = legalPieces(&state, cards, state.hand[state.side][selectedCard]);
+            }
+
+            square = LOWEST_SQUARE(movable);
+            nFlagPiece = 1;
+            do //position selection piece
+            {
+                fromRow = square / COLS;
+                fromCol = square % COLS;
+                displayBoard(board, p1, p2, crdsIG, fromRow, fromCol, nFlagPiece, shown, movable, clock, &panel, term);
+                printf("\n%s's turn\n", currentPlayer->name);
+                printf("Select your piece (arrow keys jump between the pieces marked *). Press ENTER to confirm.\n");
+                printf("Current Card: %s\n", currentPlayer->pSelectedCard);
+
+                nArrkey = readKey(term);
+                if (nArrkey == 0 || nArrkey == 224)
+                {
+                    nArrkey = readKey(term);
+                    square = nextTarget(movable, square, nArrkey);
+                }
+            } while (nArrkey != KEY_ENTER);
+
+            strcpy(currentPlayer->pPiece.selectedPiece, board[fromRow][fromCol]);
+            destinations = legalDestinations(&state, cards, state.hand[state.side][selectedCard], square);
+            square = LOWEST_SQUARE(destinations);
+
+            do
+            {
+                toRow = square / COLS;
+                toCol = square % COLS;
+                displayBoard(board, p1, p2, crdsIG, toRow, toCol, nFlagPiece, shown, destinations, clock, &panel, term);
+                printf("\n%s's turn\n", currentPlayer->name);
+                printf("Select destination (arrow keys jump between the squares marked *). Press ENTER to confirm.\n");
+                printf("Moving with: %s\n", currentPlayer->pSelectedCard);
+                printf("Selected Piece: %s\n", currentPlayer->pPiece.selectedPiece);
+
+                nArrkey = readKey(term);
+                if (nArrkey == 0 || nArrkey == 224)
+                {
+                    nArrkey = readKey(term);
+                    square = nextTarget(destinations, square, nArrkey);
+                }
+            } while (nArrkey != KEY_ENTER);
+
+            strcpy(board[toRow][toCol], currentPlayer->pPiece.selectedPiece); //Update board
+            strcpy(board[fromRow][fromCol], "| _ |");
+
+            switchCard(currentPlayer, crdsIG, selectedCard, *playerTurn, *round); // Switch Card position
+            // Record the move
+            recordMove(replayMoves, moveCount, *playerTurn + 1, makePosition(fromCol, fromRow), makePosition(toCol, toRow), currentPlayer->pSelectedCard);
+
+            if (*playerTurn == 0) //Swap Turns
+                *playerTurn = 1;
+            else
+                *playerTurn = 0;
+
+            (*round)++;
+            currentPlayer->turns++;
+        }
+    }
+
+    return command;
+}
+
+/*
+Sets up the game by shuffling cards, assigning them to players, and reading player names
+
+Precondition:
+    - moveDeck must contain at least MAX_CARD_PER_GAME valid cards
+    - Player structures must be uninitialized
+    - crdsIG must be uninitialized
+
+@param moveDeck Array of card names to use, left in its original order
+@param cardCount Number of cards in moveDeck
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@param crdsIG Pointer to game cards data
+@param seed Seed of this game's generator, shown so the deal can be reproduced
+@param deal Receives the five dealt cards (P1, P1, P2, P2, neutral)
+@param term The terminal
+@return Returns no data type (void)
+*/
+void initializeGame(str30 moveDeck[], int cardCount, player *p1, player *p2, dataCrdsIG *crdsIG,
+                    unsigned long long seed, str30 deal[], terminal *term)
+{
+    int i, isValid;
+    str30 gameDeck[MAX_CARDS];
+    rngState rng;
+
+    // Shuffle a copy so every deal depends only on the seed, not on earlier games
+    for (i = 0; i < cardCount; i++)
+        strcpy(gameDeck[i], moveDeck[i]);
+    rngSeed(&rng, seed);
+
+    clearScreen(term);
+
+    printf("\x1b[33m" "These are the card before shuffling!\n\n" "\x1b[0m");
+    for (i = 0; i < cardCount; i++)
+        printf("\x1b[36m" "%s\n\n" "\x1b[0m", moveDeck[i]);
+    printf("Press any key to continue!\n");
+    readKey(term);
+
+    clearScreen(term);
+    shuffleCards(gameDeck, cardCount, &rng); // Shuffle Cards
+    assignMoveCards(gameDeck, p1, p2, crdsIG); // Assign After Shuffling
+
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+        strcpy(deal[i], gameDeck[i]);
+
+    printf("\x1b[33m" "These Are The Shuffled Cards! (seed %llu)\n\n" "\x1b[0m", seed);
+    for (i = 0; i < cardCount; i++)
+        printf("\x1b[36m" "%s\n\n" "\x1b[0m", gameDeck[i]);
+    printf("Press any key to continue!\n");
+    readKey(term);
+
+    p1->turns = 0;
+    p2->turns = 0;
+
+    clearScreen(term);
+    printf("\x1b[36m" "--- Onitama ---\n\n" "\x1b[0m");
+
+    /* Get player names */
+    do
+    {
+        isValid = 1;
+        printf("\x1b[33m" "Enter" "\x1b[0m" "\x1b[34m" " Player 1 " "\x1b[0m" "\x1b[33m" "Name: " "\x1b[0m");
+        readWord(term, p1->name);
+        for (i = 0; i < strlen(p1->name); i++)
+        {
+            if (!isAlpha(p1->name[i]))
+            {
+                printf("\x1b[31m" "Invalid Name!\n" "\x1b[0m");
+                isValid = 0;
+            }
+        }
+    } while (!isValid);
+
+    do
+    {
+        isValid = 1;
+        printf("\x1b[33m" "Enter" "\x1b[0m"  "\x1b[31m" " Player 2 " "\x1b[0m" "\x1b[33m" "Name: " "\x1b[0m");
+        readWord(term, p2->name);
+        for (i = 0; i < strlen(p2->name); i++)
+        {
+            if (!isAlpha(p2->name[i]))
+            {
+                printf("\x1b[31m" "Invalid Name!\n" "\x1b[0m");
+                isValid = 0;
+            }
+        }
+    } while (!isValid);
+}
+/*
+Appends a finished game to GameLog.txt so it can be reproduced from its seed
+
+Precondition:
+    - deal must hold the MAX_CARD_PER_GAME dealt cards
+    - replayMoves must contain moveCount valid moves
+
+@param seed Seed the game was dealt with
+@param deal The dealt cards (P1, P1, P2, P2, neutral)
+@param p1 Pointer to Player 1's data
+@param p2 Pointer to Player 2's data
+@param winner 1 or 2 for the winning player, 0 for a draw
+@param replayMoves Array containing all recorded moves
+@param moveCount Number of moves in replayMoves array
+@return Returns no data type (void)
+*/
+void saveGameRecord(unsigned long long seed, str30 deal[], player *p1, player *p2, int winner,
+                    MoveRecord *replayMoves, int moveCount)
+{
+    FILE *fp = fopen("GameLog.txt", "a");
+    int i;
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "Seed %llu\n", seed);
+        fprintf(fp, "Deal");
+        for (i = 0; i < MAX_CARD_PER_GAME; i++)
+            fprintf(fp, " %s", deal[i]);
+        fprintf(fp, "\nPlayers %s %s\n", p1->name, p2->name);
+        fprintf(fp, "Winner %d\n", winner);
+        fprintf(fp, "Moves %d\n", moveCount);
+
+        for (i = 0; i < moveCount; i++)
+            fprintf(fp, "%d %s %d %d %d %d\n", replayMoves[i].player, replayMoves[i].cardName,
+                    replayMoves[i].from.x, replayMoves[i].from.y,
+                    replayMoves[i].to.x, replayMoves[i].to.y);
+
+        fclose(fp);
+    }
+}
+
+/*
+Maps the shared-memory ring of a spectator channel. The broadcaster creates it (or takes over
+one whose broadcaster has exited), spectators map it read-only. Only one process may
+broadcast on a channel at a time, since the ring has a single producer
+
+Precondition:
+    - channel must be a short name without backslashes
+
+@param channel Name of the channel
+@param writer 1 to broadcast, 0 to spectate
+@param mapping Receives the mapping handle for closeSpectateRing
+@return Returns the ring, or NULL if it does not exist yet, is in use or cannot be mapped
+*/
+spectateRing *openSpectateRing(const char *channel, int writer, HANDLE *mapping)
+{
+    char name[MAX_NAME_LEN + 16];
+    spectateRing *ring = NULL;
+    int existed;
+
+    sprintf(name, "Local\\Onitama-%.30s", channel);
+    if (writer)
+        *mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(spectateRing), name);
+    else
+        *mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    existed = GetLastError() == ERROR_ALREADY_EXISTS;
+
+    if (*mapping != NULL)
+        ring = MapViewOfFile(*mapping, writer ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(spectateRing));
+
+    // a new mapping starts zeroed, a taken-over one keeps its head so attached spectators follow on
+    if (ring != NULL && writer && !existed)
+    {
+        memcpy(ring->magic, SPECTATE_MAGIC, sizeof(ring->magic));
+        ring->version = SPECTATE_VERSION;
+    }
+
+    if (ring != NULL && (memcmp(ring->magic, SPECTATE_MAGIC, sizeof(ring->magic)) != 0 ||
+                         ring->version != SPECTATE_VERSION || (writer && existed && !ring->closed)))
+    {
+        UnmapViewOfFile(ring);
+        ring = NULL;
+    }
+
+    if (ring != NULL && writer)
+        InterlockedExchange(&ring->closed, 0);
+    if (ring == NULL && *mapping != NULL)
+    {
+        CloseHandle(*mapping);
+        *mapping = NULL;
+    }
+    return ring;
+}
+
+/*
+Unmaps a spectator ring, marking it closed first when this process was broadcasting
+
+Precondition:
+    - ring and mapping must come from openSpectateRing
+
+@param ring The ring
+@param mapping The mapping handle
+@param writer 1 if the ring was opened to broadcast
+@return Returns no data type (void)
+*/
+void closeSpectateRing(spectateRing *ring, HANDLE mapping, int writer)
+{
+    if (writer)
+        InterlockedExchange(&ring->closed, 1);
+    UnmapViewOfFile(ring);
+    CloseHandle(mapping);
+}
+
+/*
+Publishes an event to the spectators without ever waiting for them: the slot is marked
+incomplete, filled in, stamped with its event number, and only then is the head advanced.
+A spectator that falls a whole ring behind finds its slot overwritten and resynchronizes
+
+Precondition:
+    - ring must be NULL or opened to broadcast
+
+@param ring The ring, NULL when not broadcasting
+@param event The event, its sequence is ignored
+@return Returns no data type (void)
+*/
+void publishEvent(spectateRing *ring, const spectateEvent *event)
+{
+    spectateEvent *slot;
+    LONG64 n;
+
+    if (ring != NULL)
+    {
+        n = ring->head;
+        slot = &ring->events[n & (SPECTATE_SLOTS - 1)];
+
+        InterlockedExchange64(&slot->sequence, 0);
+        slot->kind = event->kind;
+        slot->winner = event->winner;
+        slot->move = event->move;
+        memcpy(slot->deal, event->deal, sizeof(slot->deal));
+        memcpy(slot->names, event->names, sizeof(slot->names));
+        InterlockedExchange64(&slot->sequence, n + 1);
+        InterlockedExchange64(&ring->head, n + 1);
+    }
+}
+
+/*
+Copies event n out of the ring, checking its stamp before and after the copy so an event the
+broadcaster overwrote meanwhile is never taken for a complete one
+
+Precondition:
+    - n must be below ring->head
+
+@param ring The ring
+@param n Number of the event
+@param event Receives the event
+@return Returns 1 if the event was read intact, 0 if it has already been overwritten
+*/
+int readEvent(const spectateRing *ring, LONG64 n, spectateEvent *event)
+{
+    const spectateEvent *slot = &ring->events[n & (SPECTATE_SLOTS - 1)];
+    LONG64 stamp = slot->sequence;
+
+    MemoryBarrier();
+    event->kind = slot->kind;
+    event->winner = slot->winner;
+    event->move = slot->move;
+    memcpy(event->deal, slot->deal, sizeof(event->deal));
+    memcpy(event->names, slot->names, sizeof(event->names));
+    MemoryBarrier();
+
+    return stamp == n + 1 && slot->sequence == stamp;
+}
+
+/*
+Initializes and runs the main game sequence
+
+Precondition:
+    - Board must be properly allocated
+    - moveDeck must contain valid card names
+    - cardCount must be > 0 and <= MAX_CARDS
+
+@param board The game board array
+@param moveDeck Array containing all available move cards
+@param cardCount Number of cards in moveDeck
+@param seed Seed for this game's deal, recorded in GameLog.txt
+@param cards The card table loaded from moveDeck
+@param rule When repeated positions or the ply limit end the game in a draw
+@param control The time control both players start with, disabled for an untimed game
+@param term The terminal
+@return Returns no data type (void)
+*/
+void playGame(oniBrd board, str30 moveDeck[], int cardCount, unsigned long long seed, cardInfo cards[],
+              drawRule *rule, const gameClock *control, terminal *term)
+{
+    // All variables declared at top
+    player p1, p2;
+    dataCrdsIG crdsIG;
+    int playerTurn = 0;
+    int gameOver = 0;
+    int round = 1;
+    MoveRecord replayMoves[MAX_MOVES];
+    int moveCount = 0;
+    char choice;
+    str30 deal[MAX_CARD_PER_GAME];
+    zobristKeys keys;
+    hashHistory history;
+    gameState state;
+    gameState start;                    // the position before the first move, where the replay begins
+    unsigned long long hash;
+    undoRecord undo[MAX_MOVES];         // one per move in replayMoves, undo[i] takes back replayMoves[i]
+    int redoCount = 0;                  // undone moves still in replayMoves after moveCount
+    int command;
+    int mover;
+    int flagged = 0;                    // player whose time ran out, 0 if none
+    gameClock clock = *control;
+    spectateEvent event;
+
+    initializeGame(moveDeck, cardCount, &p1, &p2, &crdsIG, seed, deal, term);
+    populatePlayerPiece(&p1, &p2);
+    populateBoard(board, &p1, &p2);
+    playerTurn = getFirstTurn(crdsIG);
+    initZobrist(&keys);
+    historyClear(&history);
+    stateFromBoard(board, &p1, &p2, &crdsIG, playerTurn, round, cards, cardCount, &state);
+    start = state;
+    hash = hashState(&state, &keys);
+
+    memset(&event, 0, sizeof(event));
+    event.kind = SPECTATE_START;
+    memcpy(event.deal, deal, sizeof(event.deal));
+    strcpy(event.names[0], p1.name);
+    strcpy(event.names[1], p2.name);
+    publishEvent(term->broadcast, &event);
+
+    while (!gameOver) 
+    {
+        // shuffling cards back and forth never ends the game by itself, so repeats end it in a draw
+        if (moveCount >= rule->maxPlies ||
+            (rule->repetitions > 0 && historyOccurrences(&history, hash) + 1 >= rule->repetitions))
+            gameOver = 3;
+        else
+        {
+            mover = playerTurn;
+            if (clock.enabled)
+                startClock(&clock, mover);
+            command = gameTurn(&p1, &p2, board, &crdsIG, &playerTurn, &round, replayMoves, &moveCount, cards,
+                               cardCount, &clock, term);
+
+            // the clock is read once the turn is over, a move finished after the flag fell is taken back
+            if (clock.enabled && !stopClock(&clock, command == TURN_PLAYED))
+            {
+                if (command == TURN_PLAYED)
+                {
+                    moveCount--;
+                    if (mover == 0)
+                        p1.turns--;
+                    else
+                        p2.turns--;
+                }
+                command = TURN_FLAGGED;
+                flagged = mover + 1;
+                gameOver = mover == 0 ? 2 : 1;
+            }
+
+            // the rules state follows the board through makeMove, and leads it back on undo and redo
+            if (command == TURN_PLAYED)
+            {
+                historyPush(&history, hash);
+                gameOver = makeMove(&state, coreMoveFromRecord(&replayMoves[moveCount - 1], cards, cardCount),
+                                    cards, &keys, &hash, NULL, &undo[moveCount - 1]);
+                redoCount = 0;
+                event.kind = SPECTATE_MOVE;
+                event.move = replayMoves[moveCount - 1];
+                publishEvent(term->broadcast, &event);
+            }
+            else if (command == TURN_UNDO && moveCount > 0)
+            {
+                moveCount--;
+                redoCount++;
+                historyPop(&history);
+                unmakeMove(&state, &undo[moveCount], &hash, NULL);
+                if (state.side == 0)
+                    p1.turns--;
+                else
+                    p2.turns--;
+                event.kind = SPECTATE_UNDO;
+                publishEvent(term->broadcast, &event);
+            }
+            else if (command == TURN_REDO && redoCount > 0)
+            {
+                if (state.side == 0)
+                    p1.turns++;
+                else
+                    p2.turns++;
+                historyPush(&history, hash);
+                gameOver = makeMove(&state, coreMoveFromRecord(&replayMoves[moveCount], cards, cardCount),
+                                    cards, &keys, &hash, NULL, &undo[moveCount]);
+                moveCount++;
+                redoCount--;
+                event.kind = SPECTATE_MOVE;
+                event.move = replayMoves[moveCount - 1];
+                publishEvent(term->broadcast, &event);
+            }
+
+            if (command != TURN_PLAYED)
+            {
+                boardFromState(&state, cards, board, &p1, &p2, &crdsIG);
+                playerTurn = state.side;
+                round = state.round;
+            }
+        }
+    } 
+
+    if (flagged != 0)
+    {
+        displayBoard(board, &p1, &p2, &crdsIG, 0, 0, 0, 0, 0, &clock, NULL, term);
+        printf("\n%s ran out of time.\n", flagged == 1 ? p1.name : p2.name);
+    }
+
+    if (gameOver == 3)
+    {
+        displayBoard(board, &p1, &p2, &crdsIG, 0, 0, 0, 0, 0, &clock, NULL, term);
+        if (moveCount >= rule->maxPlies)
+            printf("\nDraw! The game reached the %d move limit.\n", rule->maxPlies);
+        else
+            printf("\nDraw! The same position came up %d times.\n", rule->repetitions);
+        pauseScreen(term, 1000);
+        gameOver = 0;
+    }
+    else if (gameOver == 1) 
+    {
+        pauseScreen(term, 1000);
+        printf("\nCongratulations %s! You won!\n", p1.name);
+        updateHoF(p1);
+        pauseScreen(term, 1000);
+    }
+    else 
+    {
+        pauseScreen(term, 1000);
+        printf("\nCongratulations %s! You won!\n", p2.name);
+        updateHoF(p2);
+        pauseScreen(term, 1000);
+    }
+    saveGameRecord(seed, deal, &p1, &p2, gameOver, replayMoves, moveCount);
+    recordResult(p1.name, p2.name, gameOver);
+    event.kind = SPECTATE_RESULT;
+    event.winner = gameOver;
+    publishEvent(term->broadcast, &event);
+
+    do 
+    {
+        printf("Would you like to replay the game? (y/n): ");
+        choice = readChoice(term);
+    } while (!(choice == 'y' || choice == 'Y' ||choice == 'n' || choice == 'N'));
+
+    if(choice == 'y' || choice == 'Y')
+        replayMovesSequence(replayMoves, moveCount, &start, cards, cardCount, term);
+
+    printf("Press any key to return to main menu...");
+    readKey(term);    
+}
+
+/*
+Finds the value that follows a command line flag
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param flag The flag to look for, e.g. "-seed"
+@return Returns the argument after flag, or NULL if the flag is absent
+*/
+char *argValue(int argc, char *argv[], const char *flag)
+{
+    int i;
+    char *value = NULL;
+
+    for (i = 1; i < argc - 1 && value == NULL; i++)
+    {
+        if (strcmp(argv[i], flag) == 0)
+            value = argv[i + 1];
+    }
+    return value;
+}
+
+/*
+Checks whether a command line flag without a value is present
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param flag The flag to look for, e.g. "-stats"
+@return Returns 1 if the flag is present, 0 otherwise
+*/
+int hasFlag(int argc, char *argv[], const char *flag)
+{
+    int i;
+    int found = 0;
+
+    for (i = 1; i < argc && !found; i++)
+        found = strcmp(argv[i], flag) == 0;
+    return found;
+}
+
+/*
+Returns how many worker threads to use: the "-threads" flag, or one per processor
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns a thread count between 1 and MAX_THREADS
+*/
+int threadCount(int argc, char *argv[])
+{
+    SYSTEM_INFO info;
+    char *value = argValue(argc, argv, "-threads");
+    int count;
+
+    GetSystemInfo(&info);
+    count = value != NULL ? atoi(value) : (int) info.dwNumberOfProcessors;
+
+    if (count < 1)
+        count = 1;
+    if (count > MAX_THREADS)
+        count = MAX_THREADS;
+    return count;
+}
+
+/*
+Reads "-tt-bits <n>", the log2 of the number of transposition table entries
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns the requested size between 10 and 30, ANALYSIS_TT_BITS if none is given
+*/
+int ttBitsArg(int argc, char *argv[])
+{
+    char *value = argValue(argc, argv, "-tt-bits");
+    int bits = value != NULL ? atoi(value) : ANALYSIS_TT_BITS;
+
+    if (bits < 10)
+        bits = 10;
+    if (bits > 30)
+        bits = 30;
+    return bits;
+}
+
+/*
+Reads "-multipv <k>", the number of best moves to report with their own scores
+
+Precondition:
+    - argv must hold argc arguments
+
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns a count between 1 and MAX_MULTIPV, 1 if none is given
+*/
+int multiPVArg(int argc, char *argv[])
+{
+    char *value = argValue(argc, argv, "-multipv");
+    int lineCount = value != NULL ? atoi(value) : 1;
+
+    if (lineCount < 1)
+        lineCount = 1;
+    if (lineCount > MAX_MULTIPV)
+        lineCount = MAX_MULTIPV;
+    return lineCount;
+}
+
+/*
+Analyzes one line of a batch file and writes the result line
+
+Precondition:
+    - ctx must have been set up with initSearch
+    - line and out must have room for MAX_POSITION_LEN and MAX_RESULT_LEN characters
+
+@param ctx The worker's own search context
+@param job The batch being analyzed
+@param line The position notation to analyze
+@param out Receives the result line
+@return Returns no data type (void)
+*/
+void analyzeLine(searchContext *ctx, analysisJob *job, const char *line, char *out)
+{
+    gameState state;
+    searchResult result;
+    pvLine lines[MAX_MULTIPV];
+    char moveText[MAX_NAME_LEN + 16];
+    int found, i;
+
+    if (!parsePosition(line, job->cards, job->cardCount, &state))
+        sprintf(out, "%s | error invalid position", line);
+
+    else if (coreWinner(&state) != 0)
+        sprintf(out, "%s | result %d", line, coreWinner(&state));
+
+    else
+    {
+        historyClear(&ctx->history);
+        found = 0;
+        if (job->multiPV > 1)
+            found = searchMultiPV(ctx, &state, job->depth, job->timeMs, job->multiPV, lines, &result);
+        else
+            searchPosition(ctx, &state, job->depth, job->timeMs, &result);
+        formatMove(result.best, job->cards, moveText);
+        sprintf(out, "%s | bestmove %s score %d depth %d nodes %llu", line, moveText,
+                result.score, result.depth, result.nodes);
+
+        // only the root move of each line, the whole variations would not fit a result line
+        for (i = 1; i < found; i++)
+        {
+            formatMove(lines[i].moves[0], job->cards, moveText);
+            sprintf(out + strlen(out), " | move%d %s score %d", i + 1, moveText, lines[i].score);
+        }
+        if (job->stats)
+            formatSearchStats(&result, &ctx->stats, out + strlen(out));
+    }
+}
+
+/*
+Worker thread of the batch analysis: takes the next unclaimed line until none are left
+
+Precondition:
+    - param must point to a running analysisJob
+
+@param param The analysisJob shared by all workers
+@return Returns 0 when the batch is exhausted
+*/
+DWORD WINAPI analysisWorker(LPVOID param)
+{
+    analysisJob *job = (analysisJob *) param;
+    searchContext ctx;
+    int i;
+
+    if (openSearch(&ctx, job->cards, job->cardCount, job->keys, job->ttFile, job->ttBits))
+    {
+        while ((i = InterlockedIncrement(&job->next) - 1) < job->count)
+        {
+            analyzeLine(&ctx, job, job->lines[i], job->results[i]);
+
+            EnterCriticalSection(&job->lock);
+            job->done[i] = 1;
+            WakeAllConditionVariable(&job->finished);
+            LeaveCriticalSection(&job->lock);
+        }
+        freeSearch(&ctx);
+    }
+    return 0;
+}
+
+/*
+Reads every non-empty line of a text file into a growing array
+
+Precondition:
+    - lines and count must be valid pointers
+
+@param filename File to read
+@param lines Receives a malloc'd array of lines, to be released with free
+@param count Receives the number of lines
+@return Returns 1 if the file was read, 0 otherwise
+*/
+int readLines(const char *filename, char (**lines)[MAX_POSITION_LEN], int *count)
+{
+    FILE *fp = fopen(filename, "r");
+    char buffer[MAX_POSITION_LEN];
+    char (*grown)[MAX_POSITION_LEN];
+    int capacity = 0;
+    int status = fp != NULL;
+
+    *lines = NULL;
+    *count = 0;
+
+    while (status && fgets(buffer, sizeof(buffer), fp) != NULL)
+    {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (buffer[0] != '\0' && buffer[0] != '#')
+        {
+            if (*count == capacity)
+            {
+                capacity = capacity == 0 ? 1024 : capacity * 2;
+                grown = realloc(*lines, capacity * sizeof(**lines));
+                if (grown == NULL)
+                    status = 0;
+                else
+                    *lines = grown;
+            }
+            if (status)
+                strcpy((*lines)[(*count)++], buffer);
+        }
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+    else
+        printf("Error: Cannot open file %s\n", filename);
+
+    return status;
+}
+
+/*
+Batch mode "-analyze <file>": analyzes every position of a file on all cores and streams
+the results to stdout in input order as soon as each one is ready.
+Options: "-depth <plies>" (default DEFAULT_ANALYSIS_DEPTH), "-time <ms>" per position, "-threads <n>",
+"-tt-file <file>" to keep the transposition table in a file shared by all workers and later runs,
+"-tt-bits <n>" its size, "-multipv <k>" to also list the next best moves with their scores
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param filename File with one position notation per line ('#' starts a comment)
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if the file or the table file could not be read
+*/
+int runBatchAnalysis(const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    analysisJob job;
+    zobristKeys keys;
+    searchContext check;
+    HANDLE workers[MAX_THREADS];
+    int nWorkers = threadCount(argc, argv);
+    int ready = 1;
+    char *depthArg = argValue(argc, argv, "-depth");
+    char *timeArg = argValue(argc, argv, "-time");
+    int i;
+    int status = 1;
+
+    initZobrist(&keys);
+    job.cards = cards;
+    job.cardCount = cardCount;
+    job.keys = &keys;
+    job.timeMs = timeArg != NULL ? atoi(timeArg) : 0;
+    job.depth = depthArg != NULL ? atoi(depthArg) : (job.timeMs > 0 ? MAX_SEARCH_DEPTH : DEFAULT_ANALYSIS_DEPTH);
+    if (job.depth < 1 || job.depth > MAX_SEARCH_DEPTH)
+        job.depth = MAX_SEARCH_DEPTH;
+    job.next = 0;
+    job.stats = hasFlag(argc, argv, "-stats");
+    job.multiPV = multiPVArg(argc, argv);
+    job.ttFile = argValue(argc, argv, "-tt-file");
+    job.ttBits = ttBitsArg(argc, argv);
+
+    // the table file is created or checked once here, before the workers map it
+    if (job.ttFile != NULL)
+    {
+        ready = initSearchFile(&check, cards, cardCount, &keys, job.ttBits, job.ttFile);
+        if (ready)
+            freeSearch(&check);
+    }
+
+    if (ready && readLines(filename, &job.lines, &job.count))
+    {
+        status = 0;
+        job.results = malloc((job.count + 1) * sizeof(*job.results));
+        job.done = calloc(job.count + 1, sizeof(*job.done));
+        InitializeCriticalSection(&job.lock);
+        InitializeConditionVariable(&job.finished);
+
+        for (i = 0; i < nWorkers; i++)
+            workers[i] = CreateThread(NULL, 0, analysisWorker, &job, 0, NULL);
+
+        // stream results in input order while the workers run ahead
+        for (i = 0; i < job.count; i++)
+        {
+            EnterCriticalSection(&job.lock);
+            while (!job.done[i])
+                SleepConditionVariableCS(&job.finished, &job.lock, INFINITE);
+            LeaveCriticalSection(&job.lock);
+
+            printf("%s\n", job.results[i]);
+            fflush(stdout);
+        }
+
+        WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+        for (i = 0; i < nWorkers; i++)
+            CloseHandle(workers[i]);
+
+        DeleteCriticalSection(&job.lock);
+        free((void *) job.done);
+        free(job.results);
+        free(job.lines);
+    }
+    return status;
+}
+
+/*
+Sets up the starting position of a deal, with the first turn taken from the neutral card's color
+
+Precondition:
+    - deal must hold MAX_CARD_PER_GAME distinct card ids (P1, P1, P2, P2, neutral)
+
+@param deal The dealt card ids
+@param cards The card table
+@param state Receives the starting position
+@return Returns no data type (void)
+*/
+void initialState(const int deal[], cardInfo cards[], gameState *state)
+{
+    int col;
+
+    state->pieces[0] = state->pieces[1] = 0;
+    for (col = 0; col < COLS; col++)
+    {
+        state->pieces[0] |= SQUARE_BIT(SQUARE_OF(ROWS-1, col));
+        state->pieces[1] |= SQUARE_BIT(SQUARE_OF(0, col));
+    }
+    state->master[0] = SQUARE_OF(ROWS-1, COLS/2);
+    state->master[1] = SQUARE_OF(0, COLS/2);
+
+    state->hand[0][0] = deal[0];
+    state->hand[0][1] = deal[1];
+    state->hand[1][0] = deal[2];
+    state->hand[1][1] = deal[3];
+    state->neutral = deal[4];
+    state->side = cards[deal[4]].color;
+    state->round = 1;
+    refreshAttacks(state, cards);
+}
+
+/*
+Deals the five cards of a seed exactly as initializeGame does for the same seed
+
+Precondition:
+    - cards must hold cardCount >= MAX_CARD_PER_GAME loaded cards
+
+@param seed The game seed
+@param cards The card table, in movecards.txt order
+@param cardCount Number of cards in the table
+@param deal Receives the dealt card ids
+@return Returns no data type (void)
+*/
+void dealFromSeed(unsigned long long seed, cardInfo cards[], int cardCount, int deal[])
+{
+    str30 gameDeck[MAX_CARDS];
+    rngState rng;
+    int i;
+
+    for (i = 0; i < cardCount; i++)
+        strcpy(gameDeck[i], cards[i].name);
+
+    rngSeed(&rng, seed);
+    shuffleCards(gameDeck, cardCount, &rng);
+
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+        deal[i] = findCardId(cards, cardCount, gameDeck[i]);
+}
+
+/*
+Writes a game in the GameLog.txt format into a buffer. A pass is written with equal from/to
+coordinates
+
+Precondition:
+    - record must hold a complete game
+    - out must have room for MAX_RECORD_TEXT characters
+
+@param record The game to write
+@param cards The card table
+@param out Receives the text
+@return Returns the length of the text
+*/
+int formatGameRecord(const gameRecord *record, cardInfo cards[], char *out)
+{
+    gameState state;
+    int i, n;
+
+    initialState(record->deal, cards, &state);
+
+    n = sprintf(out, "Seed %llu\nDeal", record->seed);
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+        n += sprintf(out + n, " %s", cards[record->deal[i]].name);
+    n += sprintf(out + n, "\nPlayers %s %s\nWinner %d\nMoves %d\n", record->names[0], record->names[1],
+                 record->winner, record->length);
+
+    for (i = 0; i < record->length; i++)
+    {
+        n += sprintf(out + n, "%d %s %d %d %d %d\n", state.side + 1, cards[MOVE_CARD(record->moves[i])].name,
+                     MOVE_FROM(record->moves[i]) % COLS, MOVE_FROM(record->moves[i]) / COLS,
+                     MOVE_TO(record->moves[i]) % COLS, MOVE_TO(record->moves[i]) / COLS);
+        state.side = !state.side;
+    }
+    return n;
+}
+
+/*
+Appends a game in the GameLog.txt format. A pass is written with equal from/to coordinates
+
+Precondition:
+    - fp must be open for writing
+    - record must hold a complete game
+
+@param fp File to write to
+@param record The game to write
+@param cards The card table
+@return Returns no data type (void)
+*/
+void writeGameRecord(FILE *fp, const gameRecord *record, cardInfo cards[])
+{
+    char text[MAX_RECORD_TEXT];
+
+    formatGameRecord(record, cards, text);
+    fputs(text, fp);
+}
+
+/*
+Reads the next game of a GameLog.txt style file
+
+Precondition:
+    - fp must be open for reading
+    - cards must hold cardCount loaded cards
+
+@param fp File to read from
+@param cards The card table
+@param cardCount Number of cards in the table
+@param record Receives the game
+@return Returns 1 for a game, 0 at the end of the file, -1 for a malformed game
+*/
+int readGameRecord(FILE *fp, cardInfo cards[], int cardCount, gameRecord *record)
+{
+    char names[MAX_CARD_PER_GAME][MAX_NAME_LEN];
+    char cardName[MAX_NAME_LEN];
+    int playerNo, fromX, fromY, toX, toY, card, i;
+    int status = 1;
+
+    if (fscanf(fp, " Seed %llu", &record->seed) != 1)
+        status = feof(fp) ? 0 : -1;
+
+    else if (fscanf(fp, " Deal %30s %30s %30s %30s %30s", names[0], names[1], names[2], names[3], names[4]) != 5 ||
+             fscanf(fp, " Players %30s %30s", record->names[0], record->names[1]) != 2 ||
+             fscanf(fp, " Winner %d Moves %d", &record->winner, &record->length) != 2 ||
+             record->length < 0 || record->length > MAX_MOVES)
+        status = -1;
+
+    for (i = 0; status == 1 && i < MAX_CARD_PER_GAME; i++)
+    {
+        record->deal[i] = findCardId(cards, cardCount, names[i]);
+        if (record->deal[i] < 0)
+            status = -1;
+    }
+
+    for (i = 0; status == 1 && i < record->length; i++)
+    {
+        if (fscanf(fp, "%d %30s %d %d %d %d", &playerNo, cardName, &fromX, &fromY, &toX, &toY) != 6)
+            status = -1;
+        else
+        {
+            card = findCardId(cards, cardCount, cardName);
+            if (card < 0 || fromX < 0 || fromX >= COLS || fromY < 0 || fromY >= ROWS ||
+                toX < 0 || toX >= COLS || toY < 0 || toY >= ROWS)
+                status = -1;
+            else if (fromX == toX && fromY == toY)
+                record->moves[i] = MAKE_MOVE(card, 0, 0);
+            else
+                record->moves[i] = MAKE_MOVE(card, SQUARE_OF(fromY, fromX), SQUARE_OF(toY, toX));
+        }
+    }
+    return status;
+}
+
+/*
+Finds the first game that starts on a new line after p, so a worker can begin parsing in the
+middle of a file and resume after a malformed game
+
+Precondition:
+    - p and end must point into the same buffer, p <= end
+
+@param p Where to start looking
+@param end End of the buffer
+@return Returns the start of the next "Seed" line, or end if there is none
+*/
+const char *nextGameStart(const char *p, const char *end)
+{
+    const char *found = end;
+
+    while (p < end && found == end)
+    {
+        p = memchr(p, '\n', end - p);
+        if (p == NULL)
+            p = end;
+        else
+        {
+            p++;
+            if (end - p >= 4 && memcmp(p, "Seed", 4) == 0)
+                found = p;
+        }
+    }
+    return found;
+}
+
+/*
+Reads the next whitespace-separated word of a text buffer
+
+Precondition:
+    - word must have room for MAX_NAME_LEN + 1 characters
+
+@param cursor Read position, moved past the word
+@param end End of the buffer
+@param word Receives the word
+@return Returns 1 for a word of at most MAX_NAME_LEN characters, 0 otherwise
+*/
+int scanWord(const char **cursor, const char *end, char *word)
+{
+    const char *p = *cursor;
+    int n = 0;
+
+    while (p < end && isspace((unsigned char) *p))
+        p++;
+    while (p < end && !isspace((unsigned char) *p))
+    {
+        if (n < MAX_NAME_LEN)
+            word[n] = *p;
+        n++;
+        p++;
+    }
+    word[n < MAX_NAME_LEN ? n : MAX_NAME_LEN] = '\0';
+
+    *cursor = p;
+    return n > 0 && n <= MAX_NAME_LEN;
+}
+
+/*
+Reads the next word of a text buffer as an unsigned decimal number
+
+Precondition: None
+
+@param cursor Read position, moved past the word
+@param end End of the buffer
+@param value Receives the number
+@return Returns 1 if the word was a number, 0 otherwise
+*/
+int scanNumber(const char **cursor, const char *end, unsigned long long *value)
+{
+    char word[MAX_NAME_LEN + 1];
+    char *stop = word;
+    int ok = scanWord(cursor, end, word) && isdigit((unsigned char) word[0]);
+
+    if (ok)
+        *value = strtoull(word, &stop, 10);
+    return ok && *stop == '\0';
+}
+
+/*
+Parses the next game of a GameLog.txt style text held in memory, the way readGameRecord reads
+one from a file
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param cursor Read position, moved past the game or to where a malformed game went wrong
+@param end End of the text
+@param cards The card table
+@param cardCount Number of cards in the table
+@param record Receives the game
+@return Returns 1 for a game, 0 at the end of the text, -1 for a malformed game
+*/
+int parseGameText(const char **cursor, const char *end, cardInfo cards[], int cardCount, gameRecord *record)
+{
+    char word[MAX_NAME_LEN + 1];
+    unsigned long long value, fromX, fromY, toX, toY;
+    int card, i;
+    int status = 1;
+
+    while (*cursor < end && isspace((unsigned char) **cursor))
+        (*cursor)++;
+
+    if (*cursor == end)
+        status = 0;
+    else if (!scanWord(cursor, end, word) || strcmp(word, "Seed") != 0 || !scanNumber(cursor, end, &value) ||
+             !scanWord(cursor, end, word) || strcmp(word, "Deal") != 0)
+        status = -1;
+    else
+        record->seed = value;
+
+    for (i = 0; status == 1 && i < MAX_CARD_PER_GAME; i++)
+    {
+        if (!scanWord(cursor, end, word) || (record->deal[i] = findCardId(cards, cardCount, word)) < 0)
+            status = -1;
+    }
+
+    if (status == 1 &&
+        (!scanWord(cursor, end, word) || strcmp(word, "Players") != 0 ||
+         !scanWord(cursor, end, record->names[0]) || !scanWord(cursor, end, record->names[1]) ||
+         !scanWord(cursor, end, word) || strcmp(word, "Winner") != 0 || !scanNumber(cursor, end, &value) ||
+         value > 2))
+        status = -1;
+    else if (status == 1)
+        record->winner = (int) value;
+
+    if (status == 1 &&
+        (!scanWord(cursor, end, word) || strcmp(word, "Moves") != 0 || !scanNumber(cursor, end, &value) ||
+         value > MAX_MOVES))
+        status = -1;
+    else if (status == 1)
+        record->length = (int) value;
+
+    for (i = 0; status == 1 && i < record->length; i++)
+    {
+        if (!scanNumber(cursor, end, &value) || !scanWord(cursor, end, word) ||
+            !scanNumber(cursor, end, &fromX) || !scanNumber(cursor, end, &fromY) ||
+            !scanNumber(cursor, end, &toX) || !scanNumber(cursor, end, &toY))
+            status = -1;
+        else
+        {
+            card = findCardId(cards, cardCount, word);
+            if (card < 0 || fromX >= COLS || fromY >= ROWS || toX >= COLS || toY >= ROWS)
+                status = -1;
+            else if (fromX == toX && fromY == toY)
+                record->moves[i] = MAKE_MOVE(card, 0, 0);
+            else
+                record->moves[i] = MAKE_MOVE(card, SQUARE_OF((int) fromY, (int) fromX), SQUARE_OF((int) toY, (int) toX));
+        }
+    }
+    return status;
+}
+
+/*
+Plays one engine-versus-engine game. The first SELFPLAY_RANDOM_PLIES plies are random so
+games with the same deal still differ; a repetition or the ply limit of the draw rule ends
+the game with winner 0. Under a time control each move is searched for its moveBudget and a side
+whose clock runs out loses
+
+Precondition:
+    - ctx must have been set up with initSearch
+    - cards must hold cardCount loaded cards
+    - clock must hold the starting clocks, both stopped
+
+@param ctx The search context of the engine
+@param rng Generator for the game seed and the random plies
+@param depth Search depth of every engine move, the deepest one under a time control
+@param rule The draw rule
+@param clock The clocks of the game, left as they stand at the end
+@param cards The card table
+@param cardCount Number of cards in the table
+@param record Receives the game
+@return Returns no data type (void)
+*/
+void selfPlayGame(searchContext *ctx, rngState *rng, int depth, const drawRule *rule, gameClock *clock,
+                  cardInfo cards[], int cardCount, gameRecord *record)
+{
+    searchResult result;
+    gameState state;
+    coreMove moves[MAX_CORE_MOVES];
+    undoRecord undo;
+    unsigned long long hash;
+    int count;
+    int winner = 0;
+    int drawn = 0;
+
+    record->seed = rngNext(rng);
+    dealFromSeed(record->seed, cards, cardCount, record->deal);
+    strcpy(record->names[0], "Engine");
+    strcpy(record->names[1], "Engine");
+    record->length = 0;
+
+    initialState(record->deal, cards, &state);
+    historyClear(&ctx->history);
+    hash = hashState(&state, ctx->keys);
+
+    while (winner == 0 && !drawn)
+    {
+        drawn = record->length >= rule->maxPlies ||
+                (rule->repetitions > 0 && historyOccurrences(&ctx->history, hash) + 1 >= rule->repetitions);
+
+        if (!drawn)
+        {
+            if (clock->enabled)
+                startClock(clock, state.side);
+
+            if (record->length < SELFPLAY_RANDOM_PLIES)
+            {
+                count = generateMoves(&state, cards, moves);
+                result.best = moves[rngBelow(rng, count)];
+            }
+            else
+                searchPosition(ctx, &state, depth, clock->enabled ? moveBudget(clock, state.side) : 0, &result);
+
+            if (clock->enabled && !stopClock(clock, 1))
+                winner = 2 - state.side; // lost on time, the late move is not played
+            else
+            {
+                record->moves[record->length++] = result.best;
+                historyPush(&ctx->history, hash);
+                winner = makeMove(&state, result.best, ctx->cards, ctx->keys, &hash, NULL, &undo);
+            }
+        }
+    }
+    record->winner = winner;
+}
+
+/*
+Self-play mode "-selfplay <games> <file>": the engine plays both sides of seeded deals and
+appends every game to file in the GameLog.txt format. The first SELFPLAY_RANDOM_PLIES plies
+are random so games with the same deal still differ. Games that repeat a position or run out
+of plies under the draw rule are written with winner 0.
+Options: "-seed <n>" first game seed, "-depth <plies>" (default SELFPLAY_DEPTH, or no limit under
+a time control), "-clock <minutes>+<seconds>" (see readClock), "-repetition <n>" and "-maxplies <n>"
+(see readDrawRule)
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param games Number of games to play
+@param filename File the games are appended to
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if the file could not be opened
+*/
+int runSelfPlay(int games, const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    FILE *fp = fopen(filename, "a");
+    zobristKeys keys;
+    searchContext ctx;
+    gameRecord record;
+    rngState rng;
+    char *depthArg = argValue(argc, argv, "-depth");
+    char *seedArg = argValue(argc, argv, "-seed");
+    int depth = depthArg != NULL ? atoi(depthArg) : SELFPLAY_DEPTH;
+    int game;
+    int status = 1;
+    drawRule rule;
+    gameClock control, clock;
+
+    initZobrist(&keys);
+    readDrawRule(argc, argv, &rule);
+    readClock(argc, argv, &control);
+    if (control.enabled && depthArg == NULL)
+        depth = MAX_SEARCH_DEPTH;
+    rngSeed(&rng, seedArg != NULL ? strtoull(seedArg, NULL, 10) : (unsigned long long) time(NULL));
+
+    if (fp != NULL && initSearch(&ctx, cards, &keys, ANALYSIS_TT_BITS))
+    {
+        status = 0;
+        for (game = 0; game < games; game++)
+        {
+            clock = control;
+            selfPlayGame(&ctx, &rng, depth, &rule, &clock, cards, cardCount, &record);
+            writeGameRecord(fp, &record, cards);
+        }
+        freeSearch(&ctx);
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+    else
+        printf("Error: Cannot open file %s\n", filename);
+
+    return status;
+}
+
+/*
+Counts the squares of a mask with shifts and adds only, so loops across games that use it
+stay vectorizable
+
+Precondition: None
+
+@param mask The mask to count
+@return Returns the number of squares in mask
+*/
+int countSquares(boardMask mask)
+{
+    boardMask m = mask;
+
+    m = m - ((m >> 1) & (boardMask) 0x5555555555555555ULL);
+    m = (m & (boardMask) 0x3333333333333333ULL) + ((m >> 2) & (boardMask) 0x3333333333333333ULL);
+    m = (m + (m >> 4)) & (boardMask) 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((unsigned long long) m * 0x0101010101010101ULL >> (8 * sizeof(boardMask) - 8) & 0xFF);
+}
+
+/*
+Advances a lane's xorshift32 generator, the cheap per-game generator of the simulator
+
+Precondition:
+    - state must not be 0
+
+@param state The generator state, updated in place
+@return Returns the next pseudo random 32-bit value
+*/
+unsigned int laneRandom(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*
+Deals simulated game number game: five distinct cards drawn with a generator seeded from
+seed + game, which then seeds the game's move generator
+
+Precondition:
+    - cardCount must be at least MAX_CARD_PER_GAME
+
+@param seed Seed of the whole simulation
+@param game Number of the game
+@param cardCount Number of cards in the table
+@param deal Receives the dealt card ids (P1, P1, P2, P2, neutral)
+@param random Receives the seed of the game's move generator, never 0
+@return Returns no data type (void)
+*/
+void simulatedDeal(unsigned long long seed, int game, int cardCount, int deal[], unsigned int *random)
+{
+    rngState rng;
+    int ids[MAX_CARDS];
+    int i, j, tmp;
+
+    rngSeed(&rng, seed + (unsigned long long) game);
+    for (i = 0; i < cardCount; i++)
+        ids[i] = i;
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+    {
+        j = i + rngBelow(&rng, cardCount - i);
+        tmp = ids[i];
+        ids[i] = ids[j];
+        ids[j] = tmp;
+        deal[i] = ids[i];
+    }
+    *random = (unsigned int) rngNext(&rng) | 1;
+}
+
+/*
+Splits every card's destinations by distance: for each distance from an origin square to a
+destination square, the origin squares that move that far. The destinations of a whole side
+for one distance are then a single shift of its pieces, which loops across games can compute
+without looking at the squares one by one. Distances are kept in increasing order
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param cards The card table
+@param cardCount Number of cards in the table
+@param shifts Receives the split table
+@return Returns no data type (void)
+*/
+void buildMoveShifts(cardInfo cards[], int cardCount, moveShifts *shifts)
+{
+    boardMask targets;
+    int card, side, sq, distance, group, entry;
+
+    memset(shifts, 0, sizeof(moveShifts));
+    for (card = 0; card < cardCount; card++)
+        for (side = 0; side < 2; side++)
+        {
+            group = (card * 2 + side) * MAX_CARD_SHIFTS;
+            entry = 0;
+            for (distance = 1 - NUM_SQUARES; distance < NUM_SQUARES; distance++)
+            {
+                shifts->origins[group + entry] = 0;
+                for (sq = 0; sq < NUM_SQUARES; sq++)
+                {
+                    targets = cards[card].moves[side][sq];
+                    if (sq + distance >= 0 && sq + distance < NUM_SQUARES && (targets & SQUARE_BIT(sq + distance)))
+                        shifts->origins[group + entry] |= SQUARE_BIT(sq);
+                }
+                if (shifts->origins[group + entry] != 0 && entry < MAX_CARD_SHIFTS)
+                {
+                    shifts->distance[group + entry] = distance;
+                    shifts->left[group + entry] = distance > 0 ? distance : 0;
+                    shifts->right[group + entry] = distance < 0 ? -distance : 0;
+                    entry++;
+                }
+            }
+            if (entry < MAX_CARD_SHIFTS)
+                shifts->origins[group + entry] = 0;
+            if (entry > shifts->count)
+                shifts->count = entry;
+        }
+}
+
+/*
+Plays one simulated game the plain way, one position at a time with generateMoves: the reference
+the batched kernel must match game for game. The k-th move is played, k drawn from the game's
+xorshift32 generator, with moves taken in the kernel's order: card slot, then distance in the
+order of shifts, then origin square. The draw rule is checked before every move, as in
+selfPlayGame
+
+Precondition:
+    - cards must hold cardCount loaded cards
+    - shifts must come from buildMoveShifts on the same cards
+    - keys must have been filled by initZobrist
+
+@param seed Seed of the whole simulation
+@param game Number of the game
+@param rule The draw rule
+@param cards The card table
+@param cardCount Number of cards in the table
+@param shifts The destinations split by distance
+@param keys The Zobrist key table
+@param history Scratch history of the game's positions
+@param plies Receives the length of the game
+@return Returns 1 or 2 for the winner, 0 for a draw
+*/
+int simulateGame(unsigned long long seed, int game, const drawRule *rule, cardInfo cards[], int cardCount,
+                 const moveShifts *shifts, const zobristKeys *keys, hashHistory *history, int *plies)
+{
+    gameState state;
+    coreMove moves[MAX_CORE_MOVES];
+    undoRecord undo;
+    unsigned long long hash;
+    int deal[MAX_CARD_PER_GAME];
+    unsigned int random;
+    int count, pick, chosen, slot, entry, group, i;
+    int winner = 0;
+
+    simulatedDeal(seed, game, cardCount, deal, &random);
+    initialState(deal, cards, &state);
+    historyClear(history);
+    hash = hashState(&state, keys);
+    *plies = 0;
+
+    while (winner == 0 && *plies < rule->maxPlies &&
+           !(rule->repetitions > 0 && historyOccurrences(history, hash) + 1 >= rule->repetitions))
+    {
+        count = generateMoves(&state, cards, moves);
+        pick = (int) ((unsigned long long) laneRandom(&random) * count >> 32);
+        chosen = pick;
+        if (!MOVE_IS_PASS(moves[0]))
+        {
+            chosen = -1;
+            for (slot = 0; slot < MAX_CARDS_PER_PLAYER && chosen < 0; slot++)
+            {
+                group = (state.hand[state.side][slot] * 2 + state.side) * MAX_CARD_SHIFTS;
+                for (entry = 0; entry < shifts->count && chosen < 0; entry++)
+                    for (i = 0; i < count && chosen < 0; i++)
+                        if (MOVE_CARD(moves[i]) == state.hand[state.side][slot] && shifts->origins[group + entry] != 0
+                            && MOVE_TO(moves[i]) - MOVE_FROM(moves[i]) == shifts->distance[group + entry])
+                        {
+                            if (pick == 0)
+                                chosen = i;
+                            pick--;
+                        }
+            }
+        }
+        historyPush(history, hash);
+        winner = makeMove(&state, moves[chosen], cards, keys, &hash, NULL, &undo);
+        (*plies)++;
+    }
+    return winner;
+}
+
+/*
+Starts simulated game number game in a lane of the batch
+
+Precondition:
+    - lane must be below SIM_BATCH
+    - batch->keys and batch->repetitions must be set
+
+@param batch The batch
+@param lane The lane to fill
+@param game Number of the game
+@param seed Seed of the whole simulation
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns no data type (void)
+*/
+void loadLane(gameBatch *batch, int lane, int game, unsigned long long seed, cardInfo cards[], int cardCount)
+{
+    gameState state;
+    int deal[MAX_CARD_PER_GAME];
+    int side;
+
+    simulatedDeal(seed, game, cardCount, deal, &batch->random[lane]);
+    initialState(deal, cards, &state);
+    side = state.side;
+
+    batch->game[lane] = game;
+    batch->side[lane] = side;
+    batch->plies[lane] = 0;
+    batch->winner[lane] = 0;
+    batch->own[lane] = state.pieces[side];
+    batch->other[lane] = state.pieces[!side];
+    batch->ownMaster[lane] = state.master[side];
+    batch->otherMaster[lane] = state.master[!side];
+    batch->ownHand[0][lane] = state.hand[side][0];
+    batch->ownHand[1][lane] = state.hand[side][1];
+    batch->otherHand[0][lane] = state.hand[!side][0];
+    batch->otherHand[1][lane] = state.hand[!side][1];
+    batch->neutral[lane] = state.neutral;
+    batch->hash[lane] = hashState(&state, &batch->keys);
+    batch->reversible[lane] = 0;
+    batch->seen[lane] = 0;
+    batch->repeated[lane] = batch->repetitions == 1; // the start is the first occurrence
+}
+
+/*
+Plays one random move in every lane of the batch. Each phase is a loop across lanes without
+branches, over struct-of-arrays columns, so the compiler can run it on whole SIMD registers:
+count the legal moves one shift of the pieces per card distance, draw one, find it, play it,
+check for a win, then turn the board over so the side to move is always in the own columns.
+Under a repetition rule the hash of each position is kept from the Zobrist keys of what the move
+changes, and the new position is counted among the earlier ones of its game.
+Lanes whose game has ended are stepped too and ignored by the caller
+
+Precondition:
+    - batch->shifts must come from buildMoveShifts on the cards of the batch
+    - batch->keys must have been filled by initZobrist
+
+@param batch The batch
+@return Returns no data type (void)
+*/
+void stepBatch(gameBatch *batch)
+{
+    const boardMask *origins = batch->shifts.origins;
+    const int *left = batch->shifts.left, *right = batch->shifts.right, *shift = batch->shifts.distance;
+    const unsigned long long *pieceKeys = &batch->keys.piece[0][0][0], *cardKeys = &batch->keys.card[0][0];
+    unsigned long long sideKey = batch->keys.sideToMove;
+    int entries = batch->shifts.count;
+    // scratch columns are locals so the compiler knows their stores never touch shifts
+    boardMask targets[SIM_BATCH];
+    int count[SIM_BATCH], pick[SIM_BATCH], found[SIM_BATCH], slot[SIM_BATCH], chosen[SIM_BATCH];
+    int origin[SIM_BATCH], destination[SIM_BATCH], taken[SIM_BATCH];
+    unsigned long long hash[SIM_BATCH];
+    boardMask own, moves, bit;
+    int lane, hand, entry, index, j, number, take, card, from, to, used, temple, captured, side, master, length;
+
+    for (lane = 0; lane < SIM_BATCH; lane++)
+        count[lane] = 0;
+
+    // legal moves per lane
+    for (hand = 0; hand < MAX_CARDS_PER_PLAYER; hand++)
+        for (entry = 0; entry < entries; entry++)
+            for (lane = 0; lane < SIM_BATCH; lane++)
+            {
+                own = batch->own[lane];
+                index = (batch->ownHand[hand][lane] * 2 + batch->side[lane]) * MAX_CARD_SHIFTS + entry;
+                moves = ((own & origins[index]) << left[index] >> right[index]) & ~own;
+                count[lane] += countSquares(moves);
+            }
+
+    // draw the move, two card swaps when there is none
+    for (lane = 0; lane < SIM_BATCH; lane++)
+    {
+        number = count[lane] > 0 ? count[lane] : MAX_CARDS_PER_PLAYER;
+        pick[lane] = (int) ((unsigned long long) laneRandom(&batch->random[lane]) * number >> 32);
+        found[lane] = 0;
+        slot[lane] = pick[lane] & 1;
+        chosen[lane] = 0;
+        targets[lane] = 0;
+    }
+
+    // find the drawn move: card slot, then distance, then origin square
+    for (hand = 0; hand < MAX_CARDS_PER_PLAYER; hand++)
+        for (entry = 0; entry < entries; entry++)
+            for (lane = 0; lane < SIM_BATCH; lane++)
+            {
+                own = batch->own[lane];
+                index = (batch->ownHand[hand][lane] * 2 + batch->side[lane]) * MAX_CARD_SHIFTS + entry;
+                moves = ((own & origins[index]) << left[index] >> right[index]) & ~own;
+                number = countSquares(moves);
+                take = (found[lane] == 0) & (pick[lane] < number);
+                pick[lane] -= number * ((found[lane] | take) == 0);
+                slot[lane] = take ? hand : slot[lane];
+                chosen[lane] = take ? index : chosen[lane];
+                targets[lane] = take ? moves : targets[lane];
+                found[lane] |= take;
+            }
+
+    // the drawn destination is the pick-th square of the found shift
+    for (j = 0; j < NUM_OF_STUD - 1; j++)
+        for (lane = 0; lane < SIM_BATCH; lane++)
+            targets[lane] = j < pick[lane] ? targets[lane] & (targets[lane] - 1) : targets[lane];
+    // a pass lane has no targets, its squares are pinned to 0 so no mask below shifts off the board
+    for (lane = 0; lane < SIM_BATCH; lane++)
+    {
+        destination[lane] = found[lane] ? countSquares((targets[lane] & (0 - targets[lane])) - 1) : 0;
+        origin[lane] = found[lane] ? destination[lane] - shift[chosen[lane]] : 0;
+    }
+
+    // hash the move before it is played: the moved piece, a taken piece, the two cards that change
+    // hands and the side to move; the key tables are indexed flat so the lookups become gathers
+    if (batch->repetitions > 0)
+    {
+        for (lane = 0; lane < SIM_BATCH; lane++)
+        {
+            to = destination[lane];
+            from = origin[lane];
+            side = batch->side[lane];
+            master = batch->ownMaster[lane] == from;
+            taken[lane] = found[lane] & (int) ((batch->other[lane] >> to) & 1);
+            card = slot[lane] ? batch->ownHand[1][lane] : batch->ownHand[0][lane];
+            used = batch->neutral[lane];
+            index = (side * 2 + master) * NUM_SQUARES;
+
+            hash[lane] = batch->hash[lane] ^ sideKey ^ cardKeys[card * 3 + side] ^ cardKeys[card * 3 + 2] ^
+                         cardKeys[used * 3 + 2] ^ cardKeys[used * 3 + side];
+            hash[lane] ^= (0 - (unsigned long long) found[lane]) & (pieceKeys[index + from] ^ pieceKeys[index + to]);
+            hash[lane] ^= (0 - (unsigned long long) taken[lane]) &
+                          pieceKeys[((1 - side) * 2 + (batch->otherMaster[lane] == to)) * NUM_SQUARES + to];
+        }
+    }
+
+    // play it and turn the board over
+    for (lane = 0; lane < SIM_BATCH; lane++)
+    {
+        to = destination[lane];
+        from = origin[lane];
+        bit = found[lane] ? SQUARE_BIT(from) | SQUARE_BIT(to) : 0;
+
+        captured = found[lane] & (batch->otherMaster[lane] == to);
+        own = batch->own[lane] ^ bit;
+        batch->own[lane] = batch->other[lane] & ~(bit & ~SQUARE_BIT(from));
+        batch->other[lane] = own;
+
+        temple = batch->side[lane] == 0 ? SQUARE_OF(0, COLS/2) : SQUARE_OF(ROWS-1, COLS/2);
+        from = found[lane] & (batch->ownMaster[lane] == from) ? to : batch->ownMaster[lane];
+        batch->winner[lane] = captured | (from == temple) ? batch->side[lane] + 1 : 0;
+        batch->ownMaster[lane] = captured ? -1 : batch->otherMaster[lane];
+        batch->otherMaster[lane] = from;
+
+        card = slot[lane] ? batch->ownHand[1][lane] : batch->ownHand[0][lane];
+        used = batch->neutral[lane];
+        batch->neutral[lane] = card;
+        card = slot[lane] ? batch->ownHand[0][lane] : batch->ownHand[1][lane];
+        batch->ownHand[0][lane] = batch->otherHand[0][lane];
+        batch->ownHand[1][lane] = batch->otherHand[1][lane];
+        batch->otherHand[0][lane] = slot[lane] ? card : used;
+        batch->otherHand[1][lane] = slot[lane] ? used : card;
+
+        batch->side[lane] ^= 1;
+        batch->plies[lane]++;
+    }
+
+    // a capture leaves fewer pieces, so no earlier position can come up again and the row starts
+    // over; the new position is then counted among those with the same side to move. Idle lanes wrap
+    if (batch->repetitions > 0)
+    {
+        for (lane = 0; lane < SIM_BATCH; lane++)
+        {
+            length = batch->reversible[lane] < MAX_MOVES ? batch->reversible[lane] : 0;
+            batch->history[lane][length] = batch->hash[lane];
+            batch->reversible[lane] = taken[lane] ? 0 : length + 1;
+            batch->seen[lane] = taken[lane] ? 0 : batch->seen[lane] | (1ULL << (batch->hash[lane] >> 58));
+            batch->hash[lane] = hash[lane];
+        }
+
+        for (lane = 0; lane < SIM_BATCH; lane++)
+        {
+            number = 0;
+            length = ((batch->seen[lane] >> (hash[lane] >> 58)) & 1) ? batch->reversible[lane] : 0;
+            for (j = length - 2; j >= 0; j -= 2)
+                number += batch->history[lane][j] == hash[lane];
+            batch->repeated[lane] = number + 1 >= batch->repetitions;
+        }
+    }
+}
+
+/*
+Simulation mode "-simulate <games>": plays random games to measure the rules kernel. Games
+are stepped SIM_BATCH at a time by stepBatch, or one by one by simulateGame with "-scalar";
+both play exactly the same games and print the same totals. A game ends with a win or, as a
+draw, under the draw rule of "-repetition <n>" and "-maxplies <n>" (see readDrawRule).
+Options: "-seed <n>", "-scalar"
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param games Number of games to play
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if the batch or the history could not be allocated
+*/
+int runSimulate(int games, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    gameBatch *batch = malloc(sizeof(gameBatch));
+    hashHistory *history = malloc(sizeof(hashHistory));
+    int scalar = hasFlag(argc, argv, "-scalar");
+    drawRule rule;
+    char *seedArg = argValue(argc, argv, "-seed");
+    unsigned long long seed = seedArg != NULL ? strtoull(seedArg, NULL, 10) : (unsigned long long) time(NULL);
+    unsigned long long started, plies = 0, micros;
+    unsigned long long wins[3] = {0, 0, 0};
+    int next = 0, running = 0;
+    int lane, length, winner;
+    int status = 1;
+
+    readDrawRule(argc, argv, &rule);
+    if (batch != NULL)
+    {
+        buildMoveShifts(cards, cardCount, &batch->shifts);
+        initZobrist(&batch->keys);
+        batch->repetitions = rule.repetitions;
+    }
+    started = microTime();
+
+    if (scalar && batch != NULL && history != NULL)
+    {
+        status = 0;
+        for (next = 0; next < games; next++)
+        {
+            winner = simulateGame(seed, next, &rule, cards, cardCount, &batch->shifts, &batch->keys, history,
+                                  &length);
+            wins[winner]++;
+            plies += length;
+        }
+    }
+    else if (!scalar && batch != NULL)
+    {
+        status = 0;
+        for (lane = 0; lane < SIM_BATCH; lane++)
+        {
+            loadLane(batch, lane, 0, seed, cards, cardCount);
+            batch->game[lane] = -1;
+            if (next < games)
+            {
+                loadLane(batch, lane, next++, seed, cards, cardCount);
+                running++;
+            }
+        }
+
+        while (running > 0)
+        {
+            // finished lanes take the next game, or go idle when there is none left; a game can be
+            // over before its first move when a single occurrence is a repetition
+            for (lane = 0; lane < SIM_BATCH; lane++)
+            {
+                while (batch->game[lane] >= 0 &&
+                       (batch->winner[lane] != 0 || batch->plies[lane] >= rule.maxPlies || batch->repeated[lane]))
+                {
+                    wins[batch->winner[lane]]++;
+                    plies += batch->plies[lane];
+                    batch->game[lane] = -1;
+                    running--;
+                    if (next < games)
+                    {
+                        loadLane(batch, lane, next++, seed, cards, cardCount);
+                        running++;
+                    }
+                }
+            }
+
+            if (running > 0)
+                stepBatch(batch);
+        }
+    }
+
+    if (status == 0)
+    {
+        micros = microTime() - started;
+        printf("games %d player 1 wins %llu player 2 wins %llu draws %llu average plies %.2f\n", games,
+               wins[1], wins[2], wins[0], games > 0 ? (double) plies / games : 0.0);
+        printf("%s kernel: %.1f ms, %.0f games/s, %.0f plies/s\n", scalar ? "scalar" : "batched",
+               micros / 1000.0, games * 1000000.0 / (micros > 0 ? micros : 1),
+               plies * 1000000.0 / (micros > 0 ? micros : 1));
+    }
+
+    free(batch);
+    free(history);
+    return status;
+}
+
+/*
+Converts a game's moves into their index in generateMoves order, which also checks that
+every move is legal. One byte per ply is the move column of the game database
+
+Precondition:
+    - record must hold a game read with readGameRecord
+    - ordinals must have room for record->length entries
+
+@param record The game to encode
+@param cards The card table
+@param ordinals Receives the move indexes
+@return Returns 1 if every move was legal, 0 otherwise
+*/
+int encodeGameMoves(const gameRecord *record, cardInfo cards[], unsigned char ordinals[])
+{
+    gameState state, next;
+    coreMove moves[MAX_CORE_MOVES];
+    int ply, count, i;
+    int ok = 1;
+
+    initialState(record->deal, cards, &state);
+
+    for (ply = 0; ok && ply < record->length; ply++)
+    {
+        count = generateMoves(&state, cards, moves);
+        for (i = 0; i < count && moves[i] != record->moves[ply]; i++)
+            ;
+        ok = i < count && coreWinner(&state) == 0;
+
+        if (ok)
+        {
+            ordinals[ply] = (unsigned char) i;
+            applyCoreMove(&state, moves[i], cards, &next);
+            state = next;
+        }
+    }
+    return ok;
+}
+
+/*
+Writes one column of the block being built, padded so the next column starts 8-byte aligned
+
+Precondition:
+    - writer->fp must be open for binary writing
+
+@param writer The database writer
+@param data Column contents
+@param bytes Size of the column in bytes
+@return Returns the file offset the column was written at
+*/
+unsigned long long dbWriteColumn(dbWriter *writer, const void *data, unsigned long long bytes)
+{
+    static const char padding[8] = {0};
+    unsigned long long start = writer->offset;
+    unsigned long long pad = (8 - (start + bytes) % 8) % 8;
+
+    fwrite(data, 1, bytes, writer->fp);
+    fwrite(padding, 1, pad, writer->fp);
+    writer->offset += bytes + pad;
+
+    return start;
+}
+
+/*
+Writes the columns of the block being filled and records it in the block directory
+
+Precondition:
+    - writer must have been set up by runDbBuild
+
+@param writer The database writer
+@return Returns no data type (void)
+*/
+void dbFlushBlock(dbWriter *writer)
+{
+    dbBlock *block;
+    int n = writer->count;
+    int slot;
+
+    if (n > 0)
+    {
+        if (writer->header.blockCount == (unsigned int) writer->blockCapacity)
+        {
+            writer->blockCapacity = writer->blockCapacity == 0 ? 64 : writer->blockCapacity * 2;
+            writer->blocks = realloc(writer->blocks, writer->blockCapacity * sizeof(dbBlock));
+        }
+        block = &writer->blocks[writer->header.blockCount++];
+
+        block->gameCount = n;
+        block->moveBytes = writer->moveIndex[n];
+        block->firstGame = writer->header.gameCount;
+        block->seedOffset = dbWriteColumn(writer, writer->seed, n * sizeof(unsigned long long));
+
+        // each deal slot is its own column so a filter on the neutral card reads only that one
+        block->dealOffset = writer->offset;
+        for (slot = 0; slot < MAX_CARD_PER_GAME - 1; slot++)
+        {
+            fwrite(writer->deal[slot], 1, n, writer->fp);
+            writer->offset += n;
+        }
+        dbWriteColumn(writer, writer->deal[MAX_CARD_PER_GAME - 1], n);
+
+        block->firstOffset = dbWriteColumn(writer, writer->first, n);
+        block->winnerOffset = dbWriteColumn(writer, writer->winner, n);
+        block->lengthOffset = dbWriteColumn(writer, writer->length, n * sizeof(unsigned short));
+        block->moveIndexOffset = dbWriteColumn(writer, writer->moveIndex, (n + 1) * sizeof(unsigned int));
+        block->movesOffset = dbWriteColumn(writer, writer->moves, block->moveBytes);
+
+        block->namesOffset = writer->offset;
+        fwrite(writer->names[0], sizeof(unsigned short), n, writer->fp);
+        writer->offset += n * sizeof(unsigned short);
+        dbWriteColumn(writer, writer->names[1], n * sizeof(unsigned short));
+        block->nameTableOffset = dbWriteColumn(writer, writer->nameTable, writer->nameCount * sizeof(str30));
+        block->nameCount = writer->nameCount;
+        block->spare = 0;
+
+        writer->header.gameCount += n;
+        writer->count = 0;
+        writer->moveIndex[0] = 0;
+        writer->nameCount = 0;
+        memset(writer->nameSlots, 0, sizeof(writer->nameSlots));
+    }
+}
+
+/*
+Finds a player name in the name table of the block being filled, adding it if it is new
+
+Precondition:
+    - writer must have been set up by runDbBuild
+    - name must be shorter than MAX_NAME_LEN + 1 characters
+
+@param writer The database writer
+@param name The player name
+@return Returns the name's index in the block's name table
+*/
+unsigned short dbNameId(dbWriter *writer, const char *name)
+{
+    unsigned int slot = nameHash(name) & (DB_NAME_SLOTS - 1);
+
+    while (writer->nameSlots[slot] != 0 && strcmp(writer->nameTable[writer->nameSlots[slot] - 1], name) != 0)
+        slot = (slot + 1) & (DB_NAME_SLOTS - 1);
+
+    if (writer->nameSlots[slot] == 0)
+    {
+        strcpy(writer->nameTable[writer->nameCount], name);
+        writer->nameSlots[slot] = (unsigned short) ++writer->nameCount;
+    }
+    return (unsigned short) (writer->nameSlots[slot] - 1);
+}
+
+/*
+Adds a game to the database being built, starting a new block every DB_BLOCK_GAMES games
+
+Precondition:
+    - writer must have been set up by runDbBuild
+    - ordinals must be the game's moves as encoded by encodeGameMoves
+
+@param writer The database writer
+@param record The game to add
+@param ordinals The game's moves as generateMoves indexes
+@param cards The card table
+@return Returns no data type (void)
+*/
+void dbAppendGame(dbWriter *writer, const gameRecord *record, const unsigned char ordinals[], cardInfo cards[])
+{
+    int n = writer->count;
+    int slot;
+
+    writer->seed[n] = record->seed;
+    for (slot = 0; slot < MAX_CARD_PER_GAME; slot++)
+        writer->deal[slot][n] = (unsigned char) record->deal[slot];
+    writer->first[n] = (unsigned char) cards[record->deal[4]].color;
+    writer->winner[n] = (unsigned char) record->winner;
+    writer->length[n] = (unsigned short) record->length;
+    memcpy(writer->moves + writer->moveIndex[n], ordinals, record->length);
+    writer->moveIndex[n + 1] = writer->moveIndex[n] + record->length;
+    writer->names[0][n] = dbNameId(writer, record->names[0]);
+    writer->names[1][n] = dbNameId(writer, record->names[1]);
+    writer->count++;
+
+    if (writer->count == DB_BLOCK_GAMES)
+        dbFlushBlock(writer);
+}
+
+/*
+Worker thread of a database build: parses chunks of the mapped input and checks every move,
+leaving each chunk's legal games in a slot for the writer to append in file order
+
+Precondition:
+    - param must point to a running convertJob over a mapped text file
+
+@param param The convertJob shared by all workers
+@return Returns 0 when every chunk has been parsed
+*/
+DWORD WINAPI importWorker(LPVOID param)
+{
+    convertJob *job = (convertJob *) param;
+    convertSlot *slot;
+    const char *cursor, *end;
+    int item, read;
+
+    while ((item = InterlockedIncrement(&job->nextItem) - 1) < job->itemCount)
+    {
+        slot = &job->slots[item % job->slotCount];
+
+        EnterCriticalSection(&job->lock);
+        while (item >= job->written + job->slotCount) // the slot still holds an item the writer has not taken
+            SleepConditionVariableCS(&job->changed, &job->lock, INFINITE);
+        LeaveCriticalSection(&job->lock);
+
+        slot->count = 0;
+        slot->skipped = 0;
+        cursor = job->text + job->bounds[item];
+        end = job->text + job->bounds[item + 1];
+
+        do
+        {
+            if (slot->count == slot->capacity)
+            {
+                slot->capacity = slot->capacity > 0 ? 2 * slot->capacity : 256;
+                slot->games = realloc(slot->games, slot->capacity * sizeof(gameRecord));
+                slot->ordinals = realloc(slot->ordinals, slot->capacity * sizeof(*slot->ordinals));
+            }
+
+            read = parseGameText(&cursor, end, job->cards, job->cardCount, &slot->games[slot->count]);
+            if (read < 0)
+            {
+                slot->skipped++;
+                cursor = nextGameStart(cursor, end);
+            }
+            else if (read > 0 && encodeGameMoves(&slot->games[slot->count], job->cards, slot->ordinals[slot->count]))
+                slot->count++;
+            else if (read > 0)
+                slot->skipped++;
+        } while (read != 0);
+
+        EnterCriticalSection(&job->lock);
+        slot->item = item;
+        WakeAllConditionVariable(&job->changed);
+        LeaveCriticalSection(&job->lock);
+    }
+    return 0;
+}
+
+/*
+Memory-maps a whole file for reading
+
+Precondition: None
+
+@param filename File to map
+@param file Receives the file handle, INVALID_HANDLE_VALUE if it could not be opened
+@param mapping Receives the mapping handle, NULL for an empty file
+@param size Receives the size of the file in bytes
+@return Returns the mapped contents, or NULL if the file could not be opened or is empty
+*/
+const char *mapTextFile(const char *filename, HANDLE *file, HANDLE *mapping, unsigned long long *size)
+{
+    LARGE_INTEGER length;
+    const char *base = NULL;
+
+    length.QuadPart = 0;
+    *mapping = NULL;
+    *file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (*file != INVALID_HANDLE_VALUE && GetFileSizeEx(*file, &length) && length.QuadPart > 0)
+    {
+        *mapping = CreateFileMappingA(*file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (*mapping != NULL)
+            base = MapViewOfFile(*mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    *size = (unsigned long long) length.QuadPart;
+    return base;
+}
+
+/*
+Converts one mapped GameLog.txt style file into games of the database being built. Workers
+parse and check chunks of CONVERT_CHUNK bytes in parallel while this thread appends them in
+file order, so the database holds the games in the order of the text
+
+Precondition:
+    - job must have been set up by runDbBuild with its slots empty
+    - text must hold size bytes
+
+@param job The conversion job
+@param text The file contents
+@param size Size of the file in bytes
+@param nWorkers Number of worker threads
+@param writer The database writer
+@return Returns the number of games skipped as malformed or illegal
+*/
+unsigned long long importText(convertJob *job, const char *text, unsigned long long size, int nWorkers,
+                              dbWriter *writer)
+{
+    HANDLE workers[MAX_THREADS];
+    convertSlot *slot;
+    unsigned long long skipped = 0;
+    int i, item;
+
+    job->itemCount = (int) ((size + CONVERT_CHUNK - 1) / CONVERT_CHUNK);
+    job->bounds = malloc((job->itemCount + 1) * sizeof(unsigned long long));
+    job->bounds[0] = 0;
+    for (item = 1; item < job->itemCount; item++)
+        job->bounds[item] = nextGameStart(text + (unsigned long long) item * CONVERT_CHUNK - 1, text + size) - text;
+    job->bounds[job->itemCount] = size;
+
+    job->text = text;
+    job->nextItem = 0;
+    job->written = 0;
+    for (i = 0; i < job->slotCount; i++)
+        job->slots[i].item = -1;
+
+    for (i = 0; i < nWorkers; i++)
+        workers[i] = CreateThread(NULL, 0, importWorker, job, 0, NULL);
+
+    for (item = 0; item < job->itemCount; item++)
+    {
+        slot = &job->slots[item % job->slotCount];
+
+        EnterCriticalSection(&job->lock);
+        while (slot->item != item)
+            SleepConditionVariableCS(&job->changed, &job->lock, INFINITE);
+        LeaveCriticalSection(&job->lock);
+
+        for (i = 0; i < slot->count; i++)
+            dbAppendGame(writer, &slot->games[i], slot->ordinals[i], job->cards);
+        skipped += slot->skipped;
+
+        EnterCriticalSection(&job->lock);
+        job->written = item + 1;
+        WakeAllConditionVariable(&job->changed);
+        LeaveCriticalSection(&job->lock);
+    }
+
+    WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+    for (i = 0; i < nWorkers; i++)
+        CloseHandle(workers[i]);
+    free(job->bounds);
+    return skipped;
+}
+
+/*
+Database build mode "-db-build <out.db> <games.txt>... [-threads n]": ingests GameLog.txt files
+and self-play output into a columnar game database. Each input is memory-mapped and parsed on
+every core; malformed games and games with illegal moves are skipped
+
+Precondition:
+    - inputs must hold inputCount file names
+    - argv must hold argc arguments
+    - cards must hold cardCount loaded cards
+
+@param filename Database file to create
+@param inputs GameLog.txt style files to read
+@param inputCount Number of input files
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if a file could not be opened
+*/
+int runDbBuild(const char *filename, char *inputs[], int inputCount, int argc, char *argv[],
+               cardInfo cards[], int cardCount)
+{
+    dbWriter *writer = calloc(1, sizeof(dbWriter));
+    convertJob job;
+    HANDLE file, mapping;
+    const char *text;
+    unsigned long long skipped = 0, bytes = 0, size;
+    unsigned long long started = microTime();
+    int nWorkers = threadCount(argc, argv);
+    int i;
+    int status = 0;
+
+    writer->fp = fopen(filename, "wb");
+    if (writer->fp == NULL)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        status = 1;
+    }
+    else
+    {
+        memcpy(writer->header.magic, DB_MAGIC, sizeof(writer->header.magic));
+        writer->header.version = DB_VERSION;
+        writer->header.boardSize = BOARD_SIZE;
+        writer->header.cardCount = cardCount;
+        for (i = 0; i < cardCount; i++)
+            strcpy(writer->header.cardNames[i], cards[i].name);
+
+        dbWriteColumn(writer, &writer->header, sizeof(dbHeader)); // rewritten once complete
+
+        memset(&job, 0, sizeof(job));
+        job.cards = cards;
+        job.cardCount = cardCount;
+        job.slotCount = 2 * nWorkers;
+        job.slots = calloc(job.slotCount, sizeof(convertSlot));
+        InitializeCriticalSection(&job.lock);
+        InitializeConditionVariable(&job.changed);
+
+        for (i = 0; i < inputCount; i++)
+        {
+            text = mapTextFile(inputs[i], &file, &mapping, &size);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                printf("Error: Cannot open file %s\n", inputs[i]);
+                status = 1;
+            }
+            else
+            {
+                if (text != NULL)
+                {
+                    skipped += importText(&job, text, size, nWorkers, writer);
+                    bytes += size;
+                    UnmapViewOfFile(text);
+                }
+                if (mapping != NULL)
+                    CloseHandle(mapping);
+                CloseHandle(file);
+            }
+        }
+        dbFlushBlock(writer);
+
+        writer->header.directoryOffset = dbWriteColumn(writer, writer->blocks,
+                                                       writer->header.blockCount * sizeof(dbBlock));
+        fseek(writer->fp, 0, SEEK_SET);
+        fwrite(&writer->header, sizeof(dbHeader), 1, writer->fp);
+        fclose(writer->fp);
+
+        for (i = 0; i < job.slotCount; i++)
+        {
+            free(job.slots[i].games);
+            free(job.slots[i].ordinals);
+        }
+        free(job.slots);
+        DeleteCriticalSection(&job.lock);
+
+        printf("%llu games in %u blocks, %llu skipped, %.1f MB/s\n", writer->header.gameCount,
+               writer->header.blockCount, skipped, bytes / (double) (microTime() - started + 1));
+    }
+
+    free(writer->blocks);
+    free(writer);
+    return status;
+}
+
+/*
+Memory-maps a game database for querying
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param filename Database file to open
+@param cards The card table
+@param cardCount Number of cards in the table
+@param db Receives the mapped database
+@return Returns 1 if the database was opened, 0 otherwise
+*/
+int openGameDb(const char *filename, cardInfo cards[], int cardCount, gameDb *db)
+{
+    LARGE_INTEGER size;
+    unsigned int i;
+    int ok = 0;
+
+    size.QuadPart = 0;
+    db->mapping = NULL;
+    db->base = NULL;
+    db->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (db->file != INVALID_HANDLE_VALUE && GetFileSizeEx(db->file, &size) && size.QuadPart >= (LONGLONG) sizeof(dbHeader))
+    {
+        db->mapping = CreateFileMappingA(db->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (db->mapping != NULL)
+            db->base = MapViewOfFile(db->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    if (db->base != NULL)
+    {
+        db->header = (const dbHeader *) db->base;
+        db->blocks = (const dbBlock *) (db->base + db->header->directoryOffset);
+        ok = memcmp(db->header->magic, DB_MAGIC, sizeof(db->header->magic)) == 0 &&
+             db->header->version == DB_VERSION && db->header->boardSize == BOARD_SIZE &&
+             db->header->cardCount <= MAX_CARDS &&
+             db->header->directoryOffset + db->header->blockCount * sizeof(dbBlock) <= (unsigned long long) size.QuadPart;
+
+        for (i = 0; ok && i < db->header->cardCount; i++)
+        {
+            db->cardMap[i] = findCardId(cards, cardCount, db->header->cardNames[i]);
+            ok = db->cardMap[i] >= 0;
+        }
+    }
+
+    if (!ok)
+        printf("Error: %s is not a readable game database\n", filename);
+    return ok;
+}
+
+/*
+Unmaps a game database
+
+Precondition:
+    - db must have been opened with openGameDb
+
+@param db The database to close
+@return Returns no data type (void)
+*/
+void closeGameDb(gameDb *db)
+{
+    if (db->base != NULL)
+        UnmapViewOfFile(db->base);
+    if (db->mapping != NULL)
+        CloseHandle(db->mapping);
+    if (db->file != INVALID_HANDLE_VALUE)
+        CloseHandle(db->file);
+}
+
+/*
+Decodes one stored game back into its deal and moves
+
+Precondition:
+    - db must have been opened with openGameDb
+    - index must be < block->gameCount
+    - moves must have room for MAX_MOVES entries
+
+@param db The database
+@param block The block holding the game
+@param index Position of the game inside the block
+@param cards The card table
+@param deal Receives the deal as card table ids
+@param moves Receives the moves
+@return Returns the number of plies, or -1 if the stored moves do not replay
+*/
+int decodeDbGame(const gameDb *db, const dbBlock *block, int index, cardInfo cards[], int deal[], coreMove moves[])
+{
+    const unsigned int *moveIndex = (const unsigned int *) (db->base + block->moveIndexOffset);
+    const unsigned char *ordinals = db->base + block->movesOffset + moveIndex[index];
+    int length = moveIndex[index + 1] - moveIndex[index];
+    coreMove legal[MAX_CORE_MOVES];
+    gameState state, next;
+    int slot, ply, count;
+
+    for (slot = 0; slot < MAX_CARD_PER_GAME; slot++)
+        deal[slot] = db->cardMap[db->base[block->dealOffset + slot * block->gameCount + index]];
+    initialState(deal, cards, &state);
+
+    for (ply = 0; ply < length && length >= 0; ply++)
+    {
+        count = generateMoves(&state, cards, legal);
+        if (ordinals[ply] >= count)
+            length = -1;
+        else
+        {
+            moves[ply] = legal[ordinals[ply]];
+            applyCoreMove(&state, moves[ply], cards, &next);
+            state = next;
+        }
+    }
+    return length;
+}
+
+/*
+Worker thread of a database query: scans whole blocks, touching only the columns the query needs
+
+Precondition:
+    - param must point to a running dbQueryJob
+
+@param param The dbQueryJob shared by all workers
+@return Returns 0 when every block has been scanned
+*/
+DWORD WINAPI dbQueryWorker(LPVOID param)
+{
+    dbQueryJob *job = (dbQueryJob *) param;
+    const gameDb *db = job->db;
+    const dbBlock *block;
+    const unsigned char *deal, *first, *winner;
+    const unsigned short *length;
+    unsigned long long games = 0, firstWins = 0;
+    unsigned long long (*setLength)[2];
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    int b, i, n, match, cardSet;
+
+    while ((b = InterlockedIncrement(&job->nextBlock) - 1) < (int) db->header->blockCount)
+    {
+        block = &db->blocks[b];
+        n = block->gameCount;
+        deal = db->base + block->dealOffset;
+        first = db->base + block->firstOffset;
+        winner = db->base + block->winnerOffset;
+        length = (const unsigned short *) (db->base + block->lengthOffset);
+
+        if (job->setLength == NULL)
+        {
+            // branch-free so the compiler can vectorize across games
+            for (i = 0; i < n; i++)
+            {
+                match = (job->neutralCard < 0) | (deal[4 * n + i] == job->neutralCard);
+                games += match;
+                firstWins += match & (winner[i] == first[i] + 1);
+            }
+        }
+        else
+        {
+            setLength = job->setLength + ((unsigned long long) thread << MAX_CARDS);
+            for (i = 0; i < n; i++)
+            {
+                cardSet = (1 << deal[i]) | (1 << deal[n + i]) | (1 << deal[2 * n + i]) |
+                          (1 << deal[3 * n + i]) | (1 << deal[4 * n + i]);
+                setLength[cardSet][0] += length[i];
+                setLength[cardSet][1]++;
+            }
+        }
+    }
+
+    job->games[thread] = games;
+    job->firstWins[thread] = firstWins;
+    return 0;
+}
+
+/*
+Database query mode "-db-query <db> firstwin [Card]" or "-db-query <db> avglength".
+firstwin reports how often the first player won, optionally only when Card was the neutral
+card; avglength reports the average game length of every five-card set
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param filename Database file to query
+@param query "firstwin" or "avglength"
+@param cardName Neutral card filter for firstwin, or NULL
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 on a bad database or query
+*/
+int runDbQuery(const char *filename, const char *query, const char *cardName, int argc, char *argv[],
+               cardInfo cards[], int cardCount)
+{
+    dbQueryJob job;
+    gameDb db;
+    HANDLE workers[MAX_THREADS];
+    int nWorkers = threadCount(argc, argv);
+    unsigned long long games = 0, firstWins = 0, plies, count;
+    int i, t, card, cardSet;
+    int status = 1;
+
+    if (openGameDb(filename, cards, cardCount, &db))
+    {
+        memset(&job, 0, sizeof(job));
+        job.db = &db;
+        job.neutralCard = -1;
+        status = 0;
+
+        if (strcmp(query, "avglength") == 0)
+            job.setLength = calloc((unsigned long long) nWorkers << MAX_CARDS, sizeof(*job.setLength));
+        else if (strcmp(query, "firstwin") != 0)
+            status = 1;
+
+        for (i = 0; cardName != NULL && i < (int) db.header->cardCount; i++)
+        {
+            if (strcmp(db.header->cardNames[i], cardName) == 0)
+                job.neutralCard = i;
+        }
+        if (cardName != NULL && job.neutralCard < 0)
+            status = 1;
+
+        if (status == 0)
+        {
+            for (i = 0; i < nWorkers; i++)
+                workers[i] = CreateThread(NULL, 0, dbQueryWorker, &job, 0, NULL);
+            WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+            for (i = 0; i < nWorkers; i++)
+                CloseHandle(workers[i]);
+
+            if (job.setLength == NULL)
+            {
+                for (t = 0; t < nWorkers; t++)
+                {
+                    games += job.games[t];
+                    firstWins += job.firstWins[t];
+                }
+                printf("games %llu first player wins %llu (%.2f%%)\n", games, firstWins,
+                       games > 0 ? 100.0 * firstWins / games : 0.0);
+            }
+            else
+            {
+                for (cardSet = 0; cardSet < (1 << MAX_CARDS); cardSet++)
+                {
+                    plies = count = 0;
+                    for (t = 0; t < nWorkers; t++)
+                    {
+                        plies += job.setLength[((unsigned long long) t << MAX_CARDS) + cardSet][0];
+                        count += job.setLength[((unsigned long long) t << MAX_CARDS) + cardSet][1];
+                    }
+
+                    if (count > 0)
+                    {
+                        for (card = 0; card < MAX_CARDS; card++)
+                        {
+                            if (cardSet & (1 << card))
+                                printf("%s ", db.header->cardNames[card]);
+                        }
+                        printf(": games %llu average length %.2f\n", count, (double) plies / count);
+                    }
+                }
+            }
+        }
+        else
+            printf("Error: unknown query\n");
+
+        free(job.setLength);
+        closeGameDb(&db);
+    }
+    return status;
+}
+
+/*
+Worker thread of a database export: decodes whole blocks, replaying every game so a corrupt
+move column is caught, and formats them as GameLog.txt text in a slot for the writer
+
+Precondition:
+    - param must point to a running convertJob over an opened database
+
+@param param The convertJob shared by all workers
+@return Returns 0 when every block has been formatted
+*/
+DWORD WINAPI exportWorker(LPVOID param)
+{
+    convertJob *job = (convertJob *) param;
+    const gameDb *db = job->db;
+    const dbBlock *block;
+    const unsigned long long *seed;
+    const unsigned char *winner;
+    const unsigned short *names;
+    const str30 *nameTable;
+    convertSlot *slot;
+    gameRecord record;
+    int item, i;
+
+    while ((item = InterlockedIncrement(&job->nextItem) - 1) < job->itemCount)
+    {
+        slot = &job->slots[item % job->slotCount];
+
+        EnterCriticalSection(&job->lock);
+        while (item >= job->written + job->slotCount) // the slot still holds an item the writer has not taken
+            SleepConditionVariableCS(&job->changed, &job->lock, INFINITE);
+        LeaveCriticalSection(&job->lock);
+
+        block = &db->blocks[item];
+        seed = (const unsigned long long *) (db->base + block->seedOffset);
+        winner = db->base + block->winnerOffset;
+        names = (const unsigned short *) (db->base + block->namesOffset);
+        nameTable = (const str30 *) (db->base + block->nameTableOffset);
+        slot->length = 0;
+        slot->skipped = 0;
+
+        for (i = 0; i < (int) block->gameCount; i++)
+        {
+            if (slot->textCapacity - slot->length < MAX_RECORD_TEXT)
+            {
+                slot->textCapacity = 2 * slot->textCapacity + MAX_RECORD_TEXT;
+                slot->text = realloc(slot->text, slot->textCapacity);
+            }
+
+            record.length = decodeDbGame(db, block, i, job->cards, record.deal, record.moves);
+            if (record.length < 0 || names[i] >= block->nameCount || names[block->gameCount + i] >= block->nameCount)
+                slot->skipped++;
+            else
+            {
+                record.seed = seed[i];
+                record.winner = winner[i];
+                strcpy(record.names[0], nameTable[names[i]]);
+                strcpy(record.names[1], nameTable[names[block->gameCount + i]]);
+                slot->length += formatGameRecord(&record, job->cards, slot->text + slot->length);
+            }
+        }
+
+        EnterCriticalSection(&job->lock);
+        slot->item = item;
+        WakeAllConditionVariable(&job->changed);
+        LeaveCriticalSection(&job->lock);
+    }
+    return 0;
+}
+
+/*
+Database export mode "-db-export <db> <out.txt> [-threads n]": writes every game of a database
+back out in the GameLog.txt format, in database order. Workers format blocks in parallel while
+this thread writes them out in order
+
+Precondition:
+    - argv must hold argc arguments
+    - cards must hold cardCount loaded cards
+
+@param filename Database file to read
+@param output Text file to create
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if a file could not be opened
+*/
+int runDbExport(const char *filename, const char *output, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    convertJob job;
+    gameDb db;
+    HANDLE workers[MAX_THREADS];
+    convertSlot *slot;
+    FILE *out;
+    unsigned long long skipped = 0, bytes = 0;
+    unsigned long long started = microTime();
+    int nWorkers = threadCount(argc, argv);
+    int i, item;
+    int status = 1;
+
+    if (openGameDb(filename, cards, cardCount, &db))
+    {
+        out = fopen(output, "wb");
+        if (out == NULL)
+            printf("Error: Cannot open file %s\n", output);
+        else
+        {
+            memset(&job, 0, sizeof(job));
+            job.cards = cards;
+            job.cardCount = cardCount;
+            job.db = &db;
+            job.itemCount = (int) db.header->blockCount;
+            job.slotCount = 2 * nWorkers;
+            job.slots = calloc(job.slotCount, sizeof(convertSlot));
+            for (i = 0; i < job.slotCount; i++)
+                job.slots[i].item = -1;
+            InitializeCriticalSection(&job.lock);
+            InitializeConditionVariable(&job.changed);
+
+            for (i = 0; i < nWorkers; i++)
+                workers[i] = CreateThread(NULL, 0, exportWorker, &job, 0, NULL);
+
+            for (item = 0; item < job.itemCount; item++)
+            {
+                slot = &job.slots[item % job.slotCount];
+
+                EnterCriticalSection(&job.lock);
+                while (slot->item != item)
+                    SleepConditionVariableCS(&job.changed, &job.lock, INFINITE);
+                LeaveCriticalSection(&job.lock);
+
+                fwrite(slot->text, 1, slot->length, out);
+                bytes += slot->length;
+                skipped += slot->skipped;
+
+                EnterCriticalSection(&job.lock);
+                job.written = item + 1;
+                WakeAllConditionVariable(&job.changed);
+                LeaveCriticalSection(&job.lock);
+            }
+
+            WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+            for (i = 0; i < nWorkers; i++)
+            {
+                CloseHandle(workers[i]);
+                free(job.slots[i].text);
+                free(job.slots[nWorkers + i].text);
+            }
+            free(job.slots);
+            DeleteCriticalSection(&job.lock);
+            fclose(out);
+
+            printf("%llu games exported, %llu skipped, %.1f MB/s\n", db.header->gameCount - skipped, skipped,
+                   bytes / (double) (microTime() - started + 1));
+            status = 0;
+        }
+        closeGameDb(&db);
+    }
+    return status;
+}
+
+/*
+Adds up what a range of games tells about each player for a rating period: the score above the
+expected score, and how much information the games carry, E * (1 - E) per game. Every game is
+judged from the ratings the players had when the period began
+
+Precondition:
+    - delta and information must have one value per player of table
+
+@param table The rating table, left unchanged
+@param games The games
+@param first First game of the range
+@param last One past the last game of the range
+@param delta Receives the sum of each player's score minus expected score
+@param information Receives the sum of each player's E * (1 - E)
+@return Returns no data type (void)
+*/
+void ratePeriodGames(const ratingTable *table, const ratingGame *games, int first, int last, double *delta,
+                     double *information)
+{
+    const ratingGame *game;
+    double expected;
+    int i;
+
+    for (i = first; i < last; i++)
+    {
+        game = &games[i];
+        expected = expectedScore(table->entries[game->players[0]].rating, table->entries[game->players[1]].rating);
+        delta[game->players[0]] += game->score / 2.0 - expected;
+        delta[game->players[1]] -= game->score / 2.0 - expected;
+        information[game->players[0]] += expected * (1.0 - expected);
+        information[game->players[1]] += expected * (1.0 - expected);
+    }
+}
+
+/*
+Returns the rating change of a player over a period, a Glicko-style update with a fixed rating
+deviation: the score above expectation divided by the information of the player's games. A
+player with one even game moves RATING_K / 2 as a sequential update would; with many games the
+step approaches the one that makes the period's results expected, so it does not grow with the
+number of games the way summed Elo updates do
+
+Precondition: None
+
+@param delta The player's score minus expected score over the period
+@param information The player's sum of E * (1 - E) over the period
+@return Returns the rating change
+*/
+double periodChange(double delta, double information)
+{
+    return delta / (1.0 / RATING_K - RATING_SLOPE / 4.0 + RATING_SLOPE * information);
+}
+
+/*
+Worker thread of a ratings recompute: parses its byte range of the results text, cutting the
+names out in place. Blank lines and '#' comments are skipped, other lines that are not
+"<name> <name> <0|1|2>" are counted as bad
+
+Precondition:
+    - param must point to a ratingJob whose bounds end just after a newline or at the end of text
+
+@param param The ratingJob shared by all workers
+@return Returns 0 when the range has been parsed
+*/
+DWORD WINAPI ratingParseWorker(LPVOID param)
+{
+    ratingJob *job = (ratingJob *) param;
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    char *p = job->text + job->bounds[thread];
+    char *end = job->text + job->bounds[thread + 1];
+    char *lineEnd;
+    char *token[4];
+    ratingLine *grown;
+    int capacity = 0;
+    int count;
+
+    job->lines[thread] = NULL;
+    job->lineCount[thread] = 0;
+    job->badLines[thread] = 0;
+
+    while (p < end)
+    {
+        lineEnd = memchr(p, '\n', end - p);
+        if (lineEnd == NULL)
+            lineEnd = end;
+        *lineEnd = '\0';
+
+        count = 0;
+        while (p < lineEnd && count < 4)
+        {
+            while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+                p++;
+            if (p < lineEnd)
+            {
+                token[count++] = p;
+                while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+                    p++;
+                *p = '\0';
+                p++;
+            }
+        }
+
+        if (count > 0 && token[0][0] != '#')
+        {
+            if (job->lineCount[thread] >= capacity)
+            {
+                capacity = capacity > 0 ? capacity * 2 : 1024;
+                grown = realloc(job->lines[thread], capacity * sizeof(ratingLine));
+                if (grown != NULL)
+                    job->lines[thread] = grown;
+                else
+                    capacity = job->lineCount[thread];
+            }
+
+            if (count == 3 && strlen(token[0]) < MAX_NAME_LEN && strlen(token[1]) < MAX_NAME_LEN &&
+                token[2][0] >= '0' && token[2][0] <= '2' && token[2][1] == '\0' && job->lineCount[thread] < capacity)
+            {
+                job->lines[thread][job->lineCount[thread]].names[0] = token[0];
+                job->lines[thread][job->lineCount[thread]].names[1] = token[1];
+                job->lines[thread][job->lineCount[thread]].score = token[2][0] == '1' ? 2 : (token[2][0] == '2' ? 0 : 1);
+                job->lineCount[thread]++;
+            }
+            else
+                job->badLines[thread]++;
+        }
+        p = lineEnd + 1;
+    }
+    return 0;
+}
+
+/*
+Worker thread of a ratings recompute: rates chunks of RATING_CHUNK games of the current period
+into the worker's own rows of job->delta and job->information
+
+Precondition:
+    - param must point to a ratingJob set up for a period
+
+@param param The ratingJob shared by all workers
+@return Returns 0 when every chunk of the period has been rated
+*/
+DWORD WINAPI ratingPeriodWorker(LPVOID param)
+{
+    ratingJob *job = (ratingJob *) param;
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    double *delta = job->delta + (size_t) thread * job->table->count;
+    double *information = job->information + (size_t) thread * job->table->count;
+    int chunk, first, last;
+
+    while ((chunk = InterlockedIncrement(&job->nextChunk) - 1) < (job->count + RATING_CHUNK - 1) / RATING_CHUNK)
+    {
+        first = job->first + chunk * RATING_CHUNK;
+        last = first + RATING_CHUNK < job->first + job->count ? first + RATING_CHUNK : job->first + job->count;
+        ratePeriodGames(job->table, job->games, first, last, delta, information);
+    }
+    return 0;
+}
+
+/*
+Worker thread of a ratings recompute: rates whole components of players one game after
+another, in file order. No game links two components, so each one is rated exactly as the
+sequential history would rate it and workers never touch the same player
+
+Precondition:
+    - param must point to a ratingJob whose components were built by buildRatingComponents
+
+@param param The ratingJob shared by all workers
+@return Returns 0 when every component has been rated
+*/
+DWORD WINAPI ratingComponentWorker(LPVOID param)
+{
+    ratingJob *job = (ratingJob *) param;
+    ratingEntry *entries = job->table->entries;
+    const ratingGame *game;
+    double change;
+    int component, i;
+
+    while ((component = InterlockedIncrement(&job->nextComponent) - 1) < job->componentCount)
+    {
+        for (i = job->componentStart[component]; i < job->componentStart[component + 1]; i++)
+        {
+            // the same update as rateGame, without counting the result again
+            game = &job->games[job->order[i]];
+            change = RATING_K * (game->score / 2.0 - expectedScore(entries[game->players[0]].rating,
+                                                                   entries[game->players[1]].rating));
+            entries[game->players[0]].rating += change;
+            entries[game->players[1]].rating -= change;
+        }
+    }
+    return 0;
+}
+
+/*
+Splits the players into components that never meet, through a union-find over the games, and
+groups the games by component keeping their file order, for ratingComponentWorker
+
+Precondition:
+    - games must hold gameCount games between players of table
+
+@param table The rating table
+@param games The games
+@param gameCount Number of games
+@param job Receives order, componentStart and componentCount
+@return Returns 1 on success, 0 if memory ran out
+*/
+int buildRatingComponents(const ratingTable *table, const ratingGame *games, int gameCount, ratingJob *job)
+{
+    int *parent = malloc((table->count + 1) * sizeof(int));
+    int *component = malloc((table->count + 1) * sizeof(int));
+    int a, b, i, p;
+    int ok = parent != NULL && component != NULL;
+
+    job->order = ok ? malloc((gameCount + 1) * sizeof(int)) : NULL;
+    job->componentStart = ok ? calloc(table->count + 2, sizeof(int)) : NULL;
+    job->componentCount = 0;
+    ok = ok && job->order != NULL && job->componentStart != NULL;
+
+    for (p = 0; ok && p < table->count; p++)
+    {
+        parent[p] = p;
+        component[p] = -1;
+    }
+
+    for (i = 0; ok && i < gameCount; i++)
+    {
+        for (a = games[i].players[0]; parent[a] != a; a = parent[a])
+            parent[a] = parent[parent[a]]; // path halving
+        for (b = games[i].players[1]; parent[b] != b; b = parent[b])
+            parent[b] = parent[parent[b]];
+        parent[a] = b;
+    }
+
+    // number the components in the order their first game appears, then count their games
+    for (i = 0; ok && i < gameCount; i++)
+    {
+        for (a = games[i].players[0]; parent[a] != a; a = parent[a])
+            ;
+        if (component[a] < 0)
+            component[a] = job->componentCount++;
+        job->componentStart[component[a] + 1]++;
+    }
+    for (i = 0; ok && i < job->componentCount; i++)
+        job->componentStart[i + 1] += job->componentStart[i];
+
+    for (i = 0; ok && i < gameCount; i++)
+    {
+        for (a = games[i].players[0]; parent[a] != a; a = parent[a])
+            ;
+        job->order[job->componentStart[component[a]]++] = i;
+    }
+    // placing the games moved every start to the next component's start
+    for (i = job->componentCount; ok && i > 0; i--)
+        job->componentStart[i] = job->componentStart[i - 1];
+    if (ok)
+        job->componentStart[0] = 0;
+
+    free(parent);
+    free(component);
+    return ok;
+}
+
+/*
+Rates the whole history one game after another, which reproduces the live table exactly. The
+components of players that never meet are rated in parallel
+
+Precondition:
+    - job->games must hold gameCount games between players of job->table
+
+@param job The ratings job
+@param gameCount Number of games
+@param nWorkers Most worker threads to use
+@return Returns 1 on success, 0 if memory ran out
+*/
+int rateSequential(ratingJob *job, int gameCount, int nWorkers)
+{
+    HANDLE workers[MAX_THREADS];
+    int ok = buildRatingComponents(job->table, job->games, gameCount, job);
+    int used = job->componentCount < nWorkers ? job->componentCount : nWorkers;
+    int t;
+
+    if (gameCount < RATING_PARALLEL)
+        used = 1;
+    job->nextComponent = 0;
+
+    if (ok && used > 1)
+    {
+        for (t = 0; t < used; t++)
+            workers[t] = CreateThread(NULL, 0, ratingComponentWorker, job, 0, NULL);
+        WaitForMultipleObjects(used, workers, TRUE, INFINITE);
+        for (t = 0; t < used; t++)
+            CloseHandle(workers[t]);
+    }
+    else if (ok)
+        ratingComponentWorker(job);
+
+    free(job->order);
+    free(job->componentStart);
+    job->order = NULL;
+    job->componentStart = NULL;
+    return ok;
+}
+
+/*
+Adds one game to the list being rated, unless a player is playing themself
+
+Precondition:
+    - games must have room for one more game
+
+@param table The rating table the names are entered in
+@param name1 Player 1's name
+@param name2 Player 2's name
+@param score Player 1's result in half points: 2 win, 1 draw, 0 loss
+@param games The games read so far
+@param gameCount Number of games, increased when the game is kept
+@return Returns 1 if the game was kept, 0 if it was skipped
+*/
+int addRatedGame(ratingTable *table, const char *name1, const char *name2, int score, ratingGame *games,
+                 int *gameCount)
+{
+    int a, b;
+    int kept = 0;
+
+    if (strcmp(name1, name2) != 0)
+    {
+        a = ratingPlayer(table, name1);
+        b = ratingPlayer(table, name2);
+        kept = a >= 0 && b >= 0;
+        if (kept)
+        {
+            games[*gameCount].players[0] = a;
+            games[*gameCount].players[1] = b;
+            games[*gameCount].score = score;
+            (*gameCount)++;
+            countResult(&table->entries[a], &table->entries[b], score);
+        }
+    }
+    return kept;
+}
+
+/*
+Ratings mode "-ratings <file>": recomputes every rating from the full history of results and
+writes the table. The file holds "<name> <name> <winner>" lines as playGame appends them to
+Results.txt, or games in the GameLog.txt format. Results files are parsed on all cores.
+By default games are rated one after another, which gives exactly the live table; players who
+never meet, directly or through others, are rated in parallel. "-period <games>" rates games in
+rating periods instead, in parallel: within a period every game is judged from the ratings the
+players had when it began, and each player moves once by periodChange. The range of these
+ratings is printed beside the range of the sequential ones as a check.
+Options: "-threads <n>", "-out <file>" (default Ratings.txt)
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param filename The history of results
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table, for GameLog.txt style files
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if the file could not be read or the ratings written
+*/
+int runRatings(const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    ratingJob job;
+    ratingTable table;
+    ratingGame *games = NULL;
+    gameRecord *record = NULL;
+    HANDLE workers[MAX_THREADS];
+    FILE *fp = fopen(filename, "rb");
+    char *periodArg = argValue(argc, argv, "-period");
+    char *outArg = argValue(argc, argv, "-out");
+    int period = periodArg != NULL ? atoi(periodArg) : 1;
+    int nWorkers = threadCount(argc, argv);
+    int used, lines = 0, gameCount = 0, badLines = 0, skipped = 0;
+    int first, i, t, k, player;
+    int read = 1;
+    long size = -1;
+    double *sequential = NULL;
+    double delta, information, difference;
+    double low[2], high[2];
+    unsigned long long started = microTime(), parsed;
+    int status = 1;
+
+    memset(&job, 0, sizeof(job));
+    ratingTableInit(&table);
+    job.table = &table;
+    if (period < 1)
+        period = 1;
+
+    if (fp != NULL && fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0)
+        job.text = malloc(size + 1);
+    if (job.text != NULL && fread(job.text, 1, size, fp) == (size_t) size)
+    {
+        job.text[size] = '\0';
+        for (i = 0; job.text[i] == ' ' || job.text[i] == '\r' || job.text[i] == '\n'; i++)
+            ;
+
+        if (strncmp(job.text + i, "Seed", 4) == 0)
+        {
+            // a game log takes many lines per game and is read on one thread
+            rewind(fp);
+            record = malloc(sizeof(gameRecord));
+            games = malloc((size / 32 + 1) * sizeof(ratingGame));
+            while (games != NULL && record != NULL && (read = readGameRecord(fp, cards, cardCount, record)) > 0)
+            {
+                lines++;
+                if (!addRatedGame(&table, record->names[0], record->names[1],
+                                  record->winner == 1 ? 2 : (record->winner == 2 ? 0 : 1), games, &gameCount))
+                    skipped++;
+            }
+            badLines = read < 0;
+        }
+        else
+        {
+            // every worker parses a slice that starts and ends on a line boundary
+            for (t = 0; t <= nWorkers; t++)
+            {
+                job.bounds[t] = (long) ((double) size * t / nWorkers);
+                while (job.bounds[t] > 0 && t < nWorkers && job.bounds[t] < size && job.text[job.bounds[t] - 1] != '\n')
+                    job.bounds[t]++;
+            }
+            for (t = 0; t < nWorkers; t++)
+                workers[t] = CreateThread(NULL, 0, ratingParseWorker, &job, 0, NULL);
+            WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+            for (t = 0; t < nWorkers; t++)
+            {
+                CloseHandle(workers[t]);
+                lines += job.lineCount[t];
+                badLines += job.badLines[t];
+            }
+
+            // names are entered in file order, so players keep the order they first played in
+            games = malloc((lines + 1) * sizeof(ratingGame));
+            for (t = 0; t < nWorkers && games != NULL; t++)
+            {
+                for (i = 0; i < job.lineCount[t]; i++)
+                {
+                    if (!addRatedGame(&table, job.lines[t][i].names[0], job.lines[t][i].names[1],
+                                      job.lines[t][i].score, games, &gameCount))
+                        skipped++;
+                }
+            }
+        }
+        status = games == NULL;
+    }
+    else
+        printf("Error: Cannot read file %s\n", filename);
+    parsed = microTime();
+
+    if (status == 0)
+    {
+        job.games = games;
+        status = !rateSequential(&job, gameCount, nWorkers);
+    }
+
+    if (status == 0 && period > 1)
+    {
+        // the sequential ratings are kept to check that the periods stay in the same range
+        sequential = malloc((table.count + 1) * sizeof(double));
+        job.delta = calloc((size_t) nWorkers * table.count + 1, sizeof(double));
+        job.information = calloc((size_t) nWorkers * table.count + 1, sizeof(double));
+        status = sequential == NULL || job.delta == NULL || job.information == NULL;
+        for (player = 0; status == 0 && player < table.count; player++)
+        {
+            sequential[player] = table.entries[player].rating;
+            table.entries[player].rating = RATING_START;
+        }
+    }
+
+    for (first = 0; status == 0 && period > 1 && first < gameCount; first += period)
+    {
+        job.first = first;
+        job.count = gameCount - first < period ? gameCount - first : period;
+        used = job.count >= RATING_PARALLEL ? nWorkers : 1;
+        if (used > 1)
+        {
+            job.nextThread = 0;
+            job.nextChunk = 0;
+            for (t = 0; t < used; t++)
+                workers[t] = CreateThread(NULL, 0, ratingPeriodWorker, &job, 0, NULL);
+            WaitForMultipleObjects(used, workers, TRUE, INFINITE);
+            for (t = 0; t < used; t++)
+                CloseHandle(workers[t]);
+        }
+        else
+            ratePeriodGames(&table, games, first, first + job.count, job.delta, job.information);
+
+        // only the players of this period have sums, which are cleared as they are applied
+        for (i = first; i < first + job.count; i++)
+        {
+            for (k = 0; k < 2; k++)
+            {
+                player = games[i].players[k];
+                delta = information = 0.0;
+                for (t = 0; t < used; t++)
+                {
+                    delta += job.delta[(size_t) t * table.count + player];
+                    information += job.information[(size_t) t * table.count + player];
+                    job.delta[(size_t) t * table.count + player] = 0.0;
+                    job.information[(size_t) t * table.count + player] = 0.0;
+                }
+                table.entries[player].rating += periodChange(delta, information);
+            }
+        }
+    }
+
+    if (status == 0)
+    {
+        printf("games %d players %d skipped %d bad %d period %d\n", gameCount, table.count, skipped, badLines, period);
+        printf("read %.1f ms rated %.1f ms\n", (parsed - started) / 1000.0, (microTime() - parsed) / 1000.0);
+        if (sequential != NULL && table.count > 0)
+        {
+            low[0] = high[0] = sequential[0];
+            low[1] = high[1] = table.entries[0].rating;
+            difference = 0.0;
+            for (player = 0; player < table.count; player++)
+            {
+                low[0] = sequential[player] < low[0] ? sequential[player] : low[0];
+                high[0] = sequential[player] > high[0] ? sequential[player] : high[0];
+                low[1] = table.entries[player].rating < low[1] ? table.entries[player].rating : low[1];
+                high[1] = table.entries[player].rating > high[1] ? table.entries[player].rating : high[1];
+                difference += fabs(table.entries[player].rating - sequential[player]);
+            }
+            printf("ratings %.0f to %.0f, one game at a time %.0f to %.0f, mean difference %.1f\n",
+                   low[1], high[1], low[0], high[0], difference / table.count);
+        }
+        if (!saveRatings(&table, outArg != NULL ? outArg : "Ratings.txt"))
+        {
+            printf("Error: Cannot write file %s\n", outArg != NULL ? outArg : "Ratings.txt");
+            status = 1;
+        }
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+    for (t = 0; t < nWorkers; t++)
+        free(job.lines[t]);
+    free(job.text);
+    free(job.delta);
+    free(job.information);
+    free(sequential);
+    free(games);
+    free(record);
+    ratingTableFree(&table);
+    return status;
+}
+
+/*
+Orders index entries by hash, then game, then ply (qsort callback)
+
+Precondition:
+    - a and b must point to indexEntry values
+
+@param a First entry
+@param b Second entry
+@return Returns a negative, zero or positive value like strcmp
+*/
+int compareIndexEntries(const void *a, const void *b)
+{
+    const indexEntry *x = (const indexEntry *) a;
+    const indexEntry *y = (const indexEntry *) b;
+    int result = 0;
+
+    if (x->hash != y->hash)
+        result = x->hash < y->hash ? -1 : 1;
+    else if (x->game != y->game)
+        result = x->game < y->game ? -1 : 1;
+    else if (x->ply != y->ply)
+        result = x->ply < y->ply ? -1 : 1;
+
+    return result;
+}
+
+/*
+Worker thread of the index build: replays whole database blocks, emits one entry per
+position reached, then sorts its own run
+
+Precondition:
+    - param must point to a running indexBuildJob
+
+@param param The indexBuildJob shared by all workers
+@return Returns 0 when every block has been replayed
+*/
+DWORD WINAPI indexBuildWorker(LPVOID param)
+{
+    indexBuildJob *job = (indexBuildJob *) param;
+    const gameDb *db = job->db;
+    const dbBlock *block;
+    const unsigned char *winner;
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    indexEntry *run = NULL;
+    unsigned long long count = 0, capacity = 0;
+    coreMove moves[MAX_MOVES];
+    gameState state, next;
+    int deal[MAX_CARD_PER_GAME];
+    int b, i, ply, length;
+
+    while ((b = InterlockedIncrement(&job->nextBlock) - 1) < (int) db->header->blockCount)
+    {
+        block = &db->blocks[b];
+        winner = db->base + block->winnerOffset;
+
+        for (i = 0; i < (int) block->gameCount; i++)
+        {
+            length = decodeDbGame(db, block, i, job->cards, deal, moves);
+            if (count + length + 1 > capacity)
+            {
+                capacity = capacity * 2 + MAX_MOVES + 1;
+                run = realloc(run, capacity * sizeof(indexEntry));
+            }
+
+            initialState(deal, job->cards, &state);
+            for (ply = 0; ply <= length; ply++)
+            {
+                run[count].hash = hashState(&state, job->keys);
+                run[count].game = (unsigned int) (block->firstGame + i);
+                run[count].ply = (unsigned short) ply;
+                run[count].winner = winner[i];
+                run[count].spare = 0;
+                count++;
+
+                if (ply < length)
+                {
+                    applyCoreMove(&state, moves[ply], job->cards, &next);
+                    state = next;
+                }
+            }
+        }
+    }
+
+    if (count > 0)
+        qsort(run, count, sizeof(indexEntry), compareIndexEntries);
+    job->runs[thread] = run;
+    job->runLength[thread] = count;
+    return 0;
+}
+
+/*
+Index build mode "-index-build <games.db> <out.idx>": indexes every position of every stored
+game by its hash. Workers replay and sort blocks in parallel, then their runs are merged
+into one sorted file
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param dbName Game database to index
+@param filename Index file to create
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if a file could not be opened
+*/
+int runIndexBuild(const char *dbName, const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    indexBuildJob job;
+    indexHeader header;
+    gameDb db;
+    zobristKeys keys;
+    HANDLE workers[MAX_THREADS];
+    indexEntry buffer[INDEX_WRITE_BUFFER];
+    unsigned long long pos[MAX_THREADS] = {0};
+    int nWorkers = threadCount(argc, argv);
+    int buffered = 0;
+    int i, t, best;
+    int status = 1;
+    FILE *fp;
+
+    if (openGameDb(dbName, cards, cardCount, &db))
+    {
+        fp = fopen(filename, "wb");
+        if (fp == NULL)
+            printf("Error: Cannot open file %s\n", filename);
+        else
+        {
+            initZobrist(&keys);
+            memset(&job, 0, sizeof(job));
+            job.db = &db;
+            job.cards = cards;
+            job.keys = &keys;
+
+            for (i = 0; i < nWorkers; i++)
+                workers[i] = CreateThread(NULL, 0, indexBuildWorker, &job, 0, NULL);
+            WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+            for (i = 0; i < nWorkers; i++)
+                CloseHandle(workers[i]);
+
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+            header.version = INDEX_VERSION;
+            header.boardSize = BOARD_SIZE;
+            header.gameCount = db.header->gameCount;
+            for (t = 0; t < nWorkers; t++)
+                header.entryCount += job.runLength[t];
+            fwrite(&header, sizeof(header), 1, fp);
+
+            // k-way merge of the sorted runs, k is at most the number of threads
+            do
+            {
+                best = -1;
+                for (t = 0; t < nWorkers; t++)
+                {
+                    if (pos[t] < job.runLength[t] &&
+                        (best < 0 || compareIndexEntries(&job.runs[t][pos[t]], &job.runs[best][pos[best]]) < 0))
+                        best = t;
+                }
+
+                if (best >= 0)
+                    buffer[buffered++] = job.runs[best][pos[best]++];
+                if (buffered == INDEX_WRITE_BUFFER || (best < 0 && buffered > 0))
+                {
+                    fwrite(buffer, sizeof(indexEntry), buffered, fp);
+                    buffered = 0;
+                }
+            } while (best >= 0);
+
+            fclose(fp);
+            for (t = 0; t < nWorkers; t++)
+                free(job.runs[t]);
+
+            printf("%llu positions from %llu games\n", header.entryCount, header.gameCount);
+            status = 0;
+        }
+        closeGameDb(&db);
+    }
+    return status;
+}
+
+/*
+Finds the first index entry of a hash with a binary search over the mapped entries
+
+Precondition:
+    - entries must be sorted by compareIndexEntries
+
+@param entries The index entries
+@param count Number of entries
+@param hash The position hash to look for
+@return Returns the position of the first entry with that hash, or count if there is none
+*/
+unsigned long long findIndexEntry(const indexEntry *entries, unsigned long long count, unsigned long long hash)
+{
+    unsigned long long low = 0, high = count, mid;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        if (entries[mid].hash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low < count && entries[low].hash == hash ? low : count;
+}
+
+/*
+Index query mode "-index-query <index.idx> <position>": lists the stored games that reached a
+position and how they ended. Only the pages of the memory-mapped index the binary search
+touches are read
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param filename Index file to query
+@param position Position notation as written by formatPosition
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 on a bad index or position
+*/
+int runIndexQuery(const char *filename, const char *position, cardInfo cards[], int cardCount)
+{
+    HANDLE file, mapping = NULL;
+    const unsigned char *base = NULL;
+    const indexHeader *header;
+    const indexEntry *entries;
+    LARGE_INTEGER size;
+    zobristKeys keys;
+    gameState state;
+    unsigned long long hash, first, i;
+    unsigned long long wins[3] = {0};
+    unsigned int lastGame = 0;
+    int games = 0;
+    int status = 1;
+
+    size.QuadPart = 0;
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG) sizeof(indexHeader))
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+            base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    header = (const indexHeader *) base;
+    if (base == NULL || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != INDEX_VERSION || header->boardSize != BOARD_SIZE ||
+        sizeof(indexHeader) + header->entryCount * sizeof(indexEntry) > (unsigned long long) size.QuadPart)
+        printf("Error: %s is not a readable position index\n", filename);
+
+    else if (!parsePosition(position, cards, cardCount, &state))
+        printf("Error: invalid position\n");
+
+    else
+    {
+        status = 0;
+        initZobrist(&keys);
+        entries = (const indexEntry *) (base + sizeof(indexHeader));
+        hash = hashState(&state, &keys);
+        first = findIndexEntry(entries, header->entryCount, hash);
+
+        for (i = first; i < header->entryCount && entries[i].hash == hash; i++)
+        {
+            if (i == first || entries[i].game != lastGame)
+            {
+                games++;
+                wins[entries[i].winner <= 2 ? entries[i].winner : 0]++;
+                if (games <= INDEX_LIST_LIMIT)
+                    printf("game %u ply %u winner %u\n", entries[i].game, entries[i].ply, entries[i].winner);
+            }
+            lastGame = entries[i].game;
+        }
+
+        printf("reached in %d of %llu games: Player 1 won %llu, Player 2 won %llu, unfinished %llu\n",
+               games, header->gameCount, wins[1], wins[2], wins[0]);
+    }
+
+    if (base != NULL)
+        UnmapViewOfFile(base);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    return status;
+}
+
+/*
+Worker thread of the sample extraction: replays whole database blocks and emits the features
+of every position before each move with the game's result for the side to move
+
+Precondition:
+    - param must point to a running tuneExtractJob
+
+@param param The tuneExtractJob shared by all workers
+@return Returns 0 when every block has been replayed
+*/
+DWORD WINAPI tuneExtractWorker(LPVOID param)
+{
+    tuneExtractJob *job = (tuneExtractJob *) param;
+    const gameDb *db = job->db;
+    const dbBlock *block;
+    const unsigned char *winner;
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    evalSample *run = NULL;
+    unsigned long long count = 0, capacity = 0;
+    coreMove moves[MAX_MOVES];
+    gameState state, next;
+    int deal[MAX_CARD_PER_GAME];
+    int features[EVAL_FEATURES];
+    int b, i, f, ply, length;
+
+    while ((b = InterlockedIncrement(&job->nextBlock) - 1) < (int) db->header->blockCount)
+    {
+        block = &db->blocks[b];
+        winner = db->base + block->winnerOffset;
+
+        for (i = 0; i < (int) block->gameCount; i++)
+        {
+            length = decodeDbGame(db, block, i, job->cards, deal, moves);
+            if (count + length > capacity)
+            {
+                capacity = capacity * 2 + MAX_MOVES;
+                run = realloc(run, capacity * sizeof(evalSample));
+            }
+
+            initialState(deal, job->cards, &state);
+            for (ply = 0; ply < length && coreWinner(&state) == 0; ply++)
+            {
+                evalFeatures(&state, job->cards, features);
+                for (f = 0; f < EVAL_FEATURES; f++)
+                    run[count].feature[f] = (short) features[f];
+                // 2 when the side to move went on to win, 1 for a game cut off undecided
+                run[count].result = winner[i] == 0 ? 1 : (winner[i] == state.side + 1) * 2;
+                run[count].spare = 0;
+                count++;
+
+                applyCoreMove(&state, moves[ply], job->cards, &next);
+                state = next;
+            }
+        }
+    }
+
+    job->runs[thread] = run;
+    job->runLength[thread] = count;
+    return 0;
+}
+
+/*
+Tuning sample mode "-tune-extract <games.db> <samples.bin>": writes the evaluation features
+and final result of every position of every stored game, the input of "-tune".
+Options: "-threads <n>"
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param dbName Game database to read
+@param filename Sample file to create
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if a file could not be opened
+*/
+int runTuneExtract(const char *dbName, const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    tuneExtractJob job;
+    sampleHeader header;
+    gameDb db;
+    HANDLE workers[MAX_THREADS];
+    int nWorkers = threadCount(argc, argv);
+    int i, t;
+    int status = 1;
+    FILE *fp;
+
+    if (openGameDb(dbName, cards, cardCount, &db))
+    {
+        fp = fopen(filename, "wb");
+        if (fp == NULL)
+            printf("Error: Cannot open file %s\n", filename);
+        else
+        {
+            memset(&job, 0, sizeof(job));
+            job.db = &db;
+            job.cards = cards;
+
+            for (i = 0; i < nWorkers; i++)
+                workers[i] = CreateThread(NULL, 0, tuneExtractWorker, &job, 0, NULL);
+            WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+            for (i = 0; i < nWorkers; i++)
+                CloseHandle(workers[i]);
+
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, SAMPLE_MAGIC, sizeof(header.magic));
+            header.version = SAMPLE_VERSION;
+            header.featureCount = EVAL_FEATURES;
+            for (t = 0; t < nWorkers; t++)
+                header.sampleCount += job.runLength[t];
+            fwrite(&header, sizeof(header), 1, fp);
+            for (t = 0; t < nWorkers; t++)
+            {
+                if (job.runLength[t] > 0)
+                    fwrite(job.runs[t], sizeof(evalSample), job.runLength[t], fp);
+                free(job.runs[t]);
+            }
+            fclose(fp);
+
+            printf("%llu positions from %llu games\n", header.sampleCount, db.header->gameCount);
+            status = 0;
+        }
+        closeGameDb(&db);
+    }
+    return status;
+}
+
+/*
+Worker thread of one tuning pass: takes chunks of samples until none are left and sums the
+squared error of the predicted results and its gradient over the weights
+
+Precondition:
+    - param must point to a tuneJob whose counters were reset for this pass
+
+@param param The tuneJob shared by all workers
+@return Returns 0 when every chunk has been processed
+*/
+DWORD WINAPI tuneWorker(LPVOID param)
+{
+    tuneJob *job = (tuneJob *) param;
+    const evalSample *sample;
+    double gradient[EVAL_FEATURES] = {0};
+    double loss = 0, score, predicted, error, slope;
+    int thread = InterlockedIncrement(&job->nextThread) - 1;
+    unsigned long long first, last, i;
+    int f;
+
+    while ((first = (unsigned long long) (InterlockedIncrement(&job->nextChunk) - 1) * TUNE_CHUNK) < job->count)
+    {
+        last = first + TUNE_CHUNK < job->count ? first + TUNE_CHUNK : job->count;
+        for (i = first; i < last; i++)
+        {
+            sample = &job->samples[i];
+            score = 0;
+            for (f = 0; f < EVAL_FEATURES; f++)
+                score += job->weight[f] * sample->feature[f];
+
+            // expected result 1 / (1 + 10^(-K score / 400)), the Texel tuning logistic
+            predicted = 1.0 / (1.0 + exp(-job->scale * score));
+            error = predicted - sample->result / 2.0;
+            loss += error * error;
+            slope = error * predicted * (1.0 - predicted) * job->scale;
+            for (f = 0; f < EVAL_FEATURES; f++)
+                gradient[f] += slope * sample->feature[f];
+        }
+    }
+
+    job->loss[thread] = loss;
+    memcpy(job->gradient[thread], gradient, sizeof(gradient));
+    return 0;
+}
+
+/*
+Runs one pass of the tuning workers over every sample with the job's current weights
+
+Precondition:
+    - job must hold the samples, weights and scale of the pass
+
+@param job The tuning job
+@param nWorkers Number of threads to use, clamped to 1..MAX_THREADS
+@param gradient Receives the mean gradient of the error per weight
+@return Returns the mean squared error of the predicted results
+*/
+double tunePass(tuneJob *job, int nWorkers, double gradient[])
+{
+    HANDLE workers[MAX_THREADS];
+    double loss = 0;
+    int i, f;
+
+    // threadCount already bounds the count, clamped again so the workers array is always filled
+    if (nWorkers < 1)
+        nWorkers = 1;
+    if (nWorkers > MAX_THREADS)
+        nWorkers = MAX_THREADS;
+
+    job->nextChunk = 0;
+    job->nextThread = 0;
+    for (i = 0; i < nWorkers; i++)
+        workers[i] = CreateThread(NULL, 0, tuneWorker, job, 0, NULL);
+    WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+    for (i = 0; i < nWorkers; i++)
+        CloseHandle(workers[i]);
+
+    for (f = 0; f < EVAL_FEATURES; f++)
+        gradient[f] = 0;
+    for (i = 0; i < nWorkers; i++)
+    {
+        loss += job->loss[i];
+        for (f = 0; f < EVAL_FEATURES; f++)
+            gradient[f] += job->gradient[i][f] / job->count;
+    }
+    return loss / job->count;
+}
+
+/*
+Tuning mode "-tune <samples.bin>": fits the evaluation weights to game results with
+Texel-style logistic regression. The sample file is memory-mapped and every pass is spread
+over all cores. Unless "-k" is given, the scale K of the logistic is first fitted to the
+starting weights, then the weights follow full-batch Adam steps.
+Options: "-epochs <n>", "-rate <r>" (weight units per step), "-k <K>", "-threads <n>",
+"-out <file>" (default EVAL_FILE); the starting weights come from EVAL_FILE
+
+Precondition: None
+
+@param filename Sample file written by "-tune-extract"
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns 0 on success, 1 if the samples could not be read or the weights written
+*/
+int runTune(const char *filename, int argc, char *argv[])
+{
+    HANDLE file, mapping = NULL;
+    const unsigned char *base = NULL;
+    const sampleHeader *header;
+    LARGE_INTEGER size;
+    tuneJob job;
+    evalWeights weights;
+    double gradient[EVAL_FEATURES];
+    double moment[EVAL_FEATURES] = {0}, energy[EVAL_FEATURES] = {0};
+    double low = TUNE_K_MIN, high = TUNE_K_MAX, lowLoss, highLoss, loss = 0;
+    char *epochArg = argValue(argc, argv, "-epochs");
+    char *rateArg = argValue(argc, argv, "-rate");
+    char *kArg = argValue(argc, argv, "-k");
+    char *outArg = argValue(argc, argv, "-out");
+    int epochs = epochArg != NULL ? atoi(epochArg) : TUNE_EPOCHS;
+    double rate = rateArg != NULL ? atof(rateArg) : TUNE_RATE;
+    double k = kArg != NULL ? atof(kArg) : 1.0;
+    int nWorkers = threadCount(argc, argv);
+    unsigned long long started = microTime();
+    int epoch, f, i;
+    int status = 1;
+
+    size.QuadPart = 0;
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG) sizeof(sampleHeader))
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+            base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    header = (const sampleHeader *) base;
+    if (base == NULL || memcmp(header->magic, SAMPLE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SAMPLE_VERSION || header->featureCount != EVAL_FEATURES || header->sampleCount == 0 ||
+        sizeof(sampleHeader) + header->sampleCount * sizeof(evalSample) > (unsigned long long) size.QuadPart)
+        printf("Error: %s is not a readable sample file\n", filename);
+
+    else
+    {
+        memset(&job, 0, sizeof(job));
+        job.samples = (const evalSample *) (base + sizeof(sampleHeader));
+        job.count = header->sampleCount;
+        loadEvalWeights(EVAL_FILE, &weights);
+        for (f = 0; f < EVAL_FEATURES; f++)
+            job.weight[f] = weights.weight[f];
+
+        // the loss is unimodal in K: narrow [low, high] by golden-section search
+        for (i = 0; kArg == NULL && i < TUNE_K_STEPS; i++)
+        {
+            job.scale = (high - 0.382 * (high - low)) * log(10.0) / 400.0;
+            lowLoss = tunePass(&job, nWorkers, gradient);
+            job.scale = (low + 0.382 * (high - low)) * log(10.0) / 400.0;
+            highLoss = tunePass(&job, nWorkers, gradient);
+            if (lowLoss < highLoss)
+                low = low + 0.382 * (high - low);
+            else
+                high = high - 0.382 * (high - low);
+            k = (low + high) / 2;
+        }
+        job.scale = k * log(10.0) / 400.0;
+        printf("%llu samples, K %.3f, start loss %.6f\n", job.count, k, tunePass(&job, nWorkers, gradient));
+
+        for (epoch = 1; epoch <= epochs; epoch++)
+        {
+            loss = tunePass(&job, nWorkers, gradient);
+            for (f = 0; f < EVAL_FEATURES; f++)
+            {
+                moment[f] = 0.9 * moment[f] + 0.1 * gradient[f];
+                energy[f] = 0.999 * energy[f] + 0.001 * gradient[f] * gradient[f];
+                job.weight[f] -= rate * (moment[f] / (1 - pow(0.9, epoch))) /
+                                 (sqrt(energy[f] / (1 - pow(0.999, epoch))) + 1e-12);
+            }
+            if (epoch % TUNE_REPORT == 0 || epoch == epochs)
+                printf("epoch %d loss %.6f\n", epoch, loss);
+        }
+
+        for (f = 0; f < EVAL_FEATURES; f++)
+        {
+            weights.weight[f] = (int) floor(job.weight[f] + 0.5);
+            printf("%s %d\n", evalFeatureName(f), weights.weight[f]);
+        }
+        if (saveEvalWeights(outArg != NULL ? outArg : EVAL_FILE, &weights, filename))
+            status = 0;
+        else
+            printf("Error: Cannot write file %s\n", outArg != NULL ? outArg : EVAL_FILE);
+        printf("%d epochs in %.1f s\n", epochs, (microTime() - started) / 1000000.0);
+    }
 
-    if (fp != NULL) 
+    if (base != NULL)
+        UnmapViewOfFile(base);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    return status;
+}
+
+/*
+Solves one position with proof-number search. The side to move is tried as the attacker
+first; if its win is disproven the opponent is tried next. Prints the result, the winning
+line and the size of the search
+
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param position Position notation as written by formatPosition
+@param argc Number of command line arguments
+@param argv Command line arguments, "-nodes" sizes the pool and "-time" limits each attempt (ms)
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 when the position was solved, 1 on a bad position or an unresolved search
+*/
+int runSolve(const char *position, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    pnSolver solver;
+    zobristKeys keys;
+    gameState state;
+    char *nodesArg = argValue(argc, argv, "-nodes");
+    char *timeArg = argValue(argc, argv, "-time");
+    char moveText[MAX_NAME_LEN + 16];
+    int timeMs = timeArg != NULL ? atoi(timeArg) : 0;
+    int attacker, result, index;
+    int status = 1;
+
+    initZobrist(&keys);
+    solver.cards = cards;
+    solver.keys = &keys;
+    solver.capacity = nodesArg != NULL ? atoi(nodesArg) : DEFAULT_SOLVE_NODES;
+    if (solver.capacity < 1)
+        solver.capacity = DEFAULT_SOLVE_NODES;
+    solver.nodes = malloc((size_t) solver.capacity * sizeof(pnNode));
+
+    if (!parsePosition(position, cards, cardCount, &state) || coreWinner(&state) != 0)
+        printf("Error: invalid or finished position\n");
+
+    else if (solver.nodes == NULL)
+        printf("Error: cannot allocate %d solver nodes\n", solver.capacity);
+
+    else
     {
-    while (count < MAX_LEAD_LINES / 2 &&
-           fscanf(fp, "%s", leaders[count].name) == 1 &&
-           fscanf(fp, "%d", &leaders[count].turns) == 1)
+        attacker = state.side;
+        solver.deadline = counterDeadline((long long) timeMs * 1000);
+        result = pnSolve(&solver, &state, attacker);
+        printf("Player %d to move: %s after %llu expansions, peak %d of %d nodes\n", attacker + 1,
+               result == 1 ? "forced win" : (result == 0 ? "no forced win" : "unresolved"),
+               solver.expansions, solver.peak, solver.capacity);
+
+        if (result == 0)
         {
-            count++;
+            attacker = !state.side;
+            solver.deadline = counterDeadline((long long) timeMs * 1000);
+            result = pnSolve(&solver, &state, attacker);
+            printf("Player %d to reply: %s after %llu expansions, peak %d of %d nodes\n", attacker + 1,
+                   result == 1 ? "forced win" : (result == 0 ? "no forced win, the position is a draw" : "unresolved"),
+                   solver.expansions, solver.peak, solver.capacity);
         }
-        fclose(fp);
+
+        if (result == 1)
+        {
+            printf("Player %d wins in %d plies:", attacker + 1, solver.nodes[solver.root].distance);
+            for (index = solver.nodes[solver.root].child; index != -1; index = solver.nodes[index].child)
+            {
+                formatMove(solver.nodes[index].move, cards, moveText);
+                printf(" %s%s", moveText, solver.nodes[index].child != -1 ? "," : "");
+            }
+            printf("\n");
+        }
+        status = result < 0;
     }
 
-    /* 2. Add new winner */
-    if (count < MAX_LEAD_LINES/2 + 1) 
+    free(solver.nodes);
+    return status;
+}
+
+/*
+Verifies a puzzle exhaustively: the side to move wins in exactly plies (no faster win
+exists) and only one first move achieves it
+
+Precondition:
+    - state must be a valid position that is not already won
+    - plies must be odd
+
+@param state The candidate position
+@param cards The card table
+@param plies Length of the win in plies
+@param solution Receives the only winning first move
+@return Returns 1 if the position is a puzzle, 0 otherwise
+*/
+int verifyPuzzle(const gameState *state, cardInfo cards[], int plies, coreMove *solution)
+{
+    coreMove moves[MAX_CORE_MOVES];
+    gameState child;
+    int count, i;
+    int winners = 0;
+
+    if (!forcedWin(state, cards, state->side, plies - 2))
     {
-        strcpy(leaders[count].name, winner.name);
-        leaders[count].turns = winner.turns;
-        count++;
+        count = generateMoves(state, cards, moves);
+        for (i = 0; i < count && winners < 2; i++)
+        {
+            applyCoreMove(state, moves[i], cards, &child);
+            if (forcedWin(&child, cards, state->side, plies - 1))
+            {
+                winners++;
+                *solution = moves[i];
+            }
+        }
     }
+    return winners == 1;
+}
 
-    // Sort by turns 
-    for (i = 0; i < count - 1; i++) 
+/*
+Looks up a puzzle's canonical key among the accepted ones, optionally adding it
+
+Precondition:
+    - job->lock must be held
+    - fewer than half of the seen slots may be in use
+
+@param job The puzzle job
+@param key Canonical hash of the position
+@param insert 1 to add the key when it is new
+@return Returns 1 if the key was already accepted, 0 otherwise
+*/
+int puzzleSeen(puzzleJob *job, unsigned long long key, int insert)
+{
+    unsigned long long slot;
+    int found;
+
+    key |= 1; // 0 marks an empty slot
+    slot = key & job->seenMask;
+    while (job->seen[slot] != 0 && job->seen[slot] != key)
+        slot = (slot + 1) & job->seenMask;
+
+    found = job->seen[slot] == key;
+    if (insert && !found)
+        job->seen[slot] = key;
+    return found;
+}
+
+/*
+Worker thread of the puzzle generator. Simulates games from the shared game counter; every
+position is screened with a short search, which also picks the simulated move, and the few
+positions that show a win in exactly the target length are verified exhaustively
+
+Precondition:
+    - param must point to a running puzzleJob
+
+@param param The puzzleJob shared by all workers
+@return Returns 0 once enough puzzles were found or the game limit is reached
+*/
+DWORD WINAPI puzzleWorker(LPVOID param)
+{
+    puzzleJob *job = (puzzleJob *) param;
+    searchContext ctx;
+    searchResult result;
+    gameState state;
+    undoRecord undo;
+    rngState rng;
+    coreMove moves[MAX_CORE_MOVES];
+    coreMove solution, move;
+    int deal[MAX_CARD_PER_GAME];
+    char position[MAX_POSITION_LEN];
+    char moveText[MAX_NAME_LEN + 16];
+    unsigned long long hash, mirrorHash, key;
+    LONG game;
+    int ply, count, mirrored, known;
+
+    if (initSearch(&ctx, job->cards, job->keys, PUZZLE_TT_BITS))
     {
-        min_idx = i;
-        for (j = i + 1; j < count; j++) 
+        game = InterlockedIncrement(&job->nextGame) - 1;
+        while (job->found < job->target && (job->maxGames == 0 || game < job->maxGames))
         {
-            if (leaders[j].turns < leaders[min_idx].turns) 
-                min_idx = j;
-        }
-        
-        if (min_idx != i)
-        { 
-            /* Swap elements */
-            strcpy(temp.name, leaders[i].name);
-            temp.turns = leaders[i].turns;
+            rngSeed(&rng, job->baseSeed + game);
+            dealFromSeed(rngNext(&rng), job->cards, job->cardCount, deal);
+            initialState(deal, job->cards, &state);
+            historyClear(&ctx.history);
+            hash = hashState(&state, job->keys);
+            mirrorHash = hashMirror(&state, job->cards, job->keys);
+
+            for (ply = 0; ply < MAX_MOVES && coreWinner(&state) == 0 && historyOccurrences(&ctx.history, hash) == 0 &&
+                 job->found < job->target; ply++)
+            {
+                InterlockedIncrement64(&job->positions);
+                searchPosition(&ctx, &state, job->plies, 0, &result);
 
-            strcpy(leaders[i].name, leaders[min_idx].name);
-            leaders[i].turns = leaders[min_idx].turns;
-            
-            strcpy(leaders[min_idx].name, temp.name);
-            leaders[min_idx].turns = temp.turns;
+                if (result.score == WIN_SCORE - job->plies)
+                {
+                    InterlockedIncrement(&job->candidates);
+                    key = canonicalHash(&state, hash, mirrorHash, job->cards, &mirrored);
+
+                    EnterCriticalSection(&job->lock);
+                    known = puzzleSeen(job, key, 0);
+                    LeaveCriticalSection(&job->lock);
+
+                    if (!known && verifyPuzzle(&state, job->cards, job->plies, &solution))
+                    {
+                        formatPosition(&state, job->cards, position);
+                        formatMove(solution, job->cards, moveText);
+
+                        EnterCriticalSection(&job->lock);
+                        if (!puzzleSeen(job, key, 1) && job->found < job->target)
+                        {
+                            job->found++;
+                            fprintf(job->out, "%s | win %d | %s\n", position, job->plies, moveText);
+                            fflush(job->out);
+                            printf("puzzle %ld of %d from game %ld\n", job->found, job->target, game);
+                        }
+                        LeaveCriticalSection(&job->lock);
+                    }
+                }
+
+                // the screening search doubles as the simulated player, with random moves mixed in for variety
+                count = generateMoves(&state, job->cards, moves);
+                move = result.best;
+                if (ply < SELFPLAY_RANDOM_PLIES || rngBelow(&rng, PUZZLE_RANDOM_MOVE) == 0)
+                    move = moves[rngBelow(&rng, count)];
+
+                historyPush(&ctx.history, hash);
+                makeMove(&state, move, job->cards, job->keys, &hash, &mirrorHash, &undo);
+            }
+            game = InterlockedIncrement(&job->nextGame) - 1;
         }
+        freeSearch(&ctx);
     }
+    return 0;
+}
 
-    if (count > MAX_LEAD_LINES/2) //Keep only top MAX_LEAD_LINES/2 entries 
-        count = MAX_LEAD_LINES/2;
+/*
+Batch mode "-puzzles <count> <file>": mines positions with a unique forced win from simulated
+games on all cores and appends them to file, one per line as
+"<position> | win <plies> | <solution move>". Options: "-plies <n>" (odd, default PUZZLE_PLIES),
+"-games <n>" to stop early, "-seed <n>", "-threads <n>"
 
-   
-    // Write back to file 
-    fp = fopen("HallOfFame.txt", "w");
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param target Number of puzzles to find
+@param filename Puzzle file to append to
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 if the file or tables could not be opened
+*/
+int runPuzzles(int target, const char *filename, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    puzzleJob job;
+    zobristKeys keys;
+    HANDLE workers[MAX_THREADS];
+    int nWorkers = threadCount(argc, argv);
+    char *pliesArg = argValue(argc, argv, "-plies");
+    char *gamesArg = argValue(argc, argv, "-games");
+    char *seedArg = argValue(argc, argv, "-seed");
+    int i;
+    int status = 1;
+
+    initZobrist(&keys);
+    job.cards = cards;
+    job.cardCount = cardCount;
+    job.keys = &keys;
+    job.target = target > 0 ? target : 1;
+    job.plies = pliesArg != NULL ? atoi(pliesArg) | 1 : PUZZLE_PLIES;
+    if (job.plies < 1 || job.plies > MAX_PUZZLE_PLIES)
+        job.plies = PUZZLE_PLIES;
+    job.maxGames = gamesArg != NULL ? atol(gamesArg) : 0;
+    job.baseSeed = seedArg != NULL ? strtoull(seedArg, NULL, 10) : (unsigned long long) time(NULL);
+    job.nextGame = 0;
+    job.found = 0;
+    job.candidates = 0;
+    job.positions = 0;
+
+    // at most half full, so probing always ends on an empty slot
+    job.seenMask = 1023;
+    while (job.seenMask < (unsigned long long) job.target * 2)
+        job.seenMask = job.seenMask * 2 + 1;
+    job.seen = calloc(job.seenMask + 1, sizeof(unsigned long long));
+    job.out = fopen(filename, "a");
+
+    if (job.out == NULL)
+        printf("Error: Cannot open file %s\n", filename);
+    else if (job.seen != NULL)
+    {
+        status = 0;
+        InitializeCriticalSection(&job.lock);
+
+        for (i = 0; i < nWorkers; i++)
+            workers[i] = CreateThread(NULL, 0, puzzleWorker, &job, 0, NULL);
+        WaitForMultipleObjects(nWorkers, workers, TRUE, INFINITE);
+        for (i = 0; i < nWorkers; i++)
+            CloseHandle(workers[i]);
+
+        DeleteCriticalSection(&job.lock);
+        printf("found %ld puzzles (win in %d) in %ld games: %lld positions screened, %ld candidates verified\n",
+               job.found, job.plies, job.nextGame - nWorkers, (long long) job.positions, job.candidates);
+    }
 
-    for (i = 0; i < count; i++) 
-        fprintf(fp, "%s\n%d\n", leaders[i].name, leaders[i].turns);
-        
-    fclose(fp);
+    if (job.out != NULL)
+        fclose(job.out);
+    free(job.seen);
+    return status;
+}
+
+/*
+Lists every five-card set of the card table in ascending order
+
+Precondition:
+    - sets must have room for MAX_CARD_SETS sets
+    - cardCount must be between MAX_CARD_PER_GAME and MAX_CARDS
+
+@param cardCount Number of cards in the table
+@param sets Receives the sets
+@return Returns the number of sets
+*/
+int listCardSets(int cardCount, int sets[][MAX_CARD_PER_GAME])
+{
+    int ids[MAX_CARD_PER_GAME];
+    int count = 0;
+    int i, j;
 
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+        ids[i] = i;
+
+    do
+    {
+        memcpy(sets[count++], ids, sizeof(ids));
+
+        // advance the rightmost id that still has room, then pack the ones after it
+        i = MAX_CARD_PER_GAME - 1;
+        while (i >= 0 && ids[i] == cardCount - MAX_CARD_PER_GAME + i)
+            i--;
+        if (i >= 0)
+        {
+            ids[i]++;
+            for (j = i + 1; j < MAX_CARD_PER_GAME; j++)
+                ids[j] = ids[j - 1] + 1;
+        }
+    } while (i >= 0);
+
+    return count;
 }
 
 /*
-Displays the hall of fame
+Builds one of the DEAL_ARRANGEMENTS deals of a card set: which card is neutral and which
+pair goes to Player 1. The order of the cards inside a hand does not change the game
 
 Precondition:
-    - HallOfFame.txt must exist in working directory
+    - set must hold MAX_CARD_PER_GAME distinct card ids
+    - arrangement must be between 0 and DEAL_ARRANGEMENTS - 1
+
+@param set The five cards
+@param arrangement The arrangement number
+@param deal Receives the card ids: P1, P1, P2, P2, neutral
 @return Returns no data type (void)
 */
-void displayHoF()
+void arrangeDeal(const int set[], int arrangement, int deal[])
 {
-    str100 hallofFame[MAX_LEAD_LINES] = {0};
-    int i;
+    static const int pairs[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    int rest[MAX_CARD_PER_GAME - 1];
+    int neutral = arrangement / 6;
+    int pair = arrangement % 6;
+    int i, n = 0;
 
-    readHoF(hallofFame);
+    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+    {
+        if (i != neutral)
+            rest[n++] = set[i];
+    }
 
-    system("CLS");
-    printf("\n");
-    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "\x1b[1m" "           --HALL OF FAME--           " "\x1b[0m" "\x1b[36m" "|" "\x1b[0m" "\n");
+    deal[0] = rest[pairs[pair][0]];
+    deal[1] = rest[pairs[pair][1]];
+    n = 2;
+    for (i = 0; i < MAX_CARD_PER_GAME - 1; i++)
+    {
+        if (i != pairs[pair][0] && i != pairs[pair][1])
+            deal[n++] = rest[i];
+    }
+    deal[4] = set[neutral];
+}
 
-    if(hallofFame[0][0] == '\0')
-        printf("\x1b[33m" "No Hall of Fame entries yet. Be the first to make history!\n" "\x1b[0m");
+/*
+Hands the next deal to a survey worker: from its own queue, or else by stealing the upper
+half of another worker's queue
 
-    else
+Precondition:
+    - self must be the caller's worker number
+
+@param job The survey
+@param self The worker asking for work
+@param item Receives the pending slot to evaluate
+@return Returns 1 if work was found, 0 once every queue is empty
+*/
+int surveyTake(surveyJob *job, int self, int *item)
+{
+    surveyQueue *own = &job->queues[self];
+    surveyQueue *victim;
+    int found = 0;
+    int i, begin = 0, end = 0;
+
+    EnterCriticalSection(&own->lock);
+    if (own->begin < own->end)
     {
-        for(i = 0; i < MAX_LEAD_LINES; i+=2)
+        *item = own->begin++;
+        found = 1;
+    }
+    LeaveCriticalSection(&own->lock);
+
+    for (i = 1; i < job->workers && !found; i++)
+    {
+        victim = &job->queues[(self + i) % job->workers];
+        EnterCriticalSection(&victim->lock);
+        if (victim->begin < victim->end)
         {
-            if(hallofFame[i][0] == '\0')
-                i = MAX_LEAD_LINES;
+            begin = victim->begin + (victim->end - victim->begin) / 2;
+            end = victim->end;
+            victim->end = begin;
+            found = 1;
+        }
+        LeaveCriticalSection(&victim->lock);
 
-            else
+        if (found)
+        {
+            *item = begin;
+            EnterCriticalSection(&own->lock);
+            own->begin = begin + 1;
+            own->end = end;
+            LeaveCriticalSection(&own->lock);
+        }
+    }
+    return found;
+}
+
+/*
+Worker thread of the deal survey: searches each deal's starting position to the fixed depth
+and appends the result to the checkpoint
+
+Precondition:
+    - param must point to a running surveyJob
+
+@param param The surveyJob shared by all workers
+@return Returns 0 once no work is left
+*/
+DWORD WINAPI surveyWorker(LPVOID param)
+{
+    surveyJob *job = (surveyJob *) param;
+    int self = InterlockedIncrement(&job->nextWorker) - 1;
+    searchContext ctx;
+    searchResult result;
+    gameState state;
+    int deal[MAX_CARD_PER_GAME];
+    int item, index, score;
+
+    if (initSearch(&ctx, job->cards, job->keys, SURVEY_TT_BITS))
+    {
+        while (surveyTake(job, self, &item))
+        {
+            index = job->pending[item];
+            arrangeDeal(job->sets[index / DEAL_ARRANGEMENTS], index % DEAL_ARRANGEMENTS, deal);
+            initialState(deal, job->cards, &state);
+
+            // a fresh table keeps every score independent of which worker got the deal
+            memset(ctx.table, 0, (ctx.ttMask + 1) * sizeof(ttEntry));
+            historyClear(&ctx.history);
+            searchPosition(&ctx, &state, job->depth, 0, &result);
+            score = state.side == 0 ? result.score : -result.score;
+
+            EnterCriticalSection(&job->lock);
+            job->scores[index] = score;
+            fprintf(job->checkpoint, "%d %d\n", index, score);
+            fflush(job->checkpoint);
+            job->completed++;
+            if (job->completed % SURVEY_PROGRESS == 0)
+                printf("%d of %d deals\n", job->completed, job->dealCount);
+            LeaveCriticalSection(&job->lock);
+        }
+        freeSearch(&ctx);
+    }
+    return 0;
+}
+
+/*
+Reads the deals already evaluated from a survey checkpoint. A line cut short by a killed run
+is ignored and its deal is evaluated again
+
+Precondition:
+    - job->scores must hold job->dealCount entries set to WIN_SCORE + 1
+
+@param job The survey
+@param filename Checkpoint file
+@param header Header line the checkpoint must start with
+@return Returns 1 if the file is missing or matches the survey, 0 if it belongs to another survey
+*/
+int readSurveyCheckpoint(surveyJob *job, const char *filename, const char *header)
+{
+    FILE *fp = fopen(filename, "r");
+    char line[MAX_POSITION_LEN];
+    int index, score;
+    int ok = 1;
+
+    if (fp != NULL && fgets(line, sizeof(line), fp) != NULL)
+    {
+        ok = strcmp(line, header) == 0;
+        while (ok && fgets(line, sizeof(line), fp) != NULL)
+        {
+            if (strchr(line, '\n') != NULL && sscanf(line, "%d %d", &index, &score) == 2 &&
+                index >= 0 && index < job->dealCount && job->scores[index] > WIN_SCORE)
             {
-                printf("\x1b[36m" "Top %d:\n" "\x1b[0m", (i / 2) + 1);
-                printf("\x1b[35m" "Name:" "\x1b[0m" "%s\n", hallofFame[i]);
-                printf("\x1b[35m" "Turns It Took To Win: " "\x1b[0m" "%s", hallofFame[i+1]);
+                job->scores[index] = score;
+                job->completed++;
             }
-            printf("\n");
         }
     }
 
-    printf("\n\n\n\t\t" "\x1b[36m" "|" "\x1b[0m" "   Press " "\x1b[32m" "ENTER" "\x1b[0m" " to return to Main Menu   " "\x1b[36m" "|" "\x1b[0m" "\n");
-    getchar();
+    if (fp != NULL)
+        fclose(fp);
+    return ok;
 }
 
 /*
-Displays game instructions and controls
+Writes the per-deal table of a finished survey and prints the first-player summary: how the
+score of the side that moves first, which getFirstTurn takes from the neutral card's color,
+compares between blue and red neutral cards, overall and per neutral card
 
-Precondition: None
-@return Returns no data type (void)
+Precondition:
+    - every deal of job must have a score
+
+@param job The finished survey
+@param filename Table file to write
+@return Returns 1 if the table was written, 0 otherwise
 */
-void howToPlay()
+int writeSurveyReport(surveyJob *job, const char *filename)
 {
-    system("CLS");
-    printf("\n");
-    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "\x1b[1m" "           HOW TO PLAY ONITAMA!           " "\x1b[0m" "\x1b[36m" "|" "\x1b[0m" "\n");
+    FILE *fp = fopen(filename, "w");
+    cardInfo *cards = job->cards;
+    int deal[MAX_CARD_PER_GAME];
+    long long firstSum[2] = {0}, cardSum[MAX_CARDS] = {0};
+    int deals[2] = {0}, ahead[2] = {0}, level[2] = {0};
+    int cardDeals[MAX_CARDS] = {0}, cardAhead[MAX_CARDS] = {0};
+    int index, first, firstScore, side, id;
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "# P1 cards, P2 cards, neutral, first (b/r), score for Player 1, score for the first player\n");
+        for (index = 0; index < job->dealCount; index++)
+        {
+            arrangeDeal(job->sets[index / DEAL_ARRANGEMENTS], index % DEAL_ARRANGEMENTS, deal);
+            first = cards[deal[4]].color;
+            firstScore = first == 0 ? job->scores[index] : -job->scores[index];
+
+            fprintf(fp, "%s,%s %s,%s %s %c %d %d\n", cards[deal[0]].name, cards[deal[1]].name,
+                    cards[deal[2]].name, cards[deal[3]].name, cards[deal[4]].name, first == 0 ? 'b' : 'r',
+                    job->scores[index], firstScore);
+
+            deals[first]++;
+            firstSum[first] += firstScore;
+            ahead[first] += firstScore > 0;
+            level[first] += firstScore == 0;
+            cardDeals[deal[4]]++;
+            cardSum[deal[4]] += firstScore;
+            cardAhead[deal[4]] += firstScore > 0;
+        }
+        fclose(fp);
 
-    printf("\x1b[33m" " Overview:" "\x1b[0m" "\n");
-    printf(" ------------------------------------------\n");
-    printf(" Onitama is a two-player turn-based strategy game played on a 5x5 board.\n");
-    printf(" Each player has five pieces: one " "\x1b[1m" "SENSEI" "\x1b[0m" " (Master) and four " "\x1b[1m" "STUDENTS" "\x1b[0m" ".\n\n");
+        printf("%d deals searched to depth %d, table written to %s\n", job->dealCount, job->depth, filename);
+        for (side = 0; side < 2; side++)
+        {
+            if (deals[side] > 0)
+                printf("%s neutral, Player %d first: %d deals, first player %+.1f on average, ahead in %.1f%%, level in %.1f%%\n",
+                       side == 0 ? "blue" : "red", side + 1, deals[side], (double) firstSum[side] / deals[side],
+                       100.0 * ahead[side] / deals[side], 100.0 * level[side] / deals[side]);
+        }
+        printf("first-move advantage %+.1f, Player 1 advantage from getFirstTurn %+.1f\n",
+               (double) (firstSum[0] + firstSum[1]) / job->dealCount,
+               (double) (firstSum[0] - firstSum[1]) / job->dealCount);
 
-    printf("\x1b[33m" " Objective:" "\x1b[0m" "\n");
-    printf(" ------------------------------------------\n");
-    printf(" To win, you must accomplish one of these:\n");
-    printf(" " "\x1b[32m" "1." "\x1b[0m" " Capture your opponent's " "\x1b[1m" "SENSEI" "\x1b[0m" "\n");
-    printf(" " "\x1b[32m" "2." "\x1b[0m" " Move your " "\x1b[1m" "SENSEI" "\x1b[0m" " to your opponent's starting temple (center of their back row)\n\n");
+        printf("neutral card   color  deals  first player  ahead\n");
+        for (id = 0; id < MAX_CARDS; id++)
+        {
+            if (cardDeals[id] > 0)
+                printf("%-14s %-6s %5d  %+11.1f  %4.1f%%\n", cards[id].name, cards[id].color == 0 ? "blue" : "red",
+                       cardDeals[id], (double) cardSum[id] / cardDeals[id], 100.0 * cardAhead[id] / cardDeals[id]);
+        }
+    }
+    else
+        printf("Error: Cannot open file %s\n", filename);
 
-    printf("\x1b[33m" " Game Setup:" "\x1b[0m" "\n");
-    printf(" ------------------------------------------\n");
-    printf(" - Players start with their pieces arranged on opposite sides\n");
-    printf(" - Each player begins with 2 unique movement cards\n");
-    printf(" - There's 1 neutral card that isn't assigned to either player\n\n");
+    return fp != NULL;
+}
 
-    printf("\x1b[33m" " Movement Rules:" "\x1b[0m" "\n");
-    printf(" ------------------------------------------\n");
-    printf(" - On your turn, you must perform " "\x1b[1m" "ONE" "\x1b[0m" " action:\n");
-    printf("   " "\x1b[32m" "1." "\x1b[0m" " Move a piece according to one of your movement cards\n");
-    printf("   " "\x1b[32m" "2." "\x1b[0m" " Exchange one of your cards with the neutral card\n");
-    printf(" - After moving, the used card becomes the neutral card\n");
-    printf(" - Movement patterns are shown on the cards (arrows indicate possible moves)\n\n");
+/*
+Batch mode "-survey <checkpoint> <table>": searches the starting position of every distinct
+deal (every five-card set, neutral card and split of the hands) with the same engine budget
+on all cores. Finished deals are appended to the checkpoint as they complete, so a killed run
+picks up where it stopped. Options: "-depth <plies>" (default SURVEY_DEPTH), "-threads <n>"
 
-    printf("\x1b[33m" " Special Rules:" "\x1b[0m" "\n");
-    printf(" ------------------------------------------\n");
-    printf(" - " "\x1b[1m" "SENSEI" "\x1b[0m" " can be captured like any other piece\n");
-    printf(" - " "\x1b[1m" "STUDENTS" "\x1b[0m" " can capture opponent's pieces by landing on them\n");
-    printf(" - If a " "\x1b[1m" "STUDENT" "\x1b[0m" " reaches the opponent's temple row, it remains there\n\n");
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param checkpointName Checkpoint file, created or resumed
+@param tableName Table file written once every deal is done
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 when the survey is complete, 1 otherwise
+*/
+int runSurvey(const char *checkpointName, const char *tableName, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    surveyJob job;
+    zobristKeys keys;
+    HANDLE workers[MAX_THREADS];
+    char *depthArg = argValue(argc, argv, "-depth");
+    char header[MAX_POSITION_LEN];
+    int pendingCount = 0;
+    int i;
+    int status = 1;
 
-    printf("\t\t" "\x1b[36m" "|" "\x1b[0m" "   Press " "\x1b[32m" "ENTER" "\x1b[0m" " to return to Main Menu   " "\x1b[36m" "|" "\x1b[0m" "\n");
+    initZobrist(&keys);
+    job.cards = cards;
+    job.keys = &keys;
+    job.depth = depthArg != NULL ? atoi(depthArg) : SURVEY_DEPTH;
+    if (job.depth < 1 || job.depth > MAX_SEARCH_DEPTH)
+        job.depth = SURVEY_DEPTH;
+    job.workers = threadCount(argc, argv);
+    job.completed = 0;
+    job.nextWorker = 0;
+    job.checkpoint = NULL;
+
+    job.sets = malloc(MAX_CARD_SETS * sizeof(*job.sets));
+    job.dealCount = job.sets != NULL ? listCardSets(cardCount, job.sets) * DEAL_ARRANGEMENTS : 0;
+    job.scores = malloc(job.dealCount * sizeof(int));
+    job.pending = malloc(job.dealCount * sizeof(int));
+    sprintf(header, "# survey depth %d cards %d board %d\n", job.depth, cardCount, BOARD_SIZE);
+
+    for (i = 0; job.scores != NULL && i < job.dealCount; i++)
+        job.scores[i] = WIN_SCORE + 1; // not evaluated yet
+
+    if (job.sets == NULL || job.scores == NULL || job.pending == NULL)
+        printf("Error: not enough memory for %d deals\n", job.dealCount);
+
+    else if (!readSurveyCheckpoint(&job, checkpointName, header))
+        printf("Error: %s belongs to a survey with other settings\n", checkpointName);
+
+    else if ((job.checkpoint = fopen(checkpointName, "a")) == NULL)
+        printf("Error: Cannot open file %s\n", checkpointName);
+
+    else
+    {
+        if (ftell(job.checkpoint) == 0)
+            fputs(header, job.checkpoint);
+        printf("%d of %d deals already in %s\n", job.completed, job.dealCount, checkpointName);
+
+        for (i = 0; i < job.dealCount; i++)
+        {
+            if (job.scores[i] > WIN_SCORE)
+                job.pending[pendingCount++] = i;
+        }
+
+        // every worker starts on its own contiguous share and steals once it runs dry
+        InitializeCriticalSection(&job.lock);
+        for (i = 0; i < job.workers; i++)
+        {
+            job.queues[i].begin = (int) ((long long) pendingCount * i / job.workers);
+            job.queues[i].end = (int) ((long long) pendingCount * (i + 1) / job.workers);
+            InitializeCriticalSection(&job.queues[i].lock);
+        }
+
+        for (i = 0; i < job.workers; i++)
+            workers[i] = CreateThread(NULL, 0, surveyWorker, &job, 0, NULL);
+        WaitForMultipleObjects(job.workers, workers, TRUE, INFINITE);
+        for (i = 0; i < job.workers; i++)
+        {
+            CloseHandle(workers[i]);
+            DeleteCriticalSection(&job.queues[i].lock);
+        }
+        DeleteCriticalSection(&job.lock);
+
+        if (job.completed == job.dealCount && writeSurveyReport(&job, tableName))
+            status = 0;
+    }
 
-    getchar();
+    if (job.checkpoint != NULL)
+        fclose(job.checkpoint);
+    free(job.pending);
+    free(job.scores);
+    free(job.sets);
+    return status;
 }
 
 /*
-Initializes player piece names with proper colors
+Sends a whole buffer over a socket, looping over partial sends
 
 Precondition:
-    - Player structures must be allocated
-    - Color macros must be properly defined
+    - sock must be connected
 
-@param p1 Pointer to Player 1's data
-@param p2 Pointer to Player 2's data
-@return Returns no data type (void)
+@param sock The socket
+@param data Bytes to send
+@param length Number of bytes
+@return Returns 1 if everything was sent, 0 if the connection failed
 */
-void populatePlayerPiece(player *p1, player *p2)
+int sendAll(SOCKET sock, const char *data, int length)
 {
-    int i;
-
-    for(i = 0; i < NUM_OF_STUD; i++)
-    {
-        if(i==NUM_OF_STUD/2)
-        strcpy(p1->pPiece.sensei, "\x1b[34m" "| M |" "\x1b[0m");
-        else
-        strcpy(p1->pPiece.student[i], "\x1b[34m" "| s |" "\x1b[0m");
-    }
+    int sent;
+    int ok = 1;
 
-
-    for(i = 0; i < NUM_OF_STUD; i++)
+    while (ok && length > 0)
     {
-        if(i==NUM_OF_STUD/2)
-        strcpy(p2->pPiece.sensei, "\x1b[31m" "| M |" "\x1b[0m");
-        else
-        strcpy(p2->pPiece.student[i], "\x1b[31m" "| s |" "\x1b[0m");
+        sent = send(sock, data, length, 0);
+        ok = sent > 0;
+        if (ok)
+        {
+            data += sent;
+            length -= sent;
+        }
     }
+    return ok;
 }
 
 /*
-Initializes the game board with starting piece positions
+Reads the next '\n' terminated line from a socket
 
 Precondition:
-    - Board must be properly allocated
-    - Player structures must have initialized piece names
+    - reader must have been set up with the connected socket and start = end = 0
+    - line must have room for max characters
 
-@param board The game board to populate
-@param p1 Pointer to Player 1's data
-@param p2 Pointer to Player 2's data
-@return Returns no data type (void)
+@param reader Buffered reader of the socket
+@param line Receives the line without its '\n', cut to max - 1 characters
+@param max Size of line
+@return Returns 1 for a line, 0 once the connection is closed
 */
-void populateBoard(oniBrd board, player *p1, player *p2) 
+int netReadLine(netReader *reader, char *line, int max)
 {
-    int i, j;
+    int n = 0;
+    int got = 0;
+    int open = 1;
+    int received;
 
-    for(i = 0; i < ROWS; i++)
+    while (!got && open)
     {
-        for(j = 0; j < COLS; j++)
-        {   
-            strcpy(board[i][j], "| _ |");
+        if (reader->start == reader->end)
+        {
+            received = recv(reader->sock, reader->buffer, NET_BUFFER, 0);
+            open = received > 0;
+            reader->start = 0;
+            reader->end = open ? received : 0;
         }
-    }
-
-    for(j = 0; j < COLS; j++)
-    {
-        if(j == COLS/2)
-            strcpy(board[ROWS-1][j], p1->pPiece.sensei);
-        else if(j < NUM_OF_STUD)
-            strcpy(board[ROWS-1][j], p1->pPiece.student[j]);
-    }
 
-    for(j = 0; j < COLS; j++)
-    {
-        if(j == COLS/2)
-            strcpy(board[0][j], p2->pPiece.sensei);
-        else if(j < NUM_OF_STUD)  
-            strcpy(board[0][j], p2->pPiece.student[j]);
+        while (!got && reader->start < reader->end)
+        {
+            if (reader->buffer[reader->start] == '\n')
+                got = 1;
+            else if (n < max - 1)
+                line[n++] = reader->buffer[reader->start];
+            reader->start++;
+        }
     }
 
+    line[n] = '\0';
+    return got;
 }
 
 /*
-Displays the current game board with all pieces and cards
+Sends a pending work unit to an idle worker
 
 Precondition:
-    - Board must be properly populated
-    - Player structures must be initialized
-    - crdsIG must contain current card displays
-    - selRow and selCol must be valid coordinates or -1
-    - nFlagPiece must be 0 or 1
+    - link must be connected and idle
+    - unit must be pending
 
-@param board The game board
-@param p1 Pointer to Player 1's data
-@param p2 Pointer to Player 2's data
-@param crdsIG Pointer to game cards display data
-@param selRow Currently selected row (-1 for none)
-@param selCol Currently selected column (-1 for none)
-@param nFlagPiece Selection highlight flag
-@return Returns no data type (void)
+@param coord The coordinator
+@param link The worker's link
+@param unit Index of the unit to send
+@return Returns 1 if the unit was sent, 0 if the connection failed
 */
-void displayBoard(oniBrd board, player *p1, player *p2, dataCrdsIG *crdsIG, int selRow, int selCol, int nFlagPiece)
+int sendWorkUnit(coordinator *coord, workerLink *link, int unit)
 {
-    int i, j;
+    workUnit *work = &coord->units[unit];
+    char *text = malloc(100 + (size_t) work->count * (MAX_POSITION_LEN + 1));
+    int length, i;
+    int ok = text != NULL;
 
-    system("CLS");
-    printf("\n\t\t\t\t\t\t" "\x1b[36m" " O N I T A M A " "\x1b[0m" "\t\t\t\t\t\t\n");
-
-
-    printf(" " "\x1b[31m" "[Player 2] " "\x1b[0m" "%s's Cards:\n", p2->name);
-
-    for (i = TEXT_FILE_ROWS - 1; i >= 0; i--)
+    if (ok && coord->analyze)
     {
-        printf(" \t\t\t\t\t" "\x1b[31m" "| " "\x1b[0m" "%6s" "\x1b[31m" " |\t\t| " "\x1b[0m", p2->card.visualCard[0][i]);
-        printf("%6s" "\x1b[31m" " |\n" "\x1b[0m", p2->card.visualCard[1][i]);
+        length = sprintf(text, "ANALYZE %d %d %d %d\n", unit, coord->depth, coord->timeMs, work->count);
+        for (i = 0; i < work->count; i++)
+            length += sprintf(text + length, "%s\n", coord->lines[work->first + i]);
     }
+    else if (ok)
+        length = sprintf(text, "PLAY %d %d %d %llu %d %d %d\n", unit, work->first, work->count,
+                         coord->baseSeed, coord->depth, coord->rule.repetitions, coord->rule.maxPlies);
 
-    printf(" \t\t\t\t\t  " "\x1b[31m" "%6s" "\x1b[0m" "\t\t  " "\x1b[31m" "%6s\n" "\x1b[0m", p2->card.playercard[0], p2->card.playercard[1]);
-
-    printf("\n\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m");
-    printf("\n\t\t" "\x1b[33m" "| Card: %6s |" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "| Card: %6s |\n" "\x1b[0m",
-           crdsIG->lCardName, crdsIG->rCardName);
-    printf("\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m" "\t\t\t\t\t\t\t" "\x1b[33m" "+-------------------+" "\x1b[0m");
-    printf("\n\n\t\t\t\t ");
-
-    for (i = 0; i < COLS+1; i++)
+    if (ok)
+        ok = sendAll(link->sock, text, length);
+    if (ok)
     {
-        printf("+-------");
+        work->state = UNIT_ASSIGNED;
+        link->unit = unit;
+        link->length = 0;
+        link->assignedAt = GetTickCount64();
     }
-    printf("+\n");
-
-    for (i = 0; i < ROWS; i++)
-    {
-        printf("\t\t%s\t\t", crdsIG->lCardDisp[i]);
-        for (j = 0; j < COLS; j++)
-        {
-            printf("| ");
-            if (i == selRow && j == selCol && nFlagPiece == 1) //if nFlagPiece is 1 prints the arrow for user to
-                                                               //see where the current position is he currently selecting
-            {
-                // Changed to Magenta for the arrows
-                printf("\x1b[35m" ">" "\x1b[0m"); // Magenta '>' and reset color immediately
-                printf("%s", board[i][j]);         // Print board content (e.g., "| M |" or "| s |" which have their own colors)
-                printf("\x1b[35m" "<" "\x1b[0m"); // Magenta '<' and reset color immediately
-            }
-            else
-                printf(" %s ", board[i][j]);
-            printf(" ");
-        }
-
-        printf("|\t\t");
-        if (i < TEXT_FILE_ROWS)
-        {
-            printf("%s", crdsIG->rCardDisp[i]);
-        }
 
-        printf("\n\t\t\t\t ");
+    free(text);
+    return ok;
+}
 
-        for (j = 0; j < COLS+1; j++)
-        {
-            printf("+-------");
-        }
-        printf("+\n");
-    }
+/*
+Closes a worker's link. The unit it held goes back to the pending units, so a crashed or
+stalled worker only costs the time spent on that unit
 
-    printf("\t\t%s", crdsIG->lCardDisp[TEXT_FILE_ROWS-1]);
-    printf("\t\t\t\t\t\t\t\t\t\t%s\n\n", crdsIG->rCardDisp[TEXT_FILE_ROWS-1]);
+Precondition:
+    - link must be connected
 
-    // Player 1 (bottom) cards with better labels
-    printf(" " "\x1b[34m" "[Player 1] " "\x1b[0m" "%s's Cards:\n", p1->name);
-    for (i = 0; i < TEXT_FILE_ROWS; i++)
+@param coord The coordinator
+@param link The link to close
+@return Returns no data type (void)
+*/
+void dropWorkerLink(coordinator *coord, workerLink *link)
+{
+    if (link->unit >= 0 && coord->units[link->unit].state == UNIT_ASSIGNED)
     {
-        printf(" \t\t\t\t\t" "\x1b[34m" "| " "\x1b[0m" "%6s" "\x1b[34m" " |\t\t| " "\x1b[0m", p1->card.visualCard[0][i]);
-        printf("%6s" "\x1b[34m" " |\n" "\x1b[0m", p1->card.visualCard[1][i]);
+        coord->units[link->unit].state = UNIT_PENDING;
+        printf("worker lost, unit %d reissued\n", link->unit);
     }
-    printf(" \t\t\t\t\t  " "\x1b[34m" "%6s" "\x1b[0m" "\t\t  " "\x1b[34m" "%6s\n\n" "\x1b[0m", p1->card.playercard[0], p1->card.playercard[1]);
+
+    closesocket(link->sock);
+    link->sock = INVALID_SOCKET;
+    link->unit = -1;
+    link->length = 0;
 }
+
 /*
-Swaps a player's card with a game card according to game rules
+Reads what a worker has sent. The results of a unit are kept until its "DONE <unit>" line
+arrives, so a worker that dies half way leaves nothing behind
 
 Precondition:
-    - currentPlayer must have valid cards
-    - crdsIG must contain valid game cards
-    - selectedCard must be 0 or 1
-    - playerTurn must be 0 or 1
-    - round must be >= 1
+    - link must be connected and readable
 
-@param currentPlayer Pointer to current player's data
-@param crdsIG Pointer to game cards data
-@param selectedCard Which player card to swap (0 or 1)
-@param playerTurn Current player indicator (0 or 1)
-@param round Current round number
+@param coord The coordinator
+@param link The link to read
 @return Returns no data type (void)
 */
-void switchCard(player *currentPlayer, dataCrdsIG *crdsIG, int selectedCard, int playerTurn, int round)
+void receiveFromLink(coordinator *coord, workerLink *link)
 {
-    str30 usedCard;
-    str30 visualUsedCard[TEXT_FILE_ROWS];
-    int i;
+    char *grown, *done;
+    size_t from = link->length >= 6 ? link->length - 6 : 0; // "\nDONE " may straddle two reads
+    int received, unit;
 
-    strcpy(usedCard, currentPlayer->card.playercard[selectedCard]);
-
-    if (playerTurn == 0) // Blue's turn
+    if (link->capacity - link->length < NET_BUFFER + 1)
     {
-        // Blue takes the right card, puts used card to the left
-        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->rCardName);
-        strcpy(crdsIG->lCardName, usedCard);
-        strcpy(crdsIG->rCardName, "None");
-
-        for(i = 0; i < TEXT_FILE_ROWS; i++)
+        grown = realloc(link->received, link->capacity * 2 + NET_BUFFER + 1);
+        if (grown != NULL)
         {
-            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
-            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->rCardDisp[i]);
-            strcpy(crdsIG->lCardDisp[i], visualUsedCard[i]);
-            strcpy(crdsIG->rCardDisp[i], ".....");
+            link->received = grown;
+            link->capacity = link->capacity * 2 + NET_BUFFER + 1;
         }
     }
-    else if (playerTurn == 1 && round == 1) // Red's first move
-    {
-        // Red takes the right card, puts used card back to right
-        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->rCardName);
-        strcpy(crdsIG->rCardName, usedCard);
 
-        for(i = 0; i < TEXT_FILE_ROWS; i++)
-        {
-            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
-            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->rCardDisp[i]);
-            strcpy(crdsIG->rCardDisp[i], visualUsedCard[i]);
-        }
-    }
-    else if (playerTurn == 1) // Red's later turns
+    received = link->capacity - link->length >= NET_BUFFER + 1 ?
+               recv(link->sock, link->received + link->length, NET_BUFFER, 0) : -1;
+
+    if (received <= 0)
+        dropWorkerLink(coord, link);
+    else
     {
-        // Red takes the left card, puts used card to the right
-        strcpy(currentPlayer->card.playercard[selectedCard], crdsIG->lCardName);
-        strcpy(crdsIG->rCardName, usedCard);
-        strcpy(crdsIG->lCardName, "None");
-        for(i = 0; i < TEXT_FILE_ROWS; i++)
+        link->length += received;
+        link->received[link->length] = '\0';
+
+        done = strncmp(link->received, "DONE ", 5) == 0 ? link->received : strstr(link->received + from, "\nDONE ");
+        if (done != NULL && done != link->received)
+            done++;
+
+        if (done != NULL && strchr(done, '\n') != NULL && sscanf(done, "DONE %d", &unit) == 1 && unit == link->unit)
         {
-            strcpy(visualUsedCard[i], currentPlayer->card.visualCard[selectedCard][i]);
-            strcpy(currentPlayer->card.visualCard[selectedCard][i], crdsIG->lCardDisp[i]);
-            strcpy(crdsIG->rCardDisp[i], visualUsedCard[i]);
-            strcpy(crdsIG->lCardDisp[i], ".....");
+            // a unit reissued after a timeout may be finished twice, the first copy wins
+            if (coord->units[unit].state != UNIT_DONE)
+            {
+                coord->units[unit].output = malloc(done - link->received + 1);
+                if (coord->units[unit].output != NULL)
+                {
+                    memcpy(coord->units[unit].output, link->received, done - link->received);
+                    coord->units[unit].output[done - link->received] = '\0';
+                    coord->units[unit].state = UNIT_DONE;
+                    coord->doneCount++;
+                }
+                else
+                    coord->units[unit].state = UNIT_PENDING;
+            }
+            link->unit = -1;
+            link->length = 0;
         }
     }
 }
 
 /*
-Manages a single player's turn including piece selection and movement
+Network mode "-coordinator <port> selfplay <games> <file>" or
+"-coordinator <port> analyze <positions> <file>": splits the work into units of
+NET_UNIT_GAMES games or NET_UNIT_LINES positions and hands them to "-worker" processes that
+connect over TCP, one unit per worker at a time. Results are written to file in unit order
+(self-play games are appended, analysis results replace the file). A worker that disconnects,
+or holds a unit longer than "-timeout <seconds>", has its unit reissued to another worker.
+Self-play options as in runSelfPlay ("-seed" is the base of the game seeds), analysis options
+"-depth" and "-time" as in runBatchAnalysis
 
 Precondition:
-    - All player structures must be initialized
-    - Board must be properly populated
-    - crdsIG must contain current game cards
-    - playerTurn must be 0 or 1
-    - round must be >= 1
-
-@param p1 Pointer to Player 1's data
-@param p2 Pointer to Player 2's data
-@param board The game board
-@param crdsIG Pointer to game cards data
-@param playerTurn Pointer to current player indicator
-@param round Pointer to current round number
-@return Returns no data type (void)
+    - cards must hold cardCount loaded cards
+
+@param port TCP port to listen on
+@param mode "selfplay" or "analyze"
+@param input Number of games, or the positions file
+@param filename Output file
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns 0 once every unit is done, 1 on a setup error
 */
-void gameTurn(player *p1, player *p2, oniBrd board, dataCrdsIG *crdsIG, int *playerTurn, int *round,
-              MoveRecord* replayMoves, int* moveCount)
+int runCoordinator(const char *port, const char *mode, const char *input, const char *filename,
+                   int argc, char *argv[])
 {
-    int nArrkey;
-    int nFlagPiece = 0;
-    int moveValid = 0;
-    int fromRow = 0, fromCol = 0;
-    int toRow = 0 , toCol = 0;
-    int selectedCard = 0;
-    int noValidMoveFlag = 0;
-    player *currentPlayer;
+    coordinator coord;
+    WSADATA wsa;
+    SOCKET listener = INVALID_SOCKET;
+    SOCKET sock;
+    struct sockaddr_in address;
+    struct timeval wait;
+    fd_set readable;
+    char *depthArg = argValue(argc, argv, "-depth");
+    char *timeArg = argValue(argc, argv, "-time");
+    char *seedArg = argValue(argc, argv, "-seed");
+    char *timeoutArg = argValue(argc, argv, "-timeout");
+    int items = 0;
+    int unitSize, i, j, slot;
+    int status = 1;
+
+    memset(&coord, 0, sizeof(coord));
+    coord.analyze = strcmp(mode, "analyze") == 0;
+    coord.timeMs = timeArg != NULL ? atoi(timeArg) : 0;
+    coord.depth = depthArg != NULL ? atoi(depthArg) :
+                  (coord.analyze ? (coord.timeMs > 0 ? MAX_SEARCH_DEPTH : DEFAULT_ANALYSIS_DEPTH) : SELFPLAY_DEPTH);
+    if (coord.depth < 1 || coord.depth > MAX_SEARCH_DEPTH)
+        coord.depth = MAX_SEARCH_DEPTH;
+    coord.baseSeed = seedArg != NULL ? strtoull(seedArg, NULL, 10) : (unsigned long long) time(NULL);
+    coord.timeoutMs = timeoutArg != NULL ? strtoull(timeoutArg, NULL, 10) * 1000 : 0;
+    readDrawRule(argc, argv, &coord.rule);
+    for (i = 0; i < MAX_WORKER_LINKS; i++)
+    {
+        coord.links[i].sock = INVALID_SOCKET;
+        coord.links[i].unit = -1;
+    }
 
+    if (coord.analyze)
+        items = readLines(input, &coord.lines, &items) ? items : 0;
+    else
+        items = atoi(input);
+    unitSize = coord.analyze ? NET_UNIT_LINES : NET_UNIT_GAMES;
 
-    if (*playerTurn == 0)
-        currentPlayer = p1;
-       else
-         currentPlayer = p2;
+    coord.unitCount = (items + unitSize - 1) / unitSize;
+    coord.units = calloc(coord.unitCount + 1, sizeof(workUnit));
+    for (i = 0; coord.units != NULL && i < coord.unitCount; i++)
+    {
+        coord.units[i].first = i * unitSize;
+        coord.units[i].count = items - i * unitSize < unitSize ? items - i * unitSize : unitSize;
+    }
 
-    if (!hasAnyValidMove(currentPlayer, board, *playerTurn)) //Check if the player has any valid moves at all
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short) atoi(port));
+
+    if (items <= 0 || coord.units == NULL || (!coord.analyze && strcmp(mode, "selfplay") != 0))
+        printf("Error: nothing to do for %s %s\n", mode, input);
+
+    else if ((coord.out = fopen(filename, coord.analyze ? "w" : "a")) == NULL)
+        printf("Error: Cannot open file %s\n", filename);
+
+    else if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0 ||
+             (listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == INVALID_SOCKET ||
+             bind(listener, (struct sockaddr *) &address, sizeof(address)) == SOCKET_ERROR ||
+             listen(listener, SOMAXCONN) == SOCKET_ERROR)
+        printf("Error: cannot listen on port %s\n", port);
+
+    else
     {
-        noValidMoveFlag = 1;
-        do //card selection phase to swap
+        status = 0;
+        printf("%d units of work, waiting for workers on port %s\n", coord.unitCount, port);
+
+        while (coord.nextWrite < coord.unitCount)
         {
-            displayBoard(board, p1, p2, crdsIG, 0, 0, 0);
-            printf("\x1b[31m" "\nPlayer %s has no valid moves this turn.\n" "\x1b[0m", currentPlayer->name);
-            printf("You must still place one of your move cards on the side and pick up the one from the center.\n");
-            printf("Choose card to place (LEFT/RIGHT), then press ENTER.\n");
-            printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
+            FD_ZERO(&readable);
+            FD_SET(listener, &readable);
+            for (i = 0; i < MAX_WORKER_LINKS; i++)
+            {
+                if (coord.links[i].sock != INVALID_SOCKET)
+                    FD_SET(coord.links[i].sock, &readable);
+            }
+            wait.tv_sec = 1;
+            wait.tv_usec = 0;
+
+            if (select(0, &readable, NULL, NULL, &wait) > 0)
+            {
+                if (FD_ISSET(listener, &readable) && (sock = accept(listener, NULL, NULL)) != INVALID_SOCKET)
+                {
+                    slot = -1;
+                    for (i = 0; i < MAX_WORKER_LINKS && slot < 0; i++)
+                    {
+                        if (coord.links[i].sock == INVALID_SOCKET)
+                            slot = i;
+                    }
+                    if (slot < 0)
+                        closesocket(sock);
+                    else
+                        coord.links[slot].sock = sock;
+                }
+
+                for (i = 0; i < MAX_WORKER_LINKS; i++)
+                {
+                    if (coord.links[i].sock != INVALID_SOCKET && FD_ISSET(coord.links[i].sock, &readable))
+                        receiveFromLink(&coord, &coord.links[i]);
+                }
+            }
+
+            // stalled workers lose their unit, idle workers get the next pending one
+            for (i = 0; i < MAX_WORKER_LINKS; i++)
+            {
+                if (coord.links[i].sock != INVALID_SOCKET && coord.links[i].unit >= 0 && coord.timeoutMs > 0 &&
+                    GetTickCount64() - coord.links[i].assignedAt > coord.timeoutMs)
+                    dropWorkerLink(&coord, &coord.links[i]);
+
+                if (coord.links[i].sock != INVALID_SOCKET && coord.links[i].unit < 0)
+                {
+                    for (j = 0; j < coord.unitCount && coord.units[j].state != UNIT_PENDING; j++)
+                        ;
+                    if (j < coord.unitCount && !sendWorkUnit(&coord, &coord.links[i], j))
+                        dropWorkerLink(&coord, &coord.links[i]);
+                }
+            }
+
+            while (coord.nextWrite < coord.unitCount && coord.units[coord.nextWrite].state == UNIT_DONE)
+            {
+                fputs(coord.units[coord.nextWrite].output, coord.out);
+                free(coord.units[coord.nextWrite].output);
+                coord.units[coord.nextWrite].output = NULL;
+                coord.nextWrite++;
+                fflush(coord.out);
+                printf("%d of %d units done\n", coord.nextWrite, coord.unitCount);
+            }
+        }
 
-            nArrkey = getch();
-            if (nArrkey == 0 || nArrkey == 224)
+        for (i = 0; i < MAX_WORKER_LINKS; i++)
+        {
+            if (coord.links[i].sock != INVALID_SOCKET)
             {
-                nArrkey = getch();
-                if (nArrkey == KEY_LEFT)
-                    selectedCard = 0;
-                else if (nArrkey == KEY_RIGHT)
-                    selectedCard = 1;
+                sendAll(coord.links[i].sock, "QUIT\n", 5);
+                closesocket(coord.links[i].sock);
             }
-        } while (nArrkey != KEY_ENTER);
+        }
+    }
 
-        switchCard(currentPlayer, crdsIG, selectedCard, *playerTurn, *round);
+    if (listener != INVALID_SOCKET)
+        closesocket(listener);
+    WSACleanup();
+    for (i = 0; i < MAX_WORKER_LINKS; i++)
+        free(coord.links[i].received);
+    if (coord.out != NULL)
+        fclose(coord.out);
+    free(coord.units);
+    free(coord.lines);
+    return status;
+}
 
-        if (*playerTurn == 0)
-            *playerTurn = 1;
-        else
-            *playerTurn = 0;
+/*
+Network mode "-worker <host> <port>": connects to a coordinator, retrying while it starts up,
+then runs the units it is sent until it is told to quit. Run one worker per core, on as many
+machines as needed
 
-        *round = *round + 1;
-        currentPlayer->turns++;
-    }
+Precondition:
+    - cards must hold cardCount loaded cards
 
-    if(!noValidMoveFlag) // card selection phase if has a valid move
+@param host Coordinator host name or address
+@param port Coordinator TCP port
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 after a clean shutdown, 1 if the coordinator could not be reached
+*/
+int runWorker(const char *host, const char *port, cardInfo cards[], int cardCount)
+{
+    WSADATA wsa;
+    struct addrinfo hints, *address = NULL;
+    netReader reader;
+    zobristKeys keys;
+    searchContext ctx;
+    analysisJob job;
+    gameRecord record;
+    rngState rng;
+    drawRule rule;
+    gameClock clock;                    // work units are untimed so every worker plays the same games
+    unsigned long long seed;
+    char line[MAX_POSITION_LEN];
+    char result[MAX_RESULT_LEN + 1];
+    char text[MAX_RECORD_TEXT];
+    int unit, first, count, depth, i, tries;
+    int running = 1;
+    int status = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    reader.sock = INVALID_SOCKET;
+    reader.start = reader.end = 0;
+    memset(&clock, 0, sizeof(clock));
+    clock.running = -1;
+    initZobrist(&keys);
+    job.cards = cards;
+    job.cardCount = cardCount;
+    job.keys = &keys;
+    job.stats = 0;
+    job.multiPV = 1;
+    job.ttFile = NULL;
+    job.ttBits = ANALYSIS_TT_BITS;
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) == 0 && getaddrinfo(host, port, &hints, &address) == 0)
     {
-        selectedCard = 0;
-        do
+        for (tries = 0; tries < NET_CONNECT_TRIES && reader.sock == INVALID_SOCKET; tries++)
         {
-            displayBoard(board, p1, p2, crdsIG, fromRow, fromCol, nFlagPiece);
-            printf("\n%s's turn\n", currentPlayer->name);
-            printf("Choose your move card using LEFT/RIGHT arrow. Press ENTER to confirm.\n");
-            printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
-
-            nArrkey = getch();
-            if (nArrkey == 0 || nArrkey == 224)
+            reader.sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (reader.sock != INVALID_SOCKET &&
+                connect(reader.sock, address->ai_addr, (int) address->ai_addrlen) == SOCKET_ERROR)
             {
-                nArrkey = getch();
-                if (nArrkey == KEY_LEFT)
-                    selectedCard = 0;
-                else if (nArrkey == KEY_RIGHT)
-                    selectedCard = 1;
-
+                closesocket(reader.sock);
+                reader.sock = INVALID_SOCKET;
+                Sleep(1000);
             }
-        } while (nArrkey != KEY_ENTER);
+        }
+        freeaddrinfo(address);
+    }
 
-        strcpy(currentPlayer->pSelectedCard, currentPlayer->card.playercard[selectedCard]);
+    if (reader.sock == INVALID_SOCKET)
+        printf("Error: cannot reach coordinator %s:%s\n", host, port);
 
-        if(!noValidMoveFlag)
+    else if (initSearch(&ctx, cards, &keys, ANALYSIS_TT_BITS))
+    {
+        status = 0;
+        while (running && netReadLine(&reader, line, sizeof(line)))
         {
-            do //position selection piece
+            if (sscanf(line, "PLAY %d %d %d %llu %d %d %d", &unit, &first, &count, &seed, &depth,
+                       &rule.repetitions, &rule.maxPlies) == 7)
             {
-                nFlagPiece = 1;
-                displayBoard(board, p1, p2, crdsIG, fromRow, fromCol, nFlagPiece);
-                printf("\n%s's turn\n", currentPlayer->name);
-                printf("Select your piece (arrow keys). Press ENTER to confirm.\n");
-                printf("Current Card: %s\n", currentPlayer->pSelectedCard);
-                if(!isValidpiece(currentPlayer, board, fromRow, fromCol, *playerTurn))
+                // every game has its own seed, so it is the same game whichever worker plays it
+                for (i = 0; i < count && running; i++)
                 {
-                    printf("\x1b[31m" "Not a valid Piece!\n" "\x1b[0m");
+                    rngSeed(&rng, seed + first + i);
+                    selfPlayGame(&ctx, &rng, depth, &rule, &clock, cards, cardCount, &record);
+                    running = sendAll(reader.sock, text, formatGameRecord(&record, cards, text));
                 }
-
-                nArrkey = getch();
-                if (nArrkey == 0 || nArrkey == 224)
+            }
+            else if (sscanf(line, "ANALYZE %d %d %d %d", &unit, &job.depth, &job.timeMs, &count) == 4)
+            {
+                for (i = 0; i < count && running; i++)
                 {
-                        nArrkey = getch();
-                    if (nArrkey == KEY_UP)
-                        fromRow = (fromRow - 1 + ROWS) % ROWS;
-                    else if (nArrkey == KEY_DOWN)
-                        fromRow = (fromRow + 1) % ROWS;
-                    else if (nArrkey == KEY_LEFT)
-                        fromCol = (fromCol - 1 + COLS) % COLS;
-                    else if (nArrkey == KEY_RIGHT)
-                        fromCol = (fromCol + 1) % COLS;
+                    running = netReadLine(&reader, line, sizeof(line));
+                    analyzeLine(&ctx, &job, line, result);
+                    strcat(result, "\n");
+                    if (running)
+                        running = sendAll(reader.sock, result, strlen(result));
                 }
-            } while (nArrkey != KEY_ENTER || !isValidpiece(currentPlayer, board, fromRow, fromCol, *playerTurn));
-
-            strcpy(currentPlayer->pPiece.selectedPiece, board[fromRow][fromCol]);
-            toRow = fromRow;
-            toCol = fromCol;
+            }
+            else
+                running = 0; // QUIT or a command this build does not know
 
-            if (!hasValidMoveForPiece(currentPlayer, board, fromRow, fromCol, *playerTurn, selectedCard)) //Check if the player has any valid moves for the selected piece
+            if (running)
             {
-                printf("\x1b[31m" "\nPlayer %s has no valid moves for the selected card.\n" "\x1b[0m", currentPlayer->name);
-                printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
-                printf("Press any key to Continue...\n");
-                getch();
-                selectedCard = !selectedCard;
-                strcpy(currentPlayer->pSelectedCard, currentPlayer->card.playercard[selectedCard]);
+                sprintf(text, "DONE %d\n", unit);
+                running = sendAll(reader.sock, text, strlen(text));
+            }
+        }
+        freeSearch(&ctx);
+    }
 
-                if (!hasValidMoveForPiece(currentPlayer, board, fromRow, fromCol, *playerTurn, selectedCard)) //Check if the player has any valid moves for the selected piece
-                {
-                    noValidMoveFlag = 1;
-                    do
-                    {
-                        displayBoard(board, p1, p2, crdsIG, 0, 0, 0);
-                        printf("\x1b[31m" "\nPlayer %s has no valid moves for the current selected piece.\n" "\x1b[0m", currentPlayer->name);
-                        printf("You must still place one of your move cards on the side and pick up the one from the center.\n");
-                        printf("Choose card to place (LEFT/RIGHT), then press ENTER.\n");
-                        printf("Selected Card: %s\n", currentPlayer->card.playercard[selectedCard]);
-
-                        nArrkey = getch();
-                        if (nArrkey == 0 || nArrkey == 224)
-                        {
-                            nArrkey = getch();
-                            if (nArrkey == KEY_LEFT)
-                                selectedCard = 0;
-                            else if (nArrkey == KEY_RIGHT)
-                                selectedCard = 1;
-                        }
-                    } while (nArrkey != KEY_ENTER);
+    if (reader.sock != INVALID_SOCKET)
+        closesocket(reader.sock);
+    WSACleanup();
+    return status;
+}
 
-                    switchCard(currentPlayer, crdsIG, selectedCard, *playerTurn, *round);
+/*
+Single search mode "-search <position>": searches one position and prints every iteration and
+the search statistics. Options: "-depth <plies>", "-time <ms>", "-trace <file>" to write the
+search tree down to "-trace-depth <plies>" (default DEFAULT_TRACE_DEPTH), as Chrome trace events
+(chrome://tracing, Perfetto) or with "-trace-format json" as a nested JSON tree, "-tt-file <file>"
+and "-tt-bits <n>" as in runBatchAnalysis, "-multipv <k>" to print the k best moves, each with
+its score and principal variation
 
-                    if (*playerTurn == 0)
-                        *playerTurn = 1;
-                    else
-                        *playerTurn = 0;
+Precondition:
+    - cards must hold cardCount loaded cards
+
+@param position Position notation as written by formatPosition
+@param argc Number of command line arguments
+@param argv Command line arguments
+@param cards The card table
+@param cardCount Number of cards in the table
+@return Returns 0 on success, 1 on a bad position or trace file
+*/
+int runSearch(const char *position, int argc, char *argv[], cardInfo cards[], int cardCount)
+{
+    searchContext ctx;
+    searchResult result;
+    searchTrace trace;
+    pvLine lines[MAX_MULTIPV];
+    zobristKeys keys;
+    gameState state;
+    char *depthArg = argValue(argc, argv, "-depth");
+    char *timeArg = argValue(argc, argv, "-time");
+    char *traceArg = argValue(argc, argv, "-trace");
+    char *traceDepthArg = argValue(argc, argv, "-trace-depth");
+    char *formatArg = argValue(argc, argv, "-trace-format");
+    char moveText[MAX_NAME_LEN + 16];
+    char statsText[MAX_RESULT_LEN];
+    int timeMs = timeArg != NULL ? atoi(timeArg) : 0;
+    int depth = depthArg != NULL ? atoi(depthArg) : (timeMs > 0 ? MAX_SEARCH_DEPTH : DEFAULT_ANALYSIS_DEPTH);
+    int lineCount = multiPVArg(argc, argv);
+    int found = 0;
+    int i;
+    int status = 1;
 
-                    *round = *round + 1;
-                    currentPlayer->turns++;
-                }
-            }
-            if(!noValidMoveFlag)
-            {
-                do
-                {
-                    displayBoard(board, p1, p2, crdsIG, toRow, toCol, nFlagPiece);
-                    printf("\n%s's turn\n", currentPlayer->name);
-                    printf("Select destination (arrow keys). Press ENTER to confirm.\n");
-                    printf("Moving with: %s\n", currentPlayer->pSelectedCard);
-                    printf("Selected Piece: %s\n", currentPlayer->pPiece.selectedPiece);
-                    if(!isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, *playerTurn, selectedCard))
-                        printf("Not a valid Move!\n");
-
-                    else if(!isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, *playerTurn, selectedCard))
-                        printf("\x1b[33m" "No Valid Move for Player %s\n" "\x1b[0m", currentPlayer->name);
-
-                    nArrkey = getch();
-                    if (nArrkey == 0 || nArrkey == 224)
-                    {
-                        nArrkey = getch();
-                        if (nArrkey == KEY_UP)
-                            toRow = (toRow - 1 + ROWS) % ROWS;
-                        else if (nArrkey == KEY_DOWN)
-                            toRow = (toRow + 1) % ROWS;
-                        else if (nArrkey == KEY_LEFT)
-                            toCol = (toCol - 1 + COLS) % COLS;
-                        else if (nArrkey == KEY_RIGHT)
-                            toCol = (toCol + 1) % COLS;
-                    }
-                } while (nArrkey != KEY_ENTER || !isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, *playerTurn, selectedCard));
+    if (depth < 1 || depth > MAX_SEARCH_DEPTH)
+        depth = MAX_SEARCH_DEPTH;
+    initZobrist(&keys);
+    memset(&trace, 0, sizeof(trace));
+    trace.chrome = formatArg == NULL || strcmp(formatArg, "json") != 0;
+    trace.maxPly = traceDepthArg != NULL ? atoi(traceDepthArg) : DEFAULT_TRACE_DEPTH;
+    if (trace.maxPly < 0 || trace.maxPly > MAX_SEARCH_DEPTH)
+        trace.maxPly = DEFAULT_TRACE_DEPTH;
+    trace.first[0] = 1;
 
-                moveValid = isValidMove(currentPlayer, board, fromRow, fromCol, toRow, toCol, *playerTurn, selectedCard);
+    if (!parsePosition(position, cards, cardCount, &state) || coreWinner(&state) != 0)
+        printf("Error: invalid or finished position\n");
 
-                if (moveValid)
-                {
-                    strcpy(currentPlayer->pPiece.selectedPiece, board[fromRow][fromCol]); //Update board
-                    strcpy(board[toRow][toCol], currentPlayer->pPiece.selectedPiece);
-                    strcpy(board[fromRow][fromCol], "| _ |");
+    else if (traceArg != NULL && (trace.fp = fopen(traceArg, "w")) == NULL)
+        printf("Error: Cannot open file %s\n", traceArg);
 
-                    switchCard(currentPlayer, crdsIG, selectedCard, *playerTurn, *round); // Switch Card position
-                    // Record the move
-                    recordMove(replayMoves, moveCount, *playerTurn + 1, makePosition(fromCol, fromRow), makePosition(toCol, toRow), currentPlayer->pSelectedCard);
+    else if (openSearch(&ctx, cards, cardCount, &keys, argValue(argc, argv, "-tt-file"), ttBitsArg(argc, argv)))
+    {
+        status = 0;
+        if (trace.fp != NULL)
+        {
+            ctx.trace = &trace;
+            trace.start = microTime();
+            fputs(trace.chrome ? "{\"traceEvents\":[\n" : "{\"name\":\"search\",\"children\":[\n", trace.fp);
+        }
 
-                    if (*playerTurn == 0) //Swap Turns
-                        *playerTurn = 1;
-                    else
-                        *playerTurn = 0;
+        if (lineCount > 1)
+            found = searchMultiPV(&ctx, &state, depth, timeMs, lineCount, lines, &result);
+        else
+            searchPosition(&ctx, &state, depth, timeMs, &result);
 
-                    (*round)++;
-                    currentPlayer->turns++;
+        printf("depth        nodes     time(ms)    ebf\n");
+        for (i = 1; i <= result.depth; i++)
+        {
+            printf("%5d %12llu %12.2f", i, ctx.stats.iterNodes[i], ctx.stats.iterMicros[i] / 1000.0);
+            if (i > 1 && ctx.stats.iterNodes[i - 1] > 0)
+                printf(" %6.2f", (double) ctx.stats.iterNodes[i] / ctx.stats.iterNodes[i - 1]);
+            printf("\n");
+        }
 
-                }
-            }
-            else
-                printf("\x1b[31m" "Invalid move! Try again.\n" "\x1b[0m"); //Invalid Move
+        formatMove(result.best, cards, moveText);
+        formatSearchStats(&result, &ctx.stats, statsText);
+        printf("bestmove %s score %d depth %d nodes %llu\n%s\n", moveText, result.score, result.depth,
+               result.nodes, statsText + 1);
+        for (i = 0; i < found; i++)
+        {
+            formatPV(&lines[i], cards, MAX_RESULT_LEN, statsText);
+            printf("pv %d score %d %s\n", i + 1, lines[i].score, statsText);
         }
+
+        if (trace.fp != NULL)
+            fputs("\n]}\n", trace.fp);
+        freeSearch(&ctx);
     }
+
+    if (trace.fp != NULL)
+        fclose(trace.fp);
+    return status;
 }
 
 /*
-Sets up the game by shuffling cards, assigning them to players, and reading player names
+Finds the start of the newest game still held by a spectator ring
 
 Precondition:
-    - moveDeck must contain at least MAX_CARD_PER_GAME valid cards
-    - Player structures must be uninitialized
-    - crdsIG must be uninitialized
+    - ring must be mapped
 
-@param moveDeck Array of card names to use
-@param cardCount Number of cards in moveDeck
-@param p1 Pointer to Player 1's data
-@param p2 Pointer to Player 2's data
-@param crdsIG Pointer to game cards data
-@return Returns no data type (void)
+@param ring The ring
+@param head The ring's head when the search starts
+@return Returns the number of the newest intact SPECTATE_START event, or head if there is none
 */
-void initializeGame(str30 moveDeck[], int cardCount, player *p1, player *p2, dataCrdsIG *crdsIG)
+LONG64 latestGameStart(const spectateRing *ring, LONG64 head)
 {
-    int i, isValid;
-
-    system("CLS");
-
-    printf("\x1b[33m" "These are the card before shuffling!\n\n" "\x1b[0m");
-    for (i = 0; i < cardCount; i++)
-        printf("\x1b[36m" "%s\n\n" "\x1b[0m", moveDeck[i]);
-    printf("Press any key to continue!\n");
-    getch();
+    spectateEvent event;
+    LONG64 n = head;
+    LONG64 found = head;
 
-    system("CLS");
-    shuffleCards(moveDeck, cardCount); // Shuffle Cards
-    assignMoveCards(moveDeck, p1, p2, crdsIG); // Assign After Shuffling
+    while (found == head && n > 0 && head - n < SPECTATE_SLOTS)
+    {
+        n--;
+        if (readEvent(ring, n, &event) && event.kind == SPECTATE_START)
+            found = n;
+    }
+    return found;
+}
 
-    printf("\x1b[33m" "These Are The Shuffled Cards!\n\n" "\x1b[0m");
-    for (i = 0; i < cardCount; i++)
-        printf("\x1b[36m" "%s\n\n" "\x1b[0m", moveDeck[i]);
-    printf("Press any key to continue!\n");
-    getch();
+/*
+Spectator mode "-spectate <channel>": follows the games another process broadcasts with
+"-broadcast <channel>" and draws them with the game's own board layout. The viewer only
+reads the shared ring, so it can neither stall nor disturb the game; if it falls a whole
+ring behind it skips to the newest game start. Runs until the broadcaster exits
 
-    p1->turns = 0;
-    p2->turns = 0;
+Precondition:
+    - cards must hold cardCount loaded cards, from the same card files as the broadcaster
+    - term must have been set up by openTerminal
+
+@param channel Name of the channel
+@param cards The card table
+@param cardCount Number of cards in the table
+@param term The terminal to draw on
+@return Returns 0 once the broadcaster has exited
+*/
+int runSpectate(const char *channel, cardInfo cards[], int cardCount, terminal *term)
+{
+    spectateRing *ring = NULL;
+    HANDLE mapping;
+    spectateEvent event;
+    zobristKeys keys;
+    undoRecord undo[MAX_MOVES];
+    gameState state;
+    unsigned long long hash = 0;
+    LONG64 next, head;
+    oniBrd board;
+    player p1, p2;
+    dataCrdsIG crdsIG;
+    int deal[MAX_CARD_PER_GAME];
+    int moveCount = 0;
+    int started = 0;
+    int winner = -1;                    // result of the game shown, -1 while it is in progress
+    int dirty = 0;
+    int done = 0;
+    int i;
 
-    system("CLS");
-    printf("\x1b[36m" "--- Onitama ---\n\n" "\x1b[0m");
+    initZobrist(&keys);
+    populatePlayerPiece(&p1, &p2);
+    printf("Waiting for a game on channel %s...\n", channel);
+    while (ring == NULL)
+    {
+        ring = openSpectateRing(channel, 0, &mapping);
+        if (ring == NULL)
+            Sleep(SPECTATE_POLL_MS * 10);
+    }
+    next = latestGameStart(ring, ring->head);
 
-    /* Get player names */
-    do
+    while (!done)
     {
-        isValid = 1;
-        printf("\x1b[33m" "Enter" "\x1b[0m" "\x1b[34m" " Player 1 " "\x1b[0m" "\x1b[33m" "Name: " "\x1b[0m");
-        scanf("%s", p1->name);
-        for (i = 0; i < strlen(p1->name); i++)
+        head = ring->head;
+        if (next < head)
         {
-            if (!isAlpha(p1->name[i]))
+            if (head - next > SPECTATE_SLOTS || !readEvent(ring, next, &event))
             {
-                printf("\x1b[31m" "Invalid Name!\n" "\x1b[0m");
-                isValid = 0;
+                next = latestGameStart(ring, head);
+                started = 0;
             }
-        }
-    } while (!isValid);
-
-    do
-    {
-        isValid = 1;
-        printf("\x1b[33m" "Enter" "\x1b[0m"  "\x1b[31m" " Player 2 " "\x1b[0m" "\x1b[33m" "Name: " "\x1b[0m");
-        scanf("%s", p2->name);
-        for (i = 0; i < strlen(p2->name); i++)
-        {
-            if (!isAlpha(p2->name[i]))
+            else
             {
-                printf("\x1b[31m" "Invalid Name!\n" "\x1b[0m");
-                isValid = 0;
+                if (event.kind == SPECTATE_START)
+                {
+                    for (i = 0; i < MAX_CARD_PER_GAME; i++)
+                        deal[i] = findCardId(cards, cardCount, event.deal[i]);
+                    initialState(deal, cards, &state);
+                    hash = hashState(&state, &keys);
+                    strcpy(p1.name, event.names[0]);
+                    strcpy(p2.name, event.names[1]);
+                    moveCount = 0;
+                    winner = -1;
+                    started = 1;
+                }
+                else if (started && event.kind == SPECTATE_MOVE && moveCount < MAX_MOVES)
+                {
+                    makeMove(&state, coreMoveFromRecord(&event.move, cards, cardCount), cards, &keys, &hash, NULL,
+                             &undo[moveCount]);
+                    moveCount++;
+                }
+                else if (started && event.kind == SPECTATE_UNDO && moveCount > 0)
+                {
+                    moveCount--;
+                    unmakeMove(&state, &undo[moveCount], &hash, NULL);
+                }
+                else if (started && event.kind == SPECTATE_RESULT)
+                    winner = event.winner;
+
+                dirty = started;
+                next++;
             }
         }
-    } while (!isValid);
+        else if (dirty)
+        {
+            // drawn once caught up, so a backlog of events shows as one frame
+            boardFromState(&state, cards, board, &p1, &p2, &crdsIG);
+            displayBoard(board, &p1, &p2, &crdsIG, 0, 0, 0, 0, 0, NULL, NULL, term);
+            printf("Spectating %s, move %d\n", channel, moveCount);
+            if (winner == 0)
+                printf("Draw!\n");
+            else if (winner > 0)
+                printf("%s won!\n", winner == 1 ? p1.name : p2.name);
+            else
+                printf("%s's turn\n", state.side == 0 ? p1.name : p2.name);
+            fflush(stdout);
+            dirty = 0;
+        }
+        else if (ring->closed)
+            done = 1;
+        else
+            Sleep(SPECTATE_POLL_MS);
+    }
+
+    closeSpectateRing(ring, mapping, 0);
+    return 0;
 }
+
 /*
-Initializes and runs the main game sequence
+Orders latency samples ascending (qsort callback)
 
 Precondition:
-    - Board must be properly allocated
-    - moveDeck must contain valid card names
-    - cardCount must be > 0 and <= MAX_CARDS
+    - a and b must point to unsigned long long values
 
-@param board The game board array
-@param moveDeck Array containing all available move cards
-@param cardCount Number of cards in moveDeck
-@return Returns no data type (void)
+@param a First sample
+@param b Second sample
+@return Returns a negative, zero or positive value as a is below, equal to or above b
 */
-void playGame(oniBrd board, str30 moveDeck[], int cardCount) 
+int compareLatencies(const void *a, const void *b)
 {
-    // All variables declared at top
-    player p1, p2;
-    dataCrdsIG crdsIG;
-    int playerTurn = 0;
-    int gameOver = 0;
-    int round = 1;
-    MoveRecord replayMoves[MAX_MOVES];
-    int moveCount = 0;
-    char choice;
-    
-    initializeGame(moveDeck, cardCount, &p1, &p2, &crdsIG);
-    populatePlayerPiece(&p1, &p2);
-    populateBoard(board, &p1, &p2);
-    playerTurn = getFirstTurn(crdsIG);
+    unsigned long long x = *(const unsigned long long *) a;
+    unsigned long long y = *(const unsigned long long *) b;
 
-    while (!gameOver) 
-    {
-        gameTurn(&p1, &p2, board, &crdsIG, &playerTurn, &round, replayMoves, &moveCount);
-        gameOver = checkWinCondition(board, &p1, &p2);
-    } 
+    return (x > y) - (x < y);
+}
+
+/*
+Sets up the menu's terminal from the command line: "-script <file>" replays recorded
+keystrokes, "-bench" runs headless with the screen sent to "-sink <file>" (NUL by default)
+and measures the time from each key to the next input request, "-broadcast <channel>"
+publishes the games to spectators
+
+Precondition:
+    - term must point to a terminal
 
-    if (gameOver == 1) 
+@param term Receives the terminal
+@param argc Number of command line arguments
+@param argv Command line arguments
+@return Returns 1 when the terminal is ready, 0 when the script, sink or channel cannot be opened
+*/
+int openTerminal(terminal *term, int argc, char *argv[])
+{
+    int ok = 1;
+
+    memset(term, 0, sizeof(terminal));
+    if (argValue(argc, argv, "-script") != NULL)
     {
-        Sleep(1000);
-        printf("\nCongratulations %s! You won!\n", p1.name);
-        updateHoF(p1);
-        Sleep(1000);
+        term->script = fopen(argValue(argc, argv, "-script"), "r");
+        if (term->script == NULL)
+        {
+            printf("Error: Cannot open file %s\n", argValue(argc, argv, "-script"));
+            ok = 0;
+        }
     }
-    else 
+
+    if (ok && argValue(argc, argv, "-broadcast") != NULL)
     {
-        Sleep(1000);
-        printf("\nCongratulations %s! You won!\n", p2.name);
-        updateHoF(p2);
-        Sleep(1000);
+        term->broadcast = openSpectateRing(argValue(argc, argv, "-broadcast"), 1, &term->broadcastMapping);
+        if (term->broadcast == NULL)
+        {
+            printf("Error: Cannot broadcast on channel %s, is another game using it?\n",
+                   argValue(argc, argv, "-broadcast"));
+            ok = 0;
+        }
     }
 
-    do 
+    if (ok && hasFlag(argc, argv, "-bench"))
     {
-        printf("Would you like to replay the game? (y/n): ");
-        scanf(" %c", &choice);
-    } while (!(choice == 'y' || choice == 'Y' ||choice == 'n' || choice == 'N'));
+        term->headless = 1;
+        term->latencyCapacity = 1024;
+        term->latencies = malloc(term->latencyCapacity * sizeof(unsigned long long));
+        if (freopen(argValue(argc, argv, "-sink") != NULL ? argValue(argc, argv, "-sink") : "NUL", "w",
+                    stdout) == NULL)
+        {
+            fprintf(stderr, "Error: Cannot open the output sink\n");
+            ok = 0;
+        }
+    }
+    return ok;
+}
 
-    if(choice == 'y' || choice == 'Y')
-        replayMovesSequence(replayMoves, moveCount);
+/*
+Prints the latency percentiles of a benchmark run to stderr and releases the terminal, telling
+spectators the broadcast is over
 
-    printf("Press any key to return to main menu...");
-    getch();    
+Precondition:
+    - term must have been set up by openTerminal
+
+@param term The terminal
+@return Returns no data type (void)
+*/
+void closeTerminal(terminal *term)
+{
+    unsigned long long total = 0;
+    int i;
+
+    if (term->latencies != NULL && term->latencyCount > 0)
+    {
+        qsort(term->latencies, term->latencyCount, sizeof(unsigned long long), compareLatencies);
+        for (i = 0; i < term->latencyCount; i++)
+            total += term->latencies[i];
+
+        fprintf(stderr, "keys %d p50 %.3f ms p99 %.3f ms max %.3f ms mean %.3f ms\n", term->latencyCount,
+                term->latencies[term->latencyCount / 2] / 1000.0,
+                term->latencies[(term->latencyCount * 99) / 100] / 1000.0,
+                term->latencies[term->latencyCount - 1] / 1000.0,
+                (double) total / term->latencyCount / 1000.0);
+    }
+
+    free(term->latencies);
+    if (term->script != NULL)
+        fclose(term->script);
+    if (term->broadcast != NULL)
+        closeSpectateRing(term->broadcast, term->broadcastMapping, 1);
 }
 
 /*
@@ -1540,32 +11353,114 @@ Precondition:
     - Data structures are correctly initialized
     - Move cards file exists and is properly formatted
 
+@param argc Number of command line arguments
+@param argv Command line arguments, "-seed <n>" fixes the first game's deal, "-clock <minutes>+<seconds>"
+            times the games and "-analyze <file>", "-selfplay", "-db-build", "-db-query", "-index-build",
+            "-index-query", "-ratings", "-simulate", "-tune-extract", "-tune", "-search",
+            "-solve", "-puzzles", "-survey", "-coordinator" and "-worker" run batch modes instead of the menu, "-script <file>" plays the menu
+            from recorded keystrokes and "-bench" replays them headless and reports latency,
+            "-broadcast <channel>" publishes the games and "-spectate <channel>" watches them
 @return Returns 0 on successful program execution
 */
-int main()
+int main(int argc, char *argv[])
 {
-
-    srand(time(NULL)); // Seed Random Gen else if this didnt exist it will still
-                       // generate random number but once exiting the code the random num generated would still be the same
+    rngState seedSource; // hands each game its own seed so every deal can be replayed from GameLog.txt
+    unsigned long long gameSeed = (unsigned long long) time(NULL);
     str30 moveDeck[MAX_CARDS]; // Move deck cards
+    cardInfo cards[MAX_CARDS]; // Patterns and move masks of every card, indexed by card id
     int cardCount = 0; // count of cards
     oniBrd board;
     int nArrKeys;
     int nSelected = 0;
     int i;
     int ok;
+    drawRule rule;
+    gameClock clock;
+    terminal term;
     str30 sMenu[MAX_MENU_SELECTION] =
     {
         "Start Game", "Hall of Fame", "How to Play", "Quit"
     };
 
+    if (argValue(argc, argv, "-seed") != NULL)
+        gameSeed = strtoull(argValue(argc, argv, "-seed"), NULL, 10);
+    rngSeed(&seedSource, gameSeed);
+    readDrawRule(argc, argv, &rule);
+    readClock(argc, argv, &clock);
+
     ok = readMoveCards(moveDeck, &cardCount);
+    if (ok)
+        ok = loadCardTable(moveDeck, cardCount, cards);
+
+    if (ok && argValue(argc, argv, "-analyze") != NULL)
+        return runBatchAnalysis(argValue(argc, argv, "-analyze"), argc, argv, cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-selfplay") == 0)
+        return runSelfPlay(atoi(argv[2]), argv[3], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 3 && strcmp(argv[1], "-simulate") == 0)
+        return runSimulate(atoi(argv[2]), argc, argv, cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-db-build") == 0)
+    {
+        for (i = 3; i < argc && argv[i][0] != '-'; i++)
+            ;
+        return runDbBuild(argv[2], argv + 3, i - 3, argc, argv, cards, cardCount);
+    }
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-db-export") == 0)
+        return runDbExport(argv[2], argv[3], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-index-build") == 0)
+        return runIndexBuild(argv[2], argv[3], argc, argv, cards, cardCount);
 
-    if(ok)
+    if (ok && argc >= 4 && strcmp(argv[1], "-index-query") == 0)
+        return runIndexQuery(argv[2], argv[3], cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-tune-extract") == 0)
+        return runTuneExtract(argv[2], argv[3], argc, argv, cards, cardCount);
+
+    if (argc >= 3 && strcmp(argv[1], "-tune") == 0)
+        return runTune(argv[2], argc, argv);
+
+    if (ok && argc >= 6 && strcmp(argv[1], "-coordinator") == 0)
+        return runCoordinator(argv[2], argv[3], argv[4], argv[5], argc, argv);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-worker") == 0)
+        return runWorker(argv[2], argv[3], cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-survey") == 0)
+        return runSurvey(argv[2], argv[3], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-puzzles") == 0)
+        return runPuzzles(atoi(argv[2]), argv[3], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 3 && strcmp(argv[1], "-search") == 0)
+        return runSearch(argv[2], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 3 && strcmp(argv[1], "-solve") == 0)
+        return runSolve(argv[2], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 3 && strcmp(argv[1], "-ratings") == 0)
+        return runRatings(argv[2], argc, argv, cards, cardCount);
+
+    if (ok && argc >= 4 && strcmp(argv[1], "-db-query") == 0)
+        return runDbQuery(argv[2], argv[3], argc >= 5 && argv[4][0] != '-' ? argv[4] : NULL,
+                          argc, argv, cards, cardCount);
+
+    if (ok)
+        ok = openTerminal(&term, argc, argv);
+
+    if (ok && argValue(argc, argv, "-spectate") != NULL)
+    {
+        runSpectate(argValue(argc, argv, "-spectate"), cards, cardCount, &term);
+        closeTerminal(&term);
+    }
+    else if(ok)
     {
         do
         {
-            system("CLS");
+            clearScreen(&term);
             printf("\n\t\t+===========================+\n");
             printf("\t\t|       " "\x1b[36m" "ONITAMA GAME" "\x1b[0m" "        |\n");
             printf("\t\t+===========================+\n\n");
@@ -1579,10 +11474,10 @@ int main()
                     printf("\t\t    %s\n", sMenu[i]);
             }
 
-            nArrKeys = getch();
+            nArrKeys = readKey(&term);
             if (nArrKeys == 0 || nArrKeys == 224)
             {
-                nArrKeys = getch();
+                nArrKeys = readKey(&term);
                 if (nArrKeys == KEY_UP)
                     nSelected = (nSelected - 1 + MAX_MENU_SELECTION) % MAX_MENU_SELECTION;
                 else if (nArrKeys == KEY_DOWN)
@@ -1591,13 +11486,17 @@ int main()
             else if (nArrKeys == KEY_ENTER)
             {
                 if(nSelected == 0)
-                    playGame(board, moveDeck, cardCount);
+                {
+                    playGame(board, moveDeck, cardCount, gameSeed, cards, &rule, &clock, &term);
+                    gameSeed = rngNext(&seedSource);
+                }
                 else if(nSelected == 1)
-                    displayHoF();
+                    displayHoF(&term);
                 else if(nSelected == 2)
-                    howToPlay();
+                    howToPlay(&term);
             }
         } while (nArrKeys != KEY_ENTER || nSelected != 3);
+        closeTerminal(&term);
     }
     printf("\n");
 